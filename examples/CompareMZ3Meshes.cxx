@@ -0,0 +1,62 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkMZ3MeshComparator.h"
+
+
+int
+main(int argc, char * argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << argv[0] << " baselineMesh"
+              << " testMesh"
+              << " [coordinateTolerance]"
+              << " [scalarTolerance]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Compare the MZ3 files section by section, without reading them into meshes.
+  // Raw and compressed files can be compared with each other.
+  auto comparator = itk::MZ3MeshComparator::New();
+  comparator->SetBaselineFileName(argv[1]);
+  comparator->SetTestFileName(argv[2]);
+  if (argc > 3)
+  {
+    comparator->SetCoordinateTolerance(std::stod(argv[3]));
+  }
+  if (argc > 4)
+  {
+    comparator->SetScalarTolerance(std::stod(argv[4]));
+  }
+
+  bool isEqual = false;
+  try
+  {
+    isEqual = comparator->Compare();
+  }
+  catch (const itk::ExceptionObject & error)
+  {
+    std::cerr << "Error: " << error << std::endl;
+    return EXIT_FAILURE;
+  }
+  comparator->PrintReport(std::cout);
+
+  return isEqual ? EXIT_SUCCESS : EXIT_FAILURE;
+}
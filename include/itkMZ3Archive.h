@@ -0,0 +1,153 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkMZ3Archive_h
+#define itkMZ3Archive_h
+#include "IOMeshMZ3Export.h"
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace itk
+{
+/** \class MZ3Archive
+ *
+ * \brief A single .mz3a file holding many named MZ3 payloads, such as the regions of an atlas.
+ *
+ * The file starts with a 32 byte header: the magic "MZ3A", a uint32 version, and uint64 numbers
+ * of entries, offset of the index and size of the index. The payloads follow, each aligned to
+ * 8 bytes and stored as given, raw or gzip compressed. The index at the end of the file holds,
+ * for every entry, its offset, size, a compressed flag, its decoded 16 byte MZ3 header and its
+ * name. All values are little endian.
+ *
+ * Open() reads the header and the index, after which every entry is read with a single
+ * positioned read. MZ3MeshIO reads entries through paths of the form "atlas.mz3a:entry", so
+ * passing GetEntryPaths() to ReadMZ3Batch() loads all entries concurrently.
+ *
+ * Archives are created by adding entries with AddEntry() or AddFile() and calling Write().
+ *
+ * \ingroup IOMeshMZ3
+ */
+class IOMeshMZ3_EXPORT MZ3Archive : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(MZ3Archive);
+
+  /** Standard class type aliases. */
+  using Self = MZ3Archive;
+  using Superclass = Object;
+  using ConstPointer = SmartPointer<const Self>;
+  using Pointer = SmartPointer<Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** \see LightObject::GetNameOfClass() */
+  itkOverrideGetNameOfClassMacro(MZ3Archive);
+
+  /** An entry of the index. */
+  struct Entry
+  {
+    std::string   m_Name;
+    SizeValueType m_Offset{ 0 };
+    SizeValueType m_Size{ 0 };
+    bool          m_IsCompressed{ false };
+    // The MZ3 header of the decoded payload.
+    uint8_t m_Header[16]{};
+  };
+
+  itkSetStringMacro(FileName);
+  itkGetStringMacro(FileName);
+
+  /** Read the header and the index of the archive. */
+  void
+  Open();
+
+  /** Whether the archive is open and its file has not been modified since Open(). */
+  bool
+  IsUpToDate() const;
+
+  /** The entries of the open archive, in file order. */
+  const std::vector<Entry> &
+  GetEntries() const
+  {
+    return m_Entries;
+  }
+
+  /** The entry named name, or nullptr. */
+  const Entry *
+  FindEntry(const std::string & name) const;
+
+  /** Read the payload of the entry named name into payload with one positioned read. Thread safe. */
+  void
+  ReadEntry(const std::string & name, std::vector<uint8_t> & payload) const;
+
+  /** "FileName:name" for every entry, for MZ3MeshIO and ReadMZ3Batch(). */
+  std::vector<std::string>
+  GetEntryPaths() const;
+
+  /** Split a path of the form "archive.mz3a:entry". Returns false if path names no entry. */
+  static bool
+  SplitEntryPath(const std::string & path, std::string & archiveFileName, std::string & entryName);
+
+  /** Add an entry holding the size bytes of raw or gzip compressed MZ3 data at data, as written
+   * by MZ3MeshIO::SetOutputBuffer(). The data is copied. Names must be unique and non-empty. */
+  void
+  AddEntry(const std::string & name, const void * data, SizeValueType size);
+
+  /** Add an entry holding the contents of the MZ3 file fileName. */
+  void
+  AddFile(const std::string & name, const std::string & fileName);
+
+  /** Write the added entries to FileName and clear them. */
+  void
+  Write();
+
+protected:
+  MZ3Archive() = default;
+  ~MZ3Archive() override;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+  /** Close the descriptor of the open archive. */
+  void
+  Close();
+
+private:
+  struct PendingEntry
+  {
+    Entry                m_Entry;
+    std::vector<uint8_t> m_Data;
+  };
+
+  std::string                                    m_FileName{};
+  std::vector<Entry>                             m_Entries{};
+  std::unordered_map<std::string, SizeValueType> m_EntryIndex{};
+  std::filesystem::file_time_type                m_FileTime{};
+  bool                                           m_IsOpen{ false };
+  int                                            m_FileDescriptor{ -1 };
+  std::vector<PendingEntry>                      m_PendingEntries{};
+};
+} // end namespace itk
+
+#endif
@@ -0,0 +1,71 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkMZ3BatchReader_h
+#define itkMZ3BatchReader_h
+
+#include "itkIntTypes.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace itk
+{
+/** \struct MZ3BatchReadOptions
+ *
+ * \brief Options for ReadMZ3Batch().
+ *
+ * \ingroup IOMeshMZ3
+ */
+struct MZ3BatchReadOptions
+{
+  /** Number of meshes decoded concurrently. Zero selects the global default number of threads. */
+  unsigned int NumberOfWorkUnits{ 0 };
+
+  /** Upper bound, in bytes, on the estimated size of the meshes that have been decoded but not yet
+   * handed to the callback. A mesh is always read when nothing else is in flight, so a single mesh
+   * larger than the budget does not stall the batch. Zero means no limit. */
+  SizeValueType MemoryBudget{ 0 };
+
+  /** Hand the meshes to the callback in the order of the paths instead of in completion order. */
+  bool PreserveOrder{ false };
+};
+
+/** Read the MZ3 files in paths concurrently and pass each mesh to callback, together with its index
+ * in paths.
+ *
+ * Every work unit reuses a single MZ3MeshIO, so there is no factory lookup per file. Files are
+ * claimed from a shared cursor as work units become free, which balances meshes of different sizes.
+ * The callback is never invoked concurrently, so it does not need to be thread safe. If reading a
+ * file or the callback throws, no further files are started and the first exception is rethrown
+ * once the work units have finished.
+ *
+ * \ingroup IOMeshMZ3
+ */
+template <typename TMesh>
+void
+ReadMZ3Batch(const std::vector<std::string> &                                                   paths,
+             const std::function<void(SizeValueType, const std::string &, typename TMesh::Pointer)> & callback,
+             const MZ3BatchReadOptions & options = MZ3BatchReadOptions());
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkMZ3BatchReader.hxx"
+#endif
+
+#endif
@@ -0,0 +1,186 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkMZ3BatchReader_hxx
+#define itkMZ3BatchReader_hxx
+
+#include "itkMZ3MeshIO.h"
+#include "itkMeshFileReader.h"
+#include "itkMultiThreaderBase.h"
+#include "itkTriangleCell.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <mutex>
+
+namespace itk
+{
+template <typename TMesh>
+void
+ReadMZ3Batch(const std::vector<std::string> &                                                   paths,
+             const std::function<void(SizeValueType, const std::string &, typename TMesh::Pointer)> & callback,
+             const MZ3BatchReadOptions &                                                         options)
+{
+  using MeshPointer = typename TMesh::Pointer;
+  using TriangleCellType = TriangleCell<typename TMesh::CellType>;
+
+  struct ReadyMesh
+  {
+    SizeValueType m_PathIndex;
+    MeshPointer   m_Mesh;
+    SizeValueType m_EstimatedSize;
+  };
+
+  const SizeValueType numberOfPaths = paths.size();
+  if (numberOfPaths == 0)
+  {
+    return;
+  }
+  unsigned int numberOfWorkUnits = options.NumberOfWorkUnits;
+  if (numberOfWorkUnits == 0)
+  {
+    numberOfWorkUnits = MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+  }
+  numberOfWorkUnits = static_cast<unsigned int>(std::min<SizeValueType>(numberOfWorkUnits, numberOfPaths));
+
+  std::atomic<SizeValueType> nextPath{ 0 };
+  std::atomic<bool>          failed{ false };
+  std::exception_ptr         firstException;
+
+  // Guarded by mutex: the meshes waiting for the callback, keyed by path index or completion order
+  std::mutex                         mutex;
+  std::condition_variable            budgetAvailable;
+  std::map<SizeValueType, ReadyMesh> ready;
+  SizeValueType                      inFlight = 0;
+  SizeValueType                      numberOfInFlight = 0;
+  SizeValueType                      nextToDeliver = 0;
+  SizeValueType                      numberOfCompleted = 0;
+  bool                               delivering = false;
+
+  const auto recordFailure = [&](std::exception_ptr exception) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    if (!failed.exchange(true))
+    {
+      firstException = exception;
+    }
+    budgetAvailable.notify_all();
+  };
+
+  const auto workUnit = [&](SizeValueType) {
+    auto meshIO = MZ3MeshIO::New();
+    for (SizeValueType index = nextPath++; index < numberOfPaths && !failed; index = nextPath++)
+    {
+      SizeValueType estimatedSize = 0;
+      try
+      {
+        // The header gives the size of the mesh before any section is decoded, so the mesh is
+        // only decoded once, by the reader
+        uint8_t header[16];
+        meshIO->SetFileName(paths[index]);
+        if (!meshIO->ReadHeader(header))
+        {
+          itkGenericExceptionMacro("Not an MZ3 file: " << paths[index]);
+        }
+        uint16_t attr = 0;
+        uint32_t nface = 0;
+        uint32_t nvert = 0;
+        std::memcpy(&attr, header + 2, sizeof(attr));
+        std::memcpy(&nface, header + 4, sizeof(nface));
+        std::memcpy(&nvert, header + 8, sizeof(nvert));
+        const SizeValueType numberOfPoints = (attr & 2) ? nvert : 0;
+        estimatedSize = numberOfPoints * (sizeof(typename TMesh::PointType) + sizeof(typename TMesh::PixelType)) +
+                        SizeValueType{ nface } * (sizeof(TriangleCellType) + 2 * sizeof(void *));
+
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          // The mesh that is next in line is always admitted, otherwise meshes held back for
+          // ordering could exhaust the budget and stall the batch.
+          budgetAvailable.wait(lock, [&] {
+            return failed || options.MemoryBudget == 0 || numberOfInFlight == 0 ||
+                   inFlight + estimatedSize <= options.MemoryBudget ||
+                   (options.PreserveOrder && index == nextToDeliver);
+          });
+          if (failed)
+          {
+            return;
+          }
+          inFlight += estimatedSize;
+          ++numberOfInFlight;
+        }
+
+        auto reader = MeshFileReader<TMesh>::New();
+        reader->SetMeshIO(meshIO);
+        reader->SetFileName(paths[index]);
+        reader->Update();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        const SizeValueType          key = options.PreserveOrder ? index : numberOfCompleted;
+        ++numberOfCompleted;
+        ready.emplace(key, ReadyMesh{ index, reader->GetOutput(), estimatedSize });
+        if (delivering)
+        {
+          continue;
+        }
+
+        // Deliver every mesh that is ready, one at a time and outside of the lock
+        delivering = true;
+        while (!failed && !ready.empty() && ready.begin()->first == nextToDeliver)
+        {
+          const ReadyMesh readyMesh = ready.begin()->second;
+          ready.erase(ready.begin());
+          ++nextToDeliver;
+          lock.unlock();
+          try
+          {
+            callback(readyMesh.m_PathIndex, paths[readyMesh.m_PathIndex], readyMesh.m_Mesh);
+          }
+          catch (...)
+          {
+            lock.lock();
+            delivering = false;
+            throw;
+          }
+          lock.lock();
+          inFlight -= readyMesh.m_EstimatedSize;
+          --numberOfInFlight;
+          budgetAvailable.notify_all();
+        }
+        delivering = false;
+      }
+      catch (...)
+      {
+        recordFailure(std::current_exception());
+        return;
+      }
+    }
+  };
+
+  auto multiThreader = MultiThreaderBase::New();
+  multiThreader->SetNumberOfWorkUnits(numberOfWorkUnits);
+  multiThreader->ParallelizeArray(0, numberOfWorkUnits, workUnit, nullptr);
+
+  if (firstException)
+  {
+    std::rethrow_exception(firstException);
+  }
+}
+} // end namespace itk
+
+#endif
@@ -0,0 +1,65 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkMZ3Decimation_h
+#define itkMZ3Decimation_h
+#include "IOMeshMZ3Export.h"
+
+#include "itkIntTypes.h"
+
+#include <vector>
+
+namespace itk
+{
+/** \struct MZ3DecimatedMesh
+ *
+ * \brief Triangle mesh produced by DecimateMZ3Mesh().
+ *
+ * \ingroup IOMeshMZ3
+ */
+struct MZ3DecimatedMesh
+{
+  // Coordinates (x, y, z per point) of the points.
+  std::vector<float> m_Points;
+  // Indices into m_Points, 3 per triangle.
+  std::vector<uint32_t> m_Faces;
+  // Point that every input point is merged into, to resample point data.
+  std::vector<uint32_t> m_PointMap;
+};
+
+/** Decimate a triangle mesh to about fraction of its points by vertex clustering. The points
+ * are binned into a grid of cubic cells, whose size is searched for so that about fraction of
+ * the points remain, and the points of every cell are merged into one. The merged point
+ * minimizes the sum of the squared distances to the planes of the faces of the cell, weighted
+ * by their areas, as in quadric error decimation, or is the mean of the points if that is
+ * ill-conditioned. Faces that collapse are dropped, as are duplicates and pairs of opposite
+ * faces, and the remaining ones keep their orientation. A fraction of 1 or more copies the mesh.
+ *
+ * The decimation runs on the calling thread, so that several levels can be built concurrently.
+ *
+ * \ingroup IOMeshMZ3
+ */
+extern IOMeshMZ3_EXPORT void
+DecimateMZ3Mesh(const float *      points,
+                SizeValueType      numberOfPoints,
+                const uint32_t *   faces,
+                SizeValueType      numberOfFaces,
+                double             fraction,
+                MZ3DecimatedMesh & mesh);
+} // end namespace itk
+
+#endif
@@ -0,0 +1,110 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkMZ3DecompressedCache_h
+#define itkMZ3DecompressedCache_h
+#include "IOMeshMZ3Export.h"
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+
+#include <string>
+
+namespace itk
+{
+/** \class MZ3DecompressedCache
+ *
+ * \brief Directory of inflated copies of gzip compressed MZ3 files, shared by processes.
+ *
+ * GetCachedFileName() returns a raw MZ3 file with the contents of a compressed file, so that it
+ * can be read through the uncompressed or memory mapped paths. Entries are keyed by the
+ * absolute path, size and modification time of the compressed file and by its decoded MZ3
+ * header, so a changed file gets a new entry. A missing entry is inflated into a temporary file
+ * in Directory that is renamed into place once complete, so that concurrent readers on any
+ * node sharing the directory never see a partial entry.
+ *
+ * The modification time of an entry is refreshed whenever it is used. Once the entries exceed
+ * MaximumSize bytes, the least recently used ones are removed, except the entry being returned.
+ *
+ * \ingroup IOMeshMZ3
+ */
+class IOMeshMZ3_EXPORT MZ3DecompressedCache : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(MZ3DecompressedCache);
+
+  /** Standard class type aliases. */
+  using Self = MZ3DecompressedCache;
+  using Superclass = Object;
+  using ConstPointer = SmartPointer<const Self>;
+  using Pointer = SmartPointer<Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** \see LightObject::GetNameOfClass() */
+  itkOverrideGetNameOfClassMacro(MZ3DecompressedCache);
+
+  /** Directory holding the entries. It is created when the first entry is added. */
+  itkSetStringMacro(Directory);
+  itkGetStringMacro(Directory);
+
+  /** Upper bound, in bytes, on the size of the entries. Defaults to 4 GiB. */
+  itkSetMacro(MaximumSize, SizeValueType);
+  itkGetConstMacro(MaximumSize, SizeValueType);
+
+  /** The raw MZ3 file holding the inflated contents of the gzip compressed MZ3 file fileName,
+   * inflated now if it is not in the cache. Throws if fileName is not a compressed MZ3 file. */
+  std::string
+  GetCachedFileName(const std::string & fileName);
+
+  /** The directory "itkMZ3DecompressedCache" in the temporary directory, where MZ3MappedMesh
+   * inflates compressed files unless it is given a cache file or directory. */
+  static std::string
+  GetDefaultDirectory();
+
+  /** Inflate the gzip compressed file fileName into outputFileName, through a uniquely named
+   * temporary file that is renamed into place once complete, so that no reader sees a partial
+   * file. */
+  static void
+  InflateFile(const std::string & fileName, const std::string & outputFileName);
+
+  /** Remove least recently used entries, other than keepFileName, until the entries fit in
+   * MaximumSize. */
+  void
+  Evict(const std::string & keepFileName = std::string());
+
+  /** Number of calls of GetCachedFileName() that found their entry, and that inflated it. */
+  itkGetConstMacro(NumberOfHits, SizeValueType);
+  itkGetConstMacro(NumberOfMisses, SizeValueType);
+
+protected:
+  MZ3DecompressedCache() = default;
+  ~MZ3DecompressedCache() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  std::string   m_Directory{};
+  SizeValueType m_MaximumSize{ SizeValueType{ 4 } * 1024 * 1024 * 1024 };
+  SizeValueType m_NumberOfHits{ 0 };
+  SizeValueType m_NumberOfMisses{ 0 };
+};
+} // end namespace itk
+
+#endif
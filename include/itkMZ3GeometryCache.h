@@ -0,0 +1,157 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkMZ3GeometryCache_h
+#define itkMZ3GeometryCache_h
+#include "IOMeshMZ3Export.h"
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace itk
+{
+/** \class MZ3GeometryCache
+ *
+ * \brief Process wide, least recently used cache of decoded MZ3 vertices and faces.
+ *
+ * Entries are keyed by a 64-bit hash of the face and vertex sections, together with their size
+ * and the fields of the MZ3 header that describe them. Point data and the skip region are not
+ * part of the key. The decoded sections are immutable and shared, so repeated reads of the same
+ * surface hand out the same arrays instead of decoding them again. Callers that need to modify
+ * the geometry copy it.
+ *
+ * Once the cached sections exceed MaximumSize bytes, the least recently used entries are
+ * evicted. All methods are thread safe.
+ *
+ * \ingroup IOMeshMZ3
+ */
+class IOMeshMZ3_EXPORT MZ3GeometryCache : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(MZ3GeometryCache);
+
+  /** Standard class type aliases. */
+  using Self = MZ3GeometryCache;
+  using Superclass = Object;
+  using ConstPointer = SmartPointer<const Self>;
+  using Pointer = SmartPointer<Self>;
+
+  /** \see LightObject::GetNameOfClass() */
+  itkOverrideGetNameOfClassMacro(MZ3GeometryCache);
+
+  /** The cache shared by all MZ3MeshIO instances of the process. */
+  static MZ3GeometryCache *
+  GetInstance();
+
+  /** Identifies a geometry by the hash and size of its sections and the header fields that
+   * describe them. */
+  struct Key
+  {
+    uint64_t      m_Hash;
+    SizeValueType m_Size;
+    uint8_t       m_Header[16];
+
+    bool
+    operator==(const Key & other) const;
+  };
+
+  /** Decoded vertex coordinates (x, y, z per vertex) and triangle indices. */
+  struct Geometry
+  {
+    std::vector<float>    m_Points;
+    std::vector<uint32_t> m_Faces;
+  };
+
+  using GeometryConstPointer = std::shared_ptr<const Geometry>;
+
+  /** 64-bit hash of size bytes at data, processing 32 bytes per step in the manner of xxHash64. */
+  static uint64_t
+  Hash(const void * data, SizeValueType size, uint64_t seed = 0);
+
+  /** Return the geometry stored for key and mark it as most recently used, or nullptr. Counts
+   * a hit or a miss. */
+  GeometryConstPointer
+  Find(const Key & key);
+
+  /** Store geometry for key, evicting least recently used entries to stay within MaximumSize.
+   * Geometry larger than MaximumSize is not stored. */
+  void
+  Insert(const Key & key, GeometryConstPointer geometry);
+
+  /** Remove every entry. The counters are kept. */
+  void
+  Clear();
+
+  /** Upper bound, in bytes, on the size of the cached sections. Defaults to 512 MiB. */
+  void
+  SetMaximumSize(SizeValueType maximumSize);
+  SizeValueType
+  GetMaximumSize() const;
+
+  /** Size, in bytes, of the cached sections. */
+  SizeValueType
+  GetSize() const;
+
+  SizeValueType
+  GetNumberOfEntries() const;
+
+  SizeValueType
+  GetNumberOfHits() const;
+
+  SizeValueType
+  GetNumberOfMisses() const;
+
+protected:
+  MZ3GeometryCache() = default;
+  ~MZ3GeometryCache() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  struct KeyHash
+  {
+    size_t
+    operator()(const Key & key) const
+    {
+      return static_cast<size_t>(key.m_Hash);
+    }
+  };
+
+  using EntryList = std::list<std::pair<Key, GeometryConstPointer>>;
+
+  /** Evict least recently used entries until the size is within maximumSize. Requires m_Mutex. */
+  void
+  Shrink(SizeValueType maximumSize);
+
+  mutable std::mutex                                    m_Mutex;
+  EntryList                                             m_Entries;
+  std::unordered_map<Key, EntryList::iterator, KeyHash> m_Index;
+  SizeValueType                                         m_MaximumSize{ 512 * 1024 * 1024 };
+  SizeValueType                                         m_Size{ 0 };
+  SizeValueType                                         m_NumberOfHits{ 0 };
+  SizeValueType                                         m_NumberOfMisses{ 0 };
+};
+} // end namespace itk
+
+#endif
@@ -0,0 +1,187 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkMZ3MappedMesh_h
+#define itkMZ3MappedMesh_h
+#include "IOMeshMZ3Export.h"
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkPoint.h"
+
+#include <array>
+#include <string>
+
+namespace itk
+{
+/** \class MZ3MappedMesh
+ *
+ * \brief Read only view of the sections of an MZ3 file mapped into memory.
+ *
+ * Open() maps an uncompressed MZ3 file and only checks its header, so its cost does not grow
+ * with the mesh. The vertices, faces, colors and scalars are then read straight from the
+ * mapping, and the operating system pages them in as they are touched. Algorithms that visit
+ * part of a large surface neither decode nor hold the rest of it.
+ *
+ * A gzip compressed file is first inflated into the MZ3DecompressedCache in CacheDirectory,
+ * which is shared with MZ3MeshIO and bounded in size. If CacheDirectory is empty, it is
+ * inflated into CacheFileName instead, unless that is empty too, in which case the cache in
+ * MZ3DecompressedCache::GetDefaultDirectory() is used, so that the inflated copies of changed
+ * or removed files are evicted. An existing CacheFileName that is newer than the compressed
+ * file is mapped without inflating. Files are inflated under a unique temporary name and
+ * renamed once complete, so concurrent Open() calls never map a partial file.
+ *
+ * The views remain valid until Close(), the next Open() or the destruction of the object.
+ * The coordinate and index pointers are aligned for float and uint32_t access when the skip
+ * section is a multiple of 4 bytes long, as it is in files written by MZ3MeshIO. GetPoint()
+ * and GetFace() do not depend on the alignment.
+ *
+ * \ingroup IOMeshMZ3
+ */
+class IOMeshMZ3_EXPORT MZ3MappedMesh : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(MZ3MappedMesh);
+
+  /** Standard class type aliases. */
+  using Self = MZ3MappedMesh;
+  using Superclass = Object;
+  using ConstPointer = SmartPointer<const Self>;
+  using Pointer = SmartPointer<Self>;
+
+  using PointType = Point<float, 3>;
+  using FaceType = std::array<uint32_t, 3>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** \see LightObject::GetNameOfClass() */
+  itkOverrideGetNameOfClassMacro(MZ3MappedMesh);
+
+  itkSetStringMacro(FileName);
+  itkGetStringMacro(FileName);
+
+  /** Where a compressed file is inflated to. Empty chooses the default MZ3DecompressedCache. */
+  itkSetStringMacro(CacheFileName);
+  itkGetStringMacro(CacheFileName);
+
+  /** Directory of an MZ3DecompressedCache that compressed files are inflated into. When set, it
+   * takes precedence over CacheFileName. */
+  itkSetStringMacro(CacheDirectory);
+  itkGetStringMacro(CacheDirectory);
+
+  /** Map the file, after inflating it if it is compressed. Throws if it is not a valid MZ3 file. */
+  void
+  Open();
+
+  /** Unmap the file. */
+  void
+  Close();
+
+  bool
+  IsOpen() const
+  {
+    return m_Data != nullptr;
+  }
+
+  /** The file that is mapped, which is the cache file for a compressed file. */
+  itkGetStringMacro(MappedFileName);
+
+  /** Attribute flags of the MZ3 header. */
+  itkGetConstMacro(Attributes, uint16_t);
+
+  itkGetConstMacro(NumberOfPoints, SizeValueType);
+  itkGetConstMacro(NumberOfFaces, SizeValueType);
+
+  /** Number of scalar layers of NumberOfPoints values each. */
+  itkGetConstMacro(NumberOfScalarLayers, SizeValueType);
+
+  /** Coordinates (x, y, z per vertex), or nullptr if the file has no vertices. */
+  const float *
+  GetPoints() const
+  {
+    return reinterpret_cast<const float *>(m_Points);
+  }
+
+  /** Vertex indices (3 per triangle), or nullptr if the file has no faces. */
+  const uint32_t *
+  GetFaces() const
+  {
+    return reinterpret_cast<const uint32_t *>(m_Faces);
+  }
+
+  /** RGBA colors (4 bytes per vertex), or nullptr if the file has none. */
+  const uint8_t *
+  GetColors() const
+  {
+    return m_Colors;
+  }
+
+  /** Scalar layers, stored as doubles if IsDoubleScalar() and as floats otherwise, or nullptr
+   * if the file has none. */
+  const void *
+  GetScalars() const
+  {
+    return m_Scalars;
+  }
+
+  bool
+  IsDoubleScalar() const
+  {
+    return (m_Attributes & 16) != 0;
+  }
+
+  PointType
+  GetPoint(SizeValueType pointId) const;
+
+  FaceType
+  GetFace(SizeValueType faceId) const;
+
+protected:
+  MZ3MappedMesh() = default;
+  ~MZ3MappedMesh() override;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+  /** Inflate the compressed file into CacheFileName unless it is already up to date. */
+  void
+  UpdateCacheFile();
+
+private:
+  std::string   m_FileName{};
+  std::string   m_CacheFileName{};
+  std::string   m_CacheDirectory{};
+  std::string   m_MappedFileName{};
+  uint16_t      m_Attributes{ 0 };
+  SizeValueType m_NumberOfPoints{ 0 };
+  SizeValueType m_NumberOfFaces{ 0 };
+  SizeValueType m_NumberOfScalarLayers{ 0 };
+
+  const uint8_t * m_Data{ nullptr };
+  SizeValueType   m_Size{ 0 };
+  const uint8_t * m_Points{ nullptr };
+  const uint8_t * m_Faces{ nullptr };
+  const uint8_t * m_Colors{ nullptr };
+  const uint8_t * m_Scalars{ nullptr };
+#ifdef _WIN32
+  void * m_MappingHandle{ nullptr };
+#endif
+};
+} // end namespace itk
+
+#endif
@@ -0,0 +1,119 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkMZ3MeshComparator_h
+#define itkMZ3MeshComparator_h
+#include "IOMeshMZ3Export.h"
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+
+#include <string>
+#include <vector>
+
+namespace itk
+{
+/** \class MZ3MeshComparator
+ *
+ * \brief Compare two MZ3 files section by section without building meshes.
+ *
+ * Both files, raw or gzip compressed, are decoded concurrently in blocks, and each pair of
+ * blocks is compared before the next is decoded, so memory use does not grow with the mesh.
+ * Faces and colors must match exactly. Vertex coordinates and scalars may differ by up to
+ * CoordinateTolerance and ScalarTolerance; with a tolerance of zero, their bits must match.
+ * The skip sections are not compared.
+ *
+ * For every section, the comparison reports the number of values, the number of differing
+ * values, the index of the first one and the maximum absolute difference.
+ *
+ * \ingroup IOMeshMZ3
+ */
+class IOMeshMZ3_EXPORT MZ3MeshComparator : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(MZ3MeshComparator);
+
+  /** Standard class type aliases. */
+  using Self = MZ3MeshComparator;
+  using Superclass = Object;
+  using ConstPointer = SmartPointer<const Self>;
+  using Pointer = SmartPointer<Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** \see LightObject::GetNameOfClass() */
+  itkOverrideGetNameOfClassMacro(MZ3MeshComparator);
+
+  /** Outcome of the comparison of one section. */
+  struct SectionComparison
+  {
+    std::string   m_Name;
+    SizeValueType m_NumberOfValues{ 0 };
+    SizeValueType m_NumberOfDifferences{ 0 };
+    // Index of the first differing value, if any.
+    SizeValueType m_FirstDifference{ 0 };
+    double        m_MaximumError{ 0.0 };
+  };
+
+  itkSetStringMacro(BaselineFileName);
+  itkGetStringMacro(BaselineFileName);
+
+  itkSetStringMacro(TestFileName);
+  itkGetStringMacro(TestFileName);
+
+  /** Largest absolute difference of vertex coordinates that is not reported. Defaults to 0. */
+  itkSetMacro(CoordinateTolerance, double);
+  itkGetConstMacro(CoordinateTolerance, double);
+
+  /** Largest absolute difference of scalars that is not reported. Defaults to 0. */
+  itkSetMacro(ScalarTolerance, double);
+  itkGetConstMacro(ScalarTolerance, double);
+
+  /** Compare the files. Returns true if no section differs. If the headers differ in their
+   * attributes or numbers of faces or vertices, only a "Header" section is reported. */
+  bool
+  Compare();
+
+  /** The sections compared by the last call to Compare(). */
+  const std::vector<SectionComparison> &
+  GetSections() const
+  {
+    return m_Sections;
+  }
+
+  /** Print one line per section compared by the last call to Compare(). */
+  void
+  PrintReport(std::ostream & os) const;
+
+protected:
+  MZ3MeshComparator() = default;
+  ~MZ3MeshComparator() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  std::string                    m_BaselineFileName{};
+  std::string                    m_TestFileName{};
+  double                         m_CoordinateTolerance{ 0.0 };
+  double                         m_ScalarTolerance{ 0.0 };
+  std::vector<SectionComparison> m_Sections{};
+};
+} // end namespace itk
+
+#endif
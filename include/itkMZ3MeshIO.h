@@ -19,15 +19,63 @@
 #define itkMZ3MeshIO_h
 #include "IOMeshMZ3Export.h"
 
+#include "itkMatrix.h"
 #include "itkMeshIOBase.h"
+#include "itkMultiThreaderBase.h"
+#include "itkMZ3Archive.h"
+#include "itkMZ3GeometryCache.h"
+#include "itkMZ3SpatialIndex.h"
 #include "itk_zlib.h"
 
+#include <algorithm>
 #include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace itk
 {
 class MZ3MeshIOInternals;
 
+/** \class MZ3MeshIOEnums
+ * \brief Contains all enum classes used by MZ3MeshIO class.
+ * \ingroup IOMeshMZ3
+ */
+class MZ3MeshIOEnums
+{
+public:
+  /** \ingroup IOMeshMZ3
+   * Whether Write() waits for the written file to reach the storage device. */
+  enum class Durability : uint8_t
+  {
+    /** Leave writing the file back to the operating system. */
+    None,
+    /** Flush the file to the storage device before Write() returns. */
+    Sync
+  };
+
+  /** \ingroup IOMeshMZ3
+   * Where the pages of the buffers filled by ReadPoints(), ReadCells() and ReadPointData() are
+   * placed on machines with several NUMA nodes. */
+  enum class MemoryPlacement : uint8_t
+  {
+    /** Leave placement to the thread that fills the buffer. */
+    Default,
+    /** Touch the buffer first in one contiguous range per work unit, as MultiThreaderBase splits
+     * arrays, so that every range is placed on the node of the thread that will process it. */
+    FirstTouch,
+    /** Interleave the pages across all nodes with libnuma, or fall back to FirstTouch if it is
+     * not available. */
+    Interleaved
+  };
+};
+// Define how to print enumeration
+extern IOMeshMZ3_EXPORT std::ostream &
+                        operator<<(std::ostream & out, const MZ3MeshIOEnums::Durability value);
+extern IOMeshMZ3_EXPORT std::ostream &
+                        operator<<(std::ostream & out, const MZ3MeshIOEnums::MemoryPlacement value);
+
 /** \class MZ3MeshIO
  *
  * \brief Read and write the MZ3 triangle mesh file format.
@@ -47,6 +95,9 @@ class MZ3MeshIOInternals;
  * - 4 bytes per vertex: vertex scalars (optional)
  * - 8 bytes per vertex: vertex scalars (optional)
  *
+ * A file name of the form "atlas.mz3a:entry" reads the entry named entry of the MZ3Archive
+ * atlas.mz3a. The index of the archive is read once and kept for the following entries.
+ *
  * This implementation currently only supports reading and writing from little endian systems.
  *
  * \ingroup IOFilters
@@ -66,6 +117,8 @@ public:
 
   using StreamOffsetType = Superclass::StreamOffsetType;
   using SizeValueType = Superclass::SizeValueType;
+  using DurabilityEnum = MZ3MeshIOEnums::Durability;
+  using MemoryPlacementEnum = MZ3MeshIOEnums::MemoryPlacement;
 
   /** Method for creation through the object factory. */
   itkNewMacro(Self);
@@ -99,6 +152,185 @@ public:
   void
   ReadCellData(void * buffer) override;
 
+  /** Decompress gzip compressed files with MZ3ParallelGzipDecompressor instead of zlib.
+   * The whole file is read and decompressed by ReadMeshInformation(), and the sections are
+   * then copied from memory. This pays off for large files on machines with many cores.
+   * Off by default. */
+  itkSetMacro(UseParallelDecompression, bool);
+  itkGetConstMacro(UseParallelDecompression, bool);
+  itkBooleanMacro(UseParallelDecompression);
+
+  /** Sections of uncompressed files of at least this many bytes are split into aligned chunks
+   * that are read concurrently with pread(), which keeps several requests in flight on fast
+   * storage. Zero reads every section with a single stream read. Defaults to 16 MiB. Not
+   * available on Windows. */
+  itkSetMacro(ParallelReadMinimumSize, SizeValueType);
+  itkGetConstMacro(ParallelReadMinimumSize, SizeValueType);
+
+  /** Bypass the page cache (O_DIRECT) for the concurrent reads of large sections. Every work
+   * unit reads whole aligned blocks into an aligned buffer and copies the requested bytes out.
+   * Falls back to cached reads where the file system does not support it. Linux only. Off by
+   * default. */
+  itkSetMacro(UseDirectIO, bool);
+  itkGetConstMacro(UseDirectIO, bool);
+  itkBooleanMacro(UseDirectIO);
+
+  /** Read the mesh from the size bytes at buffer instead of from the file. The buffer may
+   * hold raw or gzip compressed MZ3 data. Compressed data is inflated from memory; raw
+   * sections are copied straight from the buffer, which must remain valid until reading is
+   * complete. A MeshFileReader still requires a file name, but the file is not accessed.
+   * Pass nullptr to read from the file again. */
+  void
+  SetInputBuffer(const void * buffer, SizeValueType size);
+
+  /** Build an MZ3SpatialIndex over the vertices and triangles as they are read. The vertices
+   * and faces are copied as ReadPoints() and ReadCells() decode them, and both trees are built
+   * concurrently at the end of ReadCells() by an index that takes the copies over. Files without
+   * a vertex section are not indexed. Off by default. */
+  itkSetMacro(BuildSpatialIndex, bool);
+  itkGetConstMacro(BuildSpatialIndex, bool);
+  itkBooleanMacro(BuildSpatialIndex);
+
+  /** Sidecar file for the spatial index. When set, an index stored in this file for the same
+   * geometry is read instead of built, and a newly built index is written to it. */
+  itkSetStringMacro(SpatialIndexFileName);
+  itkGetStringMacro(SpatialIndexFileName);
+
+  /** The spatial index of the mesh that was read last, or nullptr if BuildSpatialIndex is off. */
+  MZ3SpatialIndex *
+  GetSpatialIndex();
+
+  /** Compute area weighted vertex normals and triangle areas in ReadCells(), in the same
+   * threaded pass that expands the triangles into the cell buffer. Every work unit accumulates
+   * into its own normals, which are then summed and normalized. Off by default. */
+  itkSetMacro(ComputeNormalsAndAreas, bool);
+  itkGetConstMacro(ComputeNormalsAndAreas, bool);
+  itkBooleanMacro(ComputeNormalsAndAreas);
+
+  /** Unit normal (x, y, z) of every vertex of the mesh that was read last. Vertices that belong
+   * to no triangle of nonzero area have a zero normal. Empty unless ComputeNormalsAndAreas is on. */
+  const std::vector<float> &
+  GetVertexNormals() const;
+
+  /** Area of every triangle of the mesh that was read last. Empty unless ComputeNormalsAndAreas is on. */
+  const std::vector<float> &
+  GetFaceAreas() const;
+
+  /** Build the faces around every vertex and the neighbors of every vertex in ReadCells(), as
+   * compressed sparse rows, straight from the faces with a parallel counting sort. They take
+   * 8 bytes per vertex and 4 bytes per entry each, far less than the cell links of a mesh.
+   * Off by default. */
+  itkSetMacro(ComputeAdjacency, bool);
+  itkGetConstMacro(ComputeAdjacency, bool);
+  itkBooleanMacro(ComputeAdjacency);
+
+  /** The faces of vertex i of the mesh that was read last are GetVertexFaces()[j] for j from
+   * GetVertexFaceOffsets()[i] up to GetVertexFaceOffsets()[i + 1], in increasing order. Empty
+   * unless ComputeAdjacency is on. */
+  const std::vector<SizeValueType> &
+  GetVertexFaceOffsets() const;
+
+  const std::vector<uint32_t> &
+  GetVertexFaces() const;
+
+  /** The vertices that share an edge with vertex i, in increasing order, laid out as
+   * GetVertexFaces(). Empty unless ComputeAdjacency is on. */
+  const std::vector<SizeValueType> &
+  GetVertexNeighborOffsets() const;
+
+  const std::vector<uint32_t> &
+  GetVertexNeighbors() const;
+
+  /** Reduce the peak memory of reading. ReadCells() reads the faces into the tail of the cell
+   * buffer and expands them in place instead of through a temporary buffer of 12 bytes per face,
+   * and vertex normals are accumulated by a single work unit instead of one copy per work unit.
+   * Off by default. */
+  itkSetMacro(LowMemoryReading, bool);
+  itkGetConstMacro(LowMemoryReading, bool);
+  itkBooleanMacro(LowMemoryReading);
+
+  /** Directory of an MZ3DecompressedCache for gzip compressed files. When set, a compressed
+   * file is inflated into the directory on its first read, and then read from there like an
+   * uncompressed file by every process that shares the directory. Empty by default. */
+  itkSetStringMacro(DecompressedCacheDirectory);
+  itkGetStringMacro(DecompressedCacheDirectory);
+
+  /** Upper bound, in bytes, on the size of the decompressed cache. Least recently used files
+   * are removed beyond it. Defaults to 4 GiB. */
+  itkSetMacro(DecompressedCacheMaximumSize, SizeValueType);
+  itkGetConstMacro(DecompressedCacheMaximumSize, SizeValueType);
+
+  /** Share the vertices and faces through the process wide MZ3GeometryCache. They are keyed by
+   * the header fields that describe them and a hash of their sections, so overlays that share a
+   * surface but hold different point data share one entry. The sections are read once, hashed
+   * block by block as they arrive, and replaced by the cached copy on a hit whose sections match
+   * them. Sections that are in memory are hashed in place and only copied on a miss. Decoded
+   * geometry is added to the cache. Off by default. */
+  itkSetMacro(UseGeometryCache, bool);
+  itkGetConstMacro(UseGeometryCache, bool);
+  itkBooleanMacro(UseGeometryCache);
+
+  /** The immutable vertices and faces of the mesh that was read last, shared with the geometry
+   * cache, or nullptr if UseGeometryCache is off. */
+  MZ3GeometryCache::GeometryConstPointer
+  GetGeometry() const;
+
+  /** Placement of the pages of the point, cell and point data buffers as they are read. With
+   * FirstTouch or Interleaved, sections copied from memory and the expansion of faces into cells
+   * are split across the work units in the ranges that the buffer was placed in. Sections read
+   * sequentially from a file or gzip stream land in pages that were placed beforehand. Defaults
+   * to Default. */
+  itkSetEnumMacro(MemoryPlacement, MemoryPlacementEnum);
+  itkGetConstMacro(MemoryPlacement, MemoryPlacementEnum);
+
+  /** Ask for transparent huge pages for the buffers of large sections, which reduces TLB misses
+   * when they are traversed. Linux only. Off by default. */
+  itkSetMacro(UseHugePages, bool);
+  itkGetConstMacro(UseHugePages, bool);
+  itkBooleanMacro(UseHugePages);
+
+  /** Affine transform of the points, as a homogeneous matrix whose last row is 0 0 0 1.
+   * ReadPoints() applies it as it copies or reads the vertices and WritePoints() as it converts
+   * them for encoding, so that no separate pass over the points is needed. A diagonal matrix of
+   * 1 and -1, such as diag(-1, -1, 1, 1) between RAS and LPS, only negates coordinates. When the
+   * determinant is negative, the winding of the faces is reversed as they are read or written,
+   * so that they keep facing outward. Spatial chunk bounds and region reads stay in the
+   * coordinates of the file. Defaults to the identity, which leaves the points untouched. */
+  using PointTransformType = Matrix<double, 4, 4>;
+  void
+  SetPointTransform(const PointTransformType & transform);
+  itkGetConstReferenceMacro(PointTransform, PointTransformType);
+
+  /** Level of detail to read, of a mesh written with LevelOfDetailFractions. Level zero reads
+   * the file itself, and level N the file or archive entry named by GetLevelOfDetailFileName(),
+   * so that a coarse proxy is read without touching the full mesh. Defaults to 0. */
+  itkSetMacro(LevelOfDetail, unsigned int);
+  itkGetConstMacro(LevelOfDetail, unsigned int);
+
+  /** Name of level level of fileName: "mesh_lodN.mz3" for "mesh.mz3", and
+   * "archive.mz3a:mesh_lodN" for "archive.mz3a:mesh". Level zero is fileName itself. */
+  static std::string
+  GetLevelOfDetailFileName(const std::string & fileName, unsigned int level);
+
+  /** Scalar-only MZ3 file, without faces or vertices, whose scalars are read as the point data
+   * of the mesh instead of any point data of FileName, such as a map written with
+   * WriteScalarsOnly for geometry that is stored once. ReadMeshInformation() checks that it
+   * holds one value per vertex of the mesh. Its first scalar layer is read. Empty by default. */
+  itkSetStringMacro(PointDataFileName);
+  itkGetStringMacro(PointDataFileName);
+
+  /** Sections are read and written in chunks of this many bytes, after each of which a
+   * ProgressEvent reports NumberOfBytesProcessed out of NumberOfBytesToProcess, the decoded size
+   * of the file, and AbortGenerateData is checked. An abort throws ProcessAborted, and a write
+   * that is aborted or fails removes its partial output file, or clears its output buffer.
+   * ReadMeshInformation() and WriteMeshInformation() clear AbortGenerateData, as an update of a
+   * ProcessObject does. Concurrent reads and writes take at least one chunk of
+   * ParallelChunkSize bytes per thread at a time. Defaults to 16 MiB. */
+  itkSetClampMacro(SectionChunkSize, SizeValueType, 1, std::numeric_limits<SizeValueType>::max());
+  itkGetConstMacro(SectionChunkSize, SizeValueType);
+  itkGetConstMacro(NumberOfBytesProcessed, SizeValueType);
+  itkGetConstMacro(NumberOfBytesToProcess, SizeValueType);
+
   /*-------- This part of the interfaces deals with writing data. ----- */
 
   /** Determine if the file can be written with this MeshIO implementation.
@@ -129,6 +361,181 @@ public:
   void
   Write() override;
 
+  /** Write the mesh into buffer instead of to the file. The buffer is cleared, reserved for
+   * the size computed from the mesh information, and holds the complete raw or gzip
+   * compressed MZ3 data after Write(). A MeshFileWriter still requires a file name, but the
+   * file is not created. Pass nullptr to write to the file again. */
+  void
+  SetOutputBuffer(std::vector<uint8_t> * buffer);
+
+  /** Sections of at least this many bytes are split into chunks that are written concurrently
+   * when writing uncompressed files. Zero writes every section at once. Defaults to 16 MiB. */
+  itkSetMacro(ParallelWriteMinimumSize, SizeValueType);
+  itkGetConstMacro(ParallelWriteMinimumSize, SizeValueType);
+
+  /** Quadrilaterals and polygons are written as triangles. A polygon of n points becomes a fan
+   * of n - 2 triangles around its first point, which keeps the orientation and assumes that the
+   * polygon is convex. When this is on, quadrilaterals are instead split along their shorter
+   * diagonal, which yields better shaped triangles but keeps a copy of the vertices while
+   * writing uncompressed files. Off by default. */
+  itkSetMacro(SplitQuadsAlongShortestDiagonal, bool);
+  itkGetConstMacro(SplitQuadsAlongShortestDiagonal, bool);
+  itkBooleanMacro(SplitQuadsAlongShortestDiagonal);
+
+  /** Summary of the sections of an MZ3 file, stored in its skip region by the writer. */
+  struct Summary
+  {
+    /** Minimum, maximum and histogram of the values of a scalar layer, ignoring NaN. The
+     * histogram bins divide [minimum, maximum] evenly. */
+    struct Layer
+    {
+      double                m_Minimum{ 0.0 };
+      double                m_Maximum{ 0.0 };
+      std::vector<uint32_t> m_Histogram;
+    };
+
+    // Sizes, in bytes, and CRC-32 checksums of the uncompressed sections.
+    SizeValueType m_FaceSectionSize{ 0 };
+    SizeValueType m_VertexSectionSize{ 0 };
+    SizeValueType m_PointDataSectionSize{ 0 };
+    uint32_t      m_FaceChecksum{ 0 };
+    uint32_t      m_VertexChecksum{ 0 };
+    uint32_t      m_PointDataChecksum{ 0 };
+    // Minimum x, maximum x, minimum y, maximum y, minimum z and maximum z of the vertices.
+    float              m_Bounds[6]{};
+    std::vector<Layer> m_Layers;
+  };
+
+  /** Write only the point data, as a scalar-only MZ3 file without face or vertex sections that
+   * holds one value per point, so that the maps derived from a mesh do not repeat its geometry.
+   * WritePoints() and WriteCells() then write nothing. Read the map with PointDataFileName
+   * to pair it with the geometry. Off by default. */
+  itkSetMacro(WriteScalarsOnly, bool);
+  itkGetConstMacro(WriteScalarsOnly, bool);
+  itkBooleanMacro(WriteScalarsOnly);
+
+  /** Store a Summary of the mesh in the skip region of the file, which readers of the MZ3 format
+   * ignore. The skip region holds a versioned container of tagged blocks, "ITKX", whose "SUMM"
+   * block holds the summary. For compressed output, the sections are held back until the summary
+   * is complete, because it precedes them in the stream. Off by default. */
+  itkSetMacro(WriteSummary, bool);
+  itkGetConstMacro(WriteSummary, bool);
+  itkBooleanMacro(WriteSummary);
+
+  /** Number of histogram bins of every scalar layer of the summary. Defaults to 16. */
+  itkSetClampMacro(NumberOfSummaryHistogramBins, unsigned int, 1, 4096);
+  itkGetConstMacro(NumberOfSummaryHistogramBins, unsigned int);
+
+  /** The summary stored in the file that was read last, or nullptr if it holds none. Scalar
+   * layers appended by AppendScalarLayers() after the file was written are not summarized. */
+  const Summary *
+  GetSummary() const;
+
+  /** Read the summary of fileName from the start of the file, without decoding the sections.
+   * Returns false if the file holds no summary. */
+  static bool
+  ReadSummary(const std::string & fileName, Summary & summary);
+
+  /** Read the 16 byte MZ3 header of the file to read, without decoding any section. The header
+   * of an archive entry is taken from the index of the archive, which is kept open for reading
+   * the entry. Returns false if the file holds no MZ3 data. */
+  bool
+  ReadHeader(uint8_t header[16]);
+
+  /** A chunk of the faces of a file written with WriteSpatialChunks, and the points that its
+   * faces are the first to refer to. */
+  struct SpatialChunk
+  {
+    // Minimum x, maximum x, minimum y, maximum y, minimum z and maximum z of the points of the faces.
+    float    m_Bounds[6]{};
+    uint32_t m_FirstFace{ 0 };
+    uint32_t m_NumberOfFaces{ 0 };
+    uint32_t m_FirstPoint{ 0 };
+    uint32_t m_NumberOfPoints{ 0 };
+  };
+
+  /** Part of a mesh read by ReadRegionInBox() or ReadRegionInSphere(). */
+  struct RegionMesh
+  {
+    // Coordinates (x, y, z per point) of the points of the faces.
+    std::vector<float> m_Points;
+    // Indices into m_Points, 3 per triangle.
+    std::vector<uint32_t> m_Faces;
+    // Index in the file of every point, to look up its point data.
+    std::vector<uint32_t> m_PointIds;
+  };
+
+  /** Order the faces into spatial chunks when writing, so that parts of the mesh can be read on
+   * their own. The faces are split at the median of their centroids along the longest axis until
+   * no chunk holds more than MaximumFacesPerSpatialChunk faces, and the points are renumbered in
+   * the order that the chunks first refer to them, which reorders the point data too. The bounds
+   * and ranges of every chunk are stored in a "CHNK" block of the ITKX container in the skip
+   * region, so the file remains a valid MZ3 file. Off by default. */
+  itkSetMacro(WriteSpatialChunks, bool);
+  itkGetConstMacro(WriteSpatialChunks, bool);
+  itkBooleanMacro(WriteSpatialChunks);
+
+  /** Defaults to 65536. */
+  itkSetClampMacro(MaximumFacesPerSpatialChunk, SizeValueType, 1, std::numeric_limits<SizeValueType>::max());
+  itkGetConstMacro(MaximumFacesPerSpatialChunk, SizeValueType);
+
+  /** The spatial chunks of the file that was read last, empty if it has none. */
+  const std::vector<SpatialChunk> &
+  GetSpatialChunks() const;
+
+  /** Read the faces of the chunks whose bounds overlap the box, given as minimum x, maximum x,
+   * minimum y, maximum y, minimum z and maximum z, and the points they refer to, renumbered from
+   * zero. Only these sections of the file are decoded. A file without spatial chunks is read as
+   * a single chunk that overlaps every box. Call after ReadMeshInformation(). */
+  void
+  ReadRegionInBox(const float bounds[6], RegionMesh & region);
+
+  /** As ReadRegionInBox(), for the chunks whose bounds overlap the sphere. */
+  void
+  ReadRegionInSphere(const float center[3], float radius, RegionMesh & region);
+
+  /** Whether Write() flushes the file to the storage device. Defaults to None. */
+  itkSetEnumMacro(Durability, DurabilityEnum);
+  itkGetConstMacro(Durability, DurabilityEnum);
+
+  /** Also write a level of detail pyramid: level N + 1 holds about LevelOfDetailFractions[N] of
+   * the points, for example { 0.25, 0.06 }, and each fraction must be in (0, 1). The levels are
+   * built concurrently by DecimateMZ3Mesh() from the points and triangles kept while writing,
+   * and written by Write() once the mesh is. Point data is resampled onto every level as the
+   * mean of the values of the points merged into each point. Unless LevelOfDetailArchiveFileName
+   * is set, level N is written next to the file, as GetLevelOfDetailFileName() names it, with
+   * the same compression. An aborted or failed write of the mesh removes the mesh along with
+   * every level or the archive. Levels that fail to be written once the mesh is complete are
+   * removed, or the archive is, and the mesh is kept. Empty by default. */
+  void
+  SetLevelOfDetailFractions(const std::vector<double> & fractions);
+  itkGetConstReferenceMacro(LevelOfDetailFractions, std::vector<double>);
+
+  /** Write the mesh and its levels of detail as the entries of a new MZ3Archive of this name
+   * instead: the mesh as the file name without its directory and extension, for example "mesh",
+   * and level N as "mesh_lodN". The file itself is still written. Empty by default. */
+  itkSetStringMacro(LevelOfDetailArchiveFileName);
+  itkGetStringMacro(LevelOfDetailArchiveFileName);
+
+  /** Append numberOfLayers scalar layers, each holding one value per vertex, to the existing
+   * MZ3 file fileName without rewriting its geometry. The layers are stored as doubles if the
+   * file holds double scalars, and as floats otherwise.
+   *
+   * Uncompressed files are appended to in place, setting the scalar flag of the header if the
+   * file had no scalars. If appending fails, the file is truncated back to its original size. As
+   * in the MZ3 specification, the number of layers follows from the size of the scalar section,
+   * so a crash while appending to an uncompressed file leaves at most a partial layer after the
+   * last whole one. Readers only read whole layers, and the next append truncates the partial
+   * layer before it writes.
+   *
+   * A torn gzip member cannot be recovered, so gzip compressed files are written to a uniquely
+   * named temporary file that replaces the original once it is complete: a copy of a file with
+   * scalars with the layers as an additional gzip member, or a file without scalars, whose flag
+   * is inside the first member, decompressed, patched and recompressed. A crash leaves the
+   * original intact, and of concurrent appends to one compressed file only the last is kept. */
+  static void
+  AppendScalarLayers(const std::string & fileName, const float * layers, SizeValueType numberOfLayers);
+
 protected:
 protected:
   MZ3MeshIO();
@@ -144,47 +551,177 @@ protected:
     uint16_t           m_Attributes{ 0 };
     uint32_t           m_Skip{ 0 };
     std::vector<float> m_VertexBuffer;
+    // Number of triangles in the face section, which differs from the number of cells when
+    // polygons are written.
+    SizeValueType m_NumberOfFaces{ 0 };
+    // File that is read, which LevelOfDetail may redirect from the file name.
+    std::string m_InputFileName;
+    // Summary that was read, or that is accumulated while writing.
+    Summary m_Summary;
+    bool    m_HasSummary{ false };
+    // Spatial chunks that were read, or that are written, and the file index of every written
+    // point in chunk order.
+    std::vector<SpatialChunk> m_SpatialChunks;
+    std::vector<uint32_t>     m_PointOrder;
+    // Compressed output held back until the skip region is written.
+    std::vector<uint8_t> m_DeferredOutput;
+    bool                 m_IsDeferringOutput{ false };
+    // Decoded file contents, when the sections are read from memory.
+    std::vector<uint8_t> m_Payload;
+    // Contents of the archive entry that is read.
+    std::vector<uint8_t> m_ArchiveEntry;
+    const uint8_t *      m_PayloadData{ nullptr };
+    SizeValueType        m_PayloadSize{ 0 };
+    // Rows of the point transform without the last, and whether it changes the points, only
+    // negates coordinates, or reverses the winding of the faces.
+    double m_PointTransformMatrix[12]{ 1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0 };
+    bool   m_IsTransformingPoints{ false };
+    bool   m_IsFlippingAxes{ false };
+    bool   m_IsReversingWinding{ false };
+    // Vertices and faces kept from ReadPoints() and ReadCells() for the spatial index.
+    std::vector<float>    m_Points;
+    std::vector<uint32_t> m_Faces;
+    std::vector<float>    m_VertexNormals;
+    std::vector<float>    m_FaceAreas;
+    // Adjacency of the vertices, as compressed sparse rows.
+    std::vector<SizeValueType> m_VertexFaceOffsets;
+    std::vector<uint32_t>      m_VertexFaces;
+    std::vector<SizeValueType> m_VertexNeighborOffsets;
+    std::vector<uint32_t>      m_VertexNeighbors;
+    // Shared geometry, when the geometry cache is used.
+    MZ3GeometryCache::GeometryConstPointer m_Geometry;
+    // Descriptors for concurrent reads of uncompressed files, or -1.
+    int m_FileDescriptor{ -1 };
+    int m_DirectFileDescriptor{ -1 };
+    // Descriptor of the preallocated uncompressed output file, or -1.
+    int m_OutputFileDescriptor{ -1 };
+    // Triangles and point data, as doubles, kept while writing for the levels of detail.
+    bool                  m_IsWritingLevelsOfDetail{ false };
+    std::vector<uint32_t> m_LevelOfDetailFaces;
+    std::vector<double>   m_LevelOfDetailPointData;
+    // Whether the output is open for writing, and the number of processed bytes at which the
+    // next ProgressEvent is invoked.
+    bool          m_IsWriting{ false };
+    SizeValueType m_NextProgressReport{ 0 };
+    // Deflate state, which is ended when it is reset, and number of bytes written, when writing
+    // compressed data to memory.
+    struct DeflateStreamDeleter
+    {
+      void
+      operator()(z_stream * stream) const;
+    };
+    std::unique_ptr<z_stream, DeflateStreamDeleter> m_DeflateStream;
+    SizeValueType                                   m_OutputBufferSize{ 0 };
   };
 
+  /** Expand faces into cells as ReadCells() does, and compute the vertex normals and triangle
+   * areas from the vertices kept by ReadPoints(). If faces is nullptr, the cells are already
+   * expanded. */
+  void
+  ExpandCellsAndComputeNormals(const uint32_t * faces, uint32_t * cells);
+
+  /** Build the adjacency of the vertices from the faces, whose vertex ids are ids[i * stride]
+   * to ids[i * stride + 2]. */
+  void
+  UpdateAdjacency(const uint32_t * ids, SizeValueType stride);
+
+  /** Open archiveFileName into m_Archive, unless it is open and up to date. */
+  void
+  UpdateArchive(const std::string & archiveFileName);
+
+  /** Find the geometry described by header in the geometry cache, or decode and add it. */
+  void
+  ReadCachedGeometry(const uint8_t * header);
+
+  /** Read or build the spatial index from the vertices and faces kept while reading. */
+  void
+  UpdateSpatialIndex();
+
+  /** Read numberOfBytes bytes at offset in the decoded file into buffer. */
+  void
+  ReadBytes(StreamOffsetType offset, void * buffer, SizeValueType numberOfBytes);
+
+  /** Read numberOfBytes bytes at offset in the uncompressed file into buffer, in aligned chunks
+   * that are read concurrently. */
+  void
+  ReadBytesInParallel(StreamOffsetType offset, void * buffer, SizeValueType numberOfBytes);
+
+  /** Apply MemoryPlacement and UseHugePages to the numberOfBytes bytes at buffer before it is
+   * filled. Unless isFilledInParallel, the pages are touched here, one range per work unit. */
+  void
+  PlaceBuffer(void * buffer, SizeValueType numberOfBytes, bool isFilledInParallel);
+
+  /** Copy numberOfBytes bytes, split across the work units as PlaceBuffer() places them. */
+  void
+  CopyBytes(void * destination, const void * source, SizeValueType numberOfBytes);
+
+  /** Close the files and descriptors opened for reading. */
+  void
+  CloseInput();
+
+  /** Write float points, from the caller or transformed into the vertex buffer, as WritePoints()
+   * does. */
+  void
+  WriteFloatPoints(const float * points);
+
+  /** Write the summary and spatial chunks into the skip region, and write compressed output held
+   * back for them. */
+  void
+  WriteSkipRegion();
+
+  /** Order the triangulated faces into the spatial chunks, renumber the points to match, and
+   * write the faces and the points. */
+  void
+  WriteSpatiallyOrderedFaces(const std::vector<uint32_t> & faces);
+
+  /** Read the faces of chunks, and the points they refer to, into region. */
+  void
+  ReadSpatialChunks(std::vector<SpatialChunk> chunks, RegionMesh & region);
+
+  /** Build the levels of detail from the points, faces and point data kept while writing, and
+   * write them to their files or archive. */
+  void
+  WriteLevelsOfDetail();
+
+  /** Add numberOfBytes to NumberOfBytesProcessed, invoke a ProgressEvent once another
+   * SectionChunkSize bytes are processed, and throw ProcessAborted if AbortGenerateData is set. */
+  void
+  ReportBytes(SizeValueType numberOfBytes);
+
+  /** Close the output of an aborted or failed write and remove its file, or clear its output
+   * buffer, along with the files or archive of its levels of detail. Does nothing unless an
+   * output is open, so that neither an input nor a file that could not be opened is removed. */
+  void
+  RemovePartialOutput();
+
+  /** Remove the level of detail files, or archive, of the file being written. */
+  void
+  RemoveLevelsOfDetail();
+
+  /** Continue the CRC-32 checksum of a section with size bytes at data. */
+  static uint32_t
+  UpdateChecksum(uint32_t checksum, const void * data, SizeValueType size);
+
   template <typename T>
   void
   WritePoints(T * buffer)
   {
-    SizeValueType index{};
-    float         component{};
+    const SizeValueType numberOfComponents = this->m_NumberOfPoints * 3;
 
-    if (m_IsCompressed)
+    const bool isChunked = !m_Internal->m_SpatialChunks.empty();
+    if (m_IsCompressed || m_SplitQuadsAlongShortestDiagonal || isChunked || m_Internal->m_IsWritingLevelsOfDetail)
     {
-      // Write vertex coordinates
-      for (SizeValueType ii = 0; ii < this->m_NumberOfPoints; ++ii)
+      // Copy for deferred writing, for splitting quadrilaterals, for ordering into chunks, or for
+      // the levels of detail
+      for (SizeValueType ii = 0; ii < numberOfComponents; ++ii)
       {
-        for (unsigned int jj = 0; jj < 3; ++jj)
-        {
-          component = static_cast<float>(buffer[index]);
-          // Copy for deferred writing
-          m_Internal->m_VertexBuffer[index] = component;
-          ++index;
-        }
+        m_Internal->m_VertexBuffer[ii] = static_cast<float>(buffer[ii]);
       }
     }
-    else
+    if (!m_IsCompressed && !isChunked)
     {
-      // Skip header and optional skip bytes
-      m_Ofstream.seekp(16 + m_Internal->m_Skip);
-      // Skip faces if present
-      if (m_Internal->m_Attributes & 1)
-      {
-        m_Ofstream.seekp(m_NumberOfCells * 12, std::ios::cur);
-      }
-      // Write vertex coordinates
-      for (SizeValueType ii = 0; ii < this->m_NumberOfPoints; ++ii)
-      {
-        for (unsigned int jj = 0; jj < 3; ++jj)
-        {
-          component = static_cast<float>(buffer[index++]);
-          m_Ofstream.write(reinterpret_cast<char *>(&component), sizeof(float));
-        }
-      }
+      // Skip header, optional skip bytes and faces, and write vertex coordinates
+      this->WriteConverted<float>(this->GetVertexOffset(), buffer, numberOfComponents);
     }
   }
 
@@ -192,88 +729,228 @@ protected:
   void
   WriteCells(T * buffer)
   {
-    SizeValueType index{};
-    uint32_t      component;
-
-    if (m_IsCompressed)
+    // Cells are variable length, so find where every chunk of cells starts in the buffer, and
+    // the index of its first triangle, by striding over the cell headers
+    const SizeValueType        numberOfChunks = (m_NumberOfCells + CellsPerChunk - 1) / CellsPerChunk;
+    std::vector<SizeValueType> chunkIndex(numberOfChunks + 1);
+    std::vector<SizeValueType> chunkFace(numberOfChunks + 1);
+    SizeValueType              index = 0;
+    SizeValueType              numberOfFaces = 0;
+    for (SizeValueType i = 0; i < m_NumberOfCells; ++i)
     {
-      // Write face indices
-      for (SizeValueType i = 0; i < m_NumberOfCells; ++i)
+      if (i % CellsPerChunk == 0)
       {
-        [[maybe_unused]] const auto cellType = buffer[index++];
-        const auto                  numberOfPoints = buffer[index++];
-        if (numberOfPoints == 3)
-        {
-          for (unsigned int jj = 0; jj < 3; ++jj)
-          {
-            component = static_cast<uint32_t>(buffer[index++]);
-            gzwrite(m_Internal->m_GzFile, &component, sizeof(uint32_t));
-          }
-        }
-        else
-        {
-          itkExceptionMacro("Only triangles are supported");
-          // index += numberOfPoints;
-        }
+        chunkIndex[i / CellsPerChunk] = index;
+        chunkFace[i / CellsPerChunk] = numberOfFaces;
       }
-      // Write vertex coordinates
-      gzwrite(m_Internal->m_GzFile, m_Internal->m_VertexBuffer.data(), m_NumberOfPoints * 3 * sizeof(float));
+      const auto numberOfPoints = static_cast<SizeValueType>(buffer[index + 1]);
+      if (numberOfPoints < 3)
+      {
+        itkExceptionMacro("Only triangles, quadrilaterals and polygons are supported");
+      }
+      numberOfFaces += numberOfPoints - 2;
+      index += 2 + numberOfPoints;
     }
-    else
+    chunkIndex[numberOfChunks] = index;
+    chunkFace[numberOfChunks] = numberOfFaces;
+    if (numberOfFaces != m_Internal->m_NumberOfFaces)
     {
-      // Skip header and optional skip bytes
-      m_Ofstream.seekp(16 + m_Internal->m_Skip);
-      // Write face indices
-      for (SizeValueType i = 0; i < m_NumberOfCells; ++i)
-      {
-        [[maybe_unused]] const auto cellType = buffer[index++];
-        const auto                  numberOfPoints = buffer[index++];
-        if (numberOfPoints == 3)
-        {
-          for (unsigned int jj = 0; jj < 3; ++jj)
+      itkExceptionMacro("The cells hold " << numberOfFaces << " triangles, but the cell buffer size implies "
+                                          << m_Internal->m_NumberOfFaces);
+    }
+
+    // Triangulate a window of chunks concurrently, each into its own range of faces, and write
+    // the window before triangulating the next one. Faces ordered into spatial chunks are
+    // triangulated in a single window.
+    const bool            isChunked = !m_Internal->m_SpatialChunks.empty();
+    const SizeValueType   chunksPerWindow = isChunked ? std::max<SizeValueType>(1, numberOfChunks) : ChunksPerWindow;
+    const bool            isSplitAlongDiagonal = m_SplitQuadsAlongShortestDiagonal;
+    const bool            isReversingWinding = m_Internal->m_IsReversingWinding;
+    const float *         points = m_Internal->m_VertexBuffer.data();
+    const SizeValueType   numberOfPoints = m_NumberOfPoints;
+    std::vector<uint32_t> faces;
+    const auto            multiThreader = MultiThreaderBase::New();
+    // Skip header and optional skip bytes
+    StreamOffsetType offset = 16 + m_Internal->m_Skip;
+    for (SizeValueType windowBegin = 0; windowBegin < numberOfChunks; windowBegin += chunksPerWindow)
+    {
+      const SizeValueType windowEnd = std::min(numberOfChunks, windowBegin + chunksPerWindow);
+      faces.resize((chunkFace[windowEnd] - chunkFace[windowBegin]) * 3);
+      multiThreader->ParallelizeArray(
+        windowBegin,
+        windowEnd,
+        [&](SizeValueType chunk) {
+          uint32_t * const    firstFace = faces.data() + (chunkFace[chunk] - chunkFace[windowBegin]) * 3;
+          uint32_t *          face = firstFace;
+          SizeValueType       cellIndex = chunkIndex[chunk];
+          const SizeValueType lastCell = std::min(m_NumberOfCells, (chunk + 1) * CellsPerChunk);
+          for (SizeValueType i = chunk * CellsPerChunk; i < lastCell; ++i)
           {
-            component = static_cast<uint32_t>(buffer[index++]);
-            m_Ofstream.write(reinterpret_cast<char *>(&component), sizeof(uint32_t));
+            const auto cellSize = static_cast<SizeValueType>(buffer[cellIndex + 1]);
+            const T *  ids = buffer + cellIndex + 2;
+            const auto id = [ids](SizeValueType jj) { return static_cast<uint32_t>(ids[jj]); };
+            cellIndex += 2 + cellSize;
+            const auto isValid = [numberOfPoints](T ii) { return static_cast<SizeValueType>(ii) < numberOfPoints; };
+            if (cellSize == 4 && isSplitAlongDiagonal && std::all_of(ids, ids + 4, isValid))
+            {
+              const auto squaredDistance = [points](uint32_t a, uint32_t b) {
+                float distance = 0.0f;
+                for (unsigned int kk = 0; kk < 3; ++kk)
+                {
+                  const float difference = points[a * 3 + kk] - points[b * 3 + kk];
+                  distance += difference * difference;
+                }
+                return distance;
+              };
+              if (squaredDistance(id(1), id(3)) < squaredDistance(id(0), id(2)))
+              {
+                // Split along the diagonal from the second to the fourth point
+                const uint32_t split[6] = { id(0), id(1), id(3), id(1), id(2), id(3) };
+                std::copy(split, split + 6, face);
+                face += 6;
+                continue;
+              }
+            }
+            for (SizeValueType jj = 1; jj + 1 < cellSize; ++jj)
+            {
+              *face++ = id(0);
+              *face++ = id(jj);
+              *face++ = id(jj + 1);
+            }
           }
-        }
-        else
-        {
-          itkExceptionMacro("Only triangles are supported");
-          // index += numberOfPoints;
-        }
+          if (isReversingWinding)
+          {
+            for (uint32_t * reversed = firstFace; reversed != face; reversed += 3)
+            {
+              std::swap(reversed[1], reversed[2]);
+            }
+          }
+        },
+        nullptr);
+      if (m_Internal->m_IsWritingLevelsOfDetail)
+      {
+        m_Internal->m_LevelOfDetailFaces.insert(m_Internal->m_LevelOfDetailFaces.end(), faces.begin(), faces.end());
+      }
+      if (isChunked)
+      {
+        this->WriteSpatiallyOrderedFaces(faces);
+        return;
+      }
+      this->WriteBytes(offset, faces.data(), faces.size() * sizeof(uint32_t));
+      offset += faces.size() * sizeof(uint32_t);
+      if (m_Internal->m_HasSummary)
+      {
+        m_Internal->m_Summary.m_FaceChecksum = UpdateChecksum(
+          m_Internal->m_Summary.m_FaceChecksum, faces.data(), faces.size() * sizeof(uint32_t));
       }
     }
+
+    if (m_IsCompressed)
+    {
+      // Write vertex coordinates
+      this->WriteBytes(offset, m_Internal->m_VertexBuffer.data(), m_NumberOfPoints * 3 * sizeof(float));
+    }
   }
 
   template <typename T>
   void
   WritePointData(T * buffer)
   {
-    SizeValueType index{};
-    float         component{};
+    this->WriteConverted<float>(this->GetPointDataOffset(), buffer, this->m_NumberOfPointPixels);
+  }
 
-    if (m_IsCompressed)
-    {
-      for (SizeValueType ii = 0; ii < this->m_NumberOfPointPixels; ++ii)
-      {
-        component = static_cast<float>(buffer[index++]);
-        gzwrite(m_Internal->m_GzFile, &component, sizeof(float));
-      }
-    }
-    else
+  /** Convert count values of buffer to TOutput through a small block and write them at offset. */
+  template <typename TOutput, typename TInput>
+  void
+  WriteConverted(StreamOffsetType offset, const TInput * buffer, SizeValueType count)
+  {
+    TOutput block[ConversionBlockSize];
+    for (SizeValueType begin = 0; begin < count; begin += ConversionBlockSize)
     {
-      for (SizeValueType ii = 0; ii < this->m_NumberOfPointPixels; ++ii)
+      const SizeValueType blockCount = std::min<SizeValueType>(ConversionBlockSize, count - begin);
+      for (SizeValueType ii = 0; ii < blockCount; ++ii)
       {
-        component = static_cast<float>(buffer[index++]);
-        m_Ofstream.write(reinterpret_cast<char *>(&component), sizeof(float));
+        block[ii] = static_cast<TOutput>(buffer[begin + ii]);
       }
+      this->WriteBytes(offset + begin * sizeof(TOutput), block, blockCount * sizeof(TOutput));
     }
   }
 
+  /** Write numberOfBytes bytes of buffer at offset in the decoded file. Compressed output is
+   * sequential, so the sections must be written in file order. */
+  void
+  WriteBytes(StreamOffsetType offset, const void * buffer, SizeValueType numberOfBytes);
+
+  /** Write numberOfBytes bytes of buffer at offset in the uncompressed output file, in chunks
+   * that are written concurrently. */
+  void
+  WriteBytesInParallel(StreamOffsetType offset, const void * buffer, SizeValueType numberOfBytes);
+
+  /** Offsets of the vertex and point data sections in the decoded file. */
+  StreamOffsetType
+  GetVertexOffset() const;
+
+  StreamOffsetType
+  GetPointDataOffset() const;
+
+  static constexpr SizeValueType ConversionBlockSize = 4096;
+
+  /** Concurrent reads and writes split sections into chunks of ParallelChunkSize bytes. */
+  static constexpr SizeValueType ParallelChunkSize = 8 * 1024 * 1024;
+
+  /** WriteCells() triangulates chunks of CellsPerChunk cells concurrently, ChunksPerWindow
+   * chunks at a time. */
+  static constexpr SizeValueType CellsPerChunk = 16384;
+  static constexpr SizeValueType ChunksPerWindow = 64;
+
 private:
   std::ifstream m_Ifstream{};
   std::ofstream m_Ofstream{};
   bool          m_IsCompressed{};
+  bool          m_UseParallelDecompression{ false };
+  SizeValueType m_ParallelReadMinimumSize{ 16 * 1024 * 1024 };
+  bool          m_UseDirectIO{ false };
+  const void *  m_InputBuffer{ nullptr };
+  SizeValueType m_InputBufferSize{ 0 };
+
+  MZ3Archive::Pointer m_Archive{};
+
+  SizeValueType m_SectionChunkSize{ 16 * 1024 * 1024 };
+  SizeValueType m_NumberOfBytesProcessed{ 0 };
+  SizeValueType m_NumberOfBytesToProcess{ 0 };
+
+  std::vector<uint8_t> * m_OutputBuffer{ nullptr };
+  SizeValueType          m_ParallelWriteMinimumSize{ 16 * 1024 * 1024 };
+  DurabilityEnum         m_Durability{ DurabilityEnum::None };
+  bool                   m_SplitQuadsAlongShortestDiagonal{ false };
+  bool                   m_WriteScalarsOnly{ false };
+  bool                   m_WriteSummary{ false };
+  unsigned int           m_NumberOfSummaryHistogramBins{ 16 };
+  bool                   m_WriteSpatialChunks{ false };
+  SizeValueType          m_MaximumFacesPerSpatialChunk{ 65536 };
+
+  bool                     m_BuildSpatialIndex{ false };
+  std::string              m_SpatialIndexFileName{};
+  MZ3SpatialIndex::Pointer m_SpatialIndex{};
+
+  bool m_ComputeNormalsAndAreas{ false };
+  bool m_ComputeAdjacency{ false };
+  bool m_UseGeometryCache{ false };
+  bool m_LowMemoryReading{ false };
+
+  MemoryPlacementEnum m_MemoryPlacement{ MemoryPlacementEnum::Default };
+  bool                m_UseHugePages{ false };
+
+  PointTransformType m_PointTransform{};
+  unsigned int       m_LevelOfDetail{ 0 };
+
+  std::vector<double> m_LevelOfDetailFractions{};
+  std::string         m_LevelOfDetailArchiveFileName{};
+
+  std::string m_PointDataFileName{};
+
+  std::string   m_DecompressedCacheDirectory{};
+  SizeValueType m_DecompressedCacheMaximumSize{ SizeValueType{ 4 } * 1024 * 1024 * 1024 };
 
   const std::unique_ptr<MZ3MeshIOInternals> m_Internal;
 };
@@ -0,0 +1,80 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkMZ3OverlayMatrix_h
+#define itkMZ3OverlayMatrix_h
+#include "IOMeshMZ3Export.h"
+
+#include "itkIntTypes.h"
+
+#include <string>
+#include <vector>
+
+namespace itk
+{
+/** \struct MZ3OverlayMatrixOptions
+ *
+ * \brief Options for ReadMZ3OverlayMatrix().
+ *
+ * \ingroup IOMeshMZ3
+ */
+struct MZ3OverlayMatrixOptions
+{
+  /** Number of files decoded concurrently. Zero selects the global default number of threads. */
+  unsigned int NumberOfWorkUnits{ 0 };
+
+  /** Index of the scalar layer that is read from every file. */
+  SizeValueType Layer{ 0 };
+};
+
+/** Number of vertices of the MZ3 overlays in paths, read from their headers concurrently.
+ * Throws if a file cannot be read, holds no scalars, or has another number of vertices than
+ * the first file.
+ *
+ * \ingroup IOMeshMZ3
+ */
+extern IOMeshMZ3_EXPORT SizeValueType
+ReadMZ3OverlayNumberOfVertices(const std::vector<std::string> & paths,
+                               const MZ3OverlayMatrixOptions &  options = MZ3OverlayMatrixOptions());
+
+/** Read one scalar layer of every MZ3 overlay in paths into the rows of matrix, a preallocated
+ * row major array of paths.size() rows of numberOfVertices values, such as a subjects by
+ * vertices matrix of a group analysis on a template surface.
+ *
+ * Files are decoded concurrently, each straight into its row, and only the header and the
+ * scalar section are read: the geometry of raw files is seeked over, and that of gzip
+ * compressed files is inflated without being copied. Float and double scalars are converted to
+ * the type of matrix. No mesh is created. Throws if a file cannot be read, has another number
+ * of vertices, or has no such layer; the first error is rethrown once the work units have
+ * finished.
+ *
+ * \ingroup IOMeshMZ3
+ */
+extern IOMeshMZ3_EXPORT void
+ReadMZ3OverlayMatrix(const std::vector<std::string> & paths,
+                     SizeValueType                    numberOfVertices,
+                     float *                          matrix,
+                     const MZ3OverlayMatrixOptions &  options = MZ3OverlayMatrixOptions());
+
+extern IOMeshMZ3_EXPORT void
+ReadMZ3OverlayMatrix(const std::vector<std::string> & paths,
+                     SizeValueType                    numberOfVertices,
+                     double *                         matrix,
+                     const MZ3OverlayMatrixOptions &  options = MZ3OverlayMatrixOptions());
+} // end namespace itk
+
+#endif
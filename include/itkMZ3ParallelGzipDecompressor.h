@@ -0,0 +1,98 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkMZ3ParallelGzipDecompressor_h
+#define itkMZ3ParallelGzipDecompressor_h
+#include "IOMeshMZ3Export.h"
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+
+#include <vector>
+
+namespace itk
+{
+/** \class MZ3ParallelGzipDecompressor
+ *
+ * \brief Decompress a gzip stream held in memory with several threads.
+ *
+ * Most compressed MZ3 files are a single deflate stream, so there are no gzip member
+ * boundaries to split the work on. This decompressor splits the compressed bytes into
+ * chunks, searches each chunk for the start of a dynamic Huffman deflate block, and
+ * decodes the chunks in parallel. Back-references into the 32 KiB window that precedes a
+ * chunk are recorded as placeholders and resolved once the output of the preceding chunks
+ * is known.
+ *
+ * Chunks where no block boundary is found, or where the boundary found does not line up
+ * with the end of the preceding chunk, are decoded sequentially as a continuation of the
+ * preceding chunk, so the result is always identical to the output of zlib. Concatenated
+ * gzip members are supported, and the CRC-32 and size of every member are verified.
+ *
+ * Inputs smaller than two chunks, or a single work unit, are decoded with zlib directly.
+ *
+ * \ingroup IOMeshMZ3
+ */
+class IOMeshMZ3_EXPORT MZ3ParallelGzipDecompressor : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(MZ3ParallelGzipDecompressor);
+
+  /** Standard class type aliases. */
+  using Self = MZ3ParallelGzipDecompressor;
+  using Superclass = Object;
+  using ConstPointer = SmartPointer<const Self>;
+  using Pointer = SmartPointer<Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** \see LightObject::GetNameOfClass() */
+  itkOverrideGetNameOfClassMacro(MZ3ParallelGzipDecompressor);
+
+  /** Number of work units used to decode the chunks. Zero selects the global default. */
+  itkSetMacro(NumberOfWorkUnits, unsigned int);
+  itkGetConstMacro(NumberOfWorkUnits, unsigned int);
+
+  /** Size, in compressed bytes, of the chunks that are decoded in parallel. */
+  itkSetMacro(ChunkSize, SizeValueType);
+  itkGetConstMacro(ChunkSize, SizeValueType);
+
+  /** Decompress every gzip member in the size bytes at data and store the concatenated
+   * output in output. An exception is thrown if the data is not a valid gzip stream. */
+  void
+  Decompress(const void * data, SizeValueType size, std::vector<uint8_t> & output) const;
+
+protected:
+  MZ3ParallelGzipDecompressor() = default;
+  ~MZ3ParallelGzipDecompressor() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  void
+  DecompressWithZlib(const uint8_t * data, SizeValueType size, std::vector<uint8_t> & output) const;
+
+  void
+  DecompressInParallel(const uint8_t * data, SizeValueType size, std::vector<uint8_t> & output) const;
+
+  unsigned int  m_NumberOfWorkUnits{ 0 };
+  SizeValueType m_ChunkSize{ 4 * 1024 * 1024 };
+};
+} // end namespace itk
+
+#endif
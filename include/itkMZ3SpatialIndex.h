@@ -0,0 +1,168 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkMZ3SpatialIndex_h
+#define itkMZ3SpatialIndex_h
+#include "IOMeshMZ3Export.h"
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+
+#include <string>
+#include <vector>
+
+namespace itk
+{
+/** \class MZ3SpatialIndex
+ *
+ * \brief K-d tree over the vertices and bounding volume hierarchy over the triangles of an MZ3 mesh.
+ *
+ * Both trees are built by median splits. The top levels are split sequentially, and the
+ * remaining subtrees of the two trees are then built concurrently. The trees answer
+ * nearest vertex and nearest surface point queries.
+ *
+ * The trees can be written to a sidecar file and read back for the same geometry, which
+ * is identified by its number of vertices and triangles and a CRC-32 of the coordinates
+ * and indices.
+ *
+ * \ingroup IOMeshMZ3
+ */
+class IOMeshMZ3_EXPORT MZ3SpatialIndex : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(MZ3SpatialIndex);
+
+  /** Standard class type aliases. */
+  using Self = MZ3SpatialIndex;
+  using Superclass = Object;
+  using ConstPointer = SmartPointer<const Self>;
+  using Pointer = SmartPointer<Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** \see LightObject::GetNameOfClass() */
+  itkOverrideGetNameOfClassMacro(MZ3SpatialIndex);
+
+  /** Copy the vertex coordinates (x, y, z per vertex) and triangle indices, and build both trees. */
+  void
+  Build(const float * points, SizeValueType numberOfPoints, const uint32_t * faces, SizeValueType numberOfFaces);
+
+  /** As Build(), taking the coordinates and indices over instead of copying them. */
+  void
+  Build(std::vector<float> && points, std::vector<uint32_t> && faces);
+
+  /** Copy the geometry and read the trees from fileName. Returns false, leaving the index empty,
+   * if the file does not exist or was written for different geometry. */
+  bool
+  Read(const std::string & fileName,
+       const float *       points,
+       SizeValueType       numberOfPoints,
+       const uint32_t *    faces,
+       SizeValueType       numberOfFaces);
+
+  /** As Read(), taking the coordinates and indices over if the trees are read, and leaving
+   * points and faces unchanged otherwise. */
+  bool
+  Read(const std::string & fileName, std::vector<float> & points, std::vector<uint32_t> & faces);
+
+  /** Write the trees, without the geometry, to fileName. */
+  void
+  Write(const std::string & fileName) const;
+
+  SizeValueType
+  GetNumberOfPoints() const
+  {
+    return m_Points.size() / 3;
+  }
+
+  SizeValueType
+  GetNumberOfFaces() const
+  {
+    return m_Faces.size() / 3;
+  }
+
+  /** Index of the vertex closest to point. */
+  SizeValueType
+  FindClosestPoint(const float point[3]) const;
+
+  /** Index of the triangle closest to point. The closest point on that triangle is stored in
+   * closestPoint. */
+  SizeValueType
+  FindClosestSurfacePoint(const float point[3], float closestPoint[3]) const;
+
+protected:
+  MZ3SpatialIndex() = default;
+  ~MZ3SpatialIndex() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  struct BoundingVolumeNode
+  {
+    float m_Minimum[3];
+    float m_Maximum[3];
+    // Leaves: first entry in m_FaceOrder. Internal nodes: index of the right child; the left
+    // child follows the node.
+    uint32_t m_Offset;
+    // Number of triangles of a leaf, zero for internal nodes.
+    uint32_t m_NumberOfFaces;
+  };
+
+  /** Check that the faces refer to existing points, and take the geometry over. */
+  void
+  SetGeometry(std::vector<float> && points, std::vector<uint32_t> && faces);
+
+  /** Split a range of the k-d tree at its median along its widest axis and return the median. */
+  SizeValueType
+  SplitPointRange(SizeValueType begin, SizeValueType end);
+
+  void
+  BuildPointTree(SizeValueType begin, SizeValueType end);
+
+  /** Set the bounding box of node and, unless the range fits in a leaf, split it at the median
+   * centroid along its longest axis. Returns false for leaves. */
+  bool
+  SplitFaceRange(SizeValueType begin, SizeValueType end, SizeValueType node, const std::vector<float> & centroids);
+
+  void
+  BuildFaceTree(SizeValueType begin, SizeValueType end, SizeValueType node, const std::vector<float> & centroids);
+
+  void
+  FindClosestPoint(SizeValueType   begin,
+                   SizeValueType   end,
+                   const float     point[3],
+                   SizeValueType & closest,
+                   float &         closestDistance) const;
+
+  uint32_t
+  ComputeChecksum() const;
+
+  std::vector<float>    m_Points;
+  std::vector<uint32_t> m_Faces;
+
+  // Implicit k-d tree: the median of each range of m_PointOrder is the node of that range.
+  std::vector<uint32_t> m_PointOrder;
+  std::vector<uint8_t>  m_PointSplitAxis;
+
+  std::vector<uint32_t>           m_FaceOrder;
+  std::vector<BoundingVolumeNode> m_FaceNodes;
+};
+} // end namespace itk
+
+#endif
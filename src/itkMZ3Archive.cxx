@@ -0,0 +1,397 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkMZ3Archive.h"
+
+#include "itk_zlib.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#  include <io.h>
+#else
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+namespace itk
+{
+namespace
+{
+constexpr char          ArchiveMagic[4] = { 'M', 'Z', '3', 'A' };
+constexpr uint32_t      ArchiveVersion = 1;
+constexpr SizeValueType ArchiveHeaderSize = 32;
+constexpr SizeValueType PayloadAlignment = 8;
+
+template <typename T>
+void
+AppendValue(std::vector<uint8_t> & bytes, T value)
+{
+  const auto begin = reinterpret_cast<const uint8_t *>(&value);
+  bytes.insert(bytes.end(), begin, begin + sizeof(T));
+}
+
+/** Reads values from the index, checking that they lie within it. */
+class IndexReader
+{
+public:
+  IndexReader(const uint8_t * data, SizeValueType size)
+    : m_Data(data)
+    , m_Size(size)
+  {}
+
+  void
+  Read(void * value, SizeValueType size)
+  {
+    if (m_Position + size > m_Size)
+    {
+      itkGenericExceptionMacro("The index of the MZ3 archive is truncated");
+    }
+    std::memcpy(value, m_Data + m_Position, size);
+    m_Position += size;
+  }
+
+  template <typename T>
+  T
+  Read()
+  {
+    T value;
+    this->Read(&value, sizeof(T));
+    return value;
+  }
+
+private:
+  const uint8_t * m_Data;
+  SizeValueType   m_Size;
+  SizeValueType   m_Position{ 0 };
+};
+
+/** Decode the MZ3 header at the start of a raw or gzip compressed payload. */
+bool
+DecodeHeader(const uint8_t * data, SizeValueType size, bool & isCompressed, uint8_t header[16])
+{
+  isCompressed = size >= 2 && data[0] == 0x1F && data[1] == 0x8B;
+  if (!isCompressed)
+  {
+    if (size < 16)
+    {
+      return false;
+    }
+    std::memcpy(header, data, 16);
+  }
+  else
+  {
+    z_stream stream{};
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+    {
+      return false;
+    }
+    stream.next_in = const_cast<Bytef *>(data);
+    stream.avail_in = static_cast<uInt>(std::min<SizeValueType>(size, 1u << 30));
+    stream.next_out = header;
+    stream.avail_out = 16;
+    int result = Z_OK;
+    while (stream.avail_out > 0 && result == Z_OK)
+    {
+      result = inflate(&stream, Z_NO_FLUSH);
+    }
+    inflateEnd(&stream);
+    if (stream.avail_out > 0)
+    {
+      return false;
+    }
+  }
+  return header[0] == 0x4D && header[1] == 0x5A;
+}
+} // namespace
+
+MZ3Archive::~MZ3Archive()
+{
+  this->Close();
+}
+
+void
+MZ3Archive::Close()
+{
+  if (m_FileDescriptor >= 0)
+  {
+#ifndef _WIN32
+    close(m_FileDescriptor);
+#endif
+    m_FileDescriptor = -1;
+  }
+  m_IsOpen = false;
+  m_Entries.clear();
+  m_EntryIndex.clear();
+}
+
+void
+MZ3Archive::Open()
+{
+  this->Close();
+
+  std::ifstream file(m_FileName, std::ios::binary);
+  if (!file)
+  {
+    itkExceptionMacro("File cannot be read: " << m_FileName);
+  }
+  uint8_t header[ArchiveHeaderSize];
+  file.read(reinterpret_cast<char *>(header), ArchiveHeaderSize);
+  uint32_t version = 0;
+  std::memcpy(&version, header + 4, sizeof(version));
+  if (!file || std::memcmp(header, ArchiveMagic, sizeof(ArchiveMagic)) != 0 || version != ArchiveVersion)
+  {
+    itkExceptionMacro("Not an MZ3 archive: " << m_FileName);
+  }
+  uint64_t numberOfEntries, indexOffset, indexSize;
+  std::memcpy(&numberOfEntries, header + 8, sizeof(numberOfEntries));
+  std::memcpy(&indexOffset, header + 16, sizeof(indexOffset));
+  std::memcpy(&indexSize, header + 24, sizeof(indexSize));
+
+  std::error_code     error;
+  const SizeValueType fileSize = std::filesystem::file_size(m_FileName, error);
+  m_FileTime = std::filesystem::last_write_time(m_FileName, error);
+  // Sizes are compared with the space that remains, so that crafted values cannot wrap around
+  if (error || indexOffset < ArchiveHeaderSize || indexOffset > fileSize || indexSize > fileSize - indexOffset)
+  {
+    itkExceptionMacro("The index of the MZ3 archive is truncated: " << m_FileName);
+  }
+
+  std::vector<uint8_t> index(static_cast<size_t>(indexSize));
+  file.seekg(static_cast<std::streamoff>(indexOffset));
+  file.read(reinterpret_cast<char *>(index.data()), static_cast<std::streamsize>(indexSize));
+  if (!file)
+  {
+    itkExceptionMacro("File cannot be read: " << m_FileName);
+  }
+
+  IndexReader reader(index.data(), index.size());
+  m_Entries.reserve(static_cast<size_t>(std::min<uint64_t>(numberOfEntries, index.size())));
+  for (uint64_t ii = 0; ii < numberOfEntries; ++ii)
+  {
+    Entry entry;
+    entry.m_Offset = reader.Read<uint64_t>();
+    entry.m_Size = reader.Read<uint64_t>();
+    entry.m_IsCompressed = (reader.Read<uint8_t>() & 1) != 0;
+    reader.Read(entry.m_Header, sizeof(entry.m_Header));
+    entry.m_Name.resize(reader.Read<uint16_t>());
+    reader.Read(&entry.m_Name[0], entry.m_Name.size());
+    if (entry.m_Offset > indexOffset || entry.m_Size > indexOffset - entry.m_Offset)
+    {
+      this->Close();
+      itkExceptionMacro("Entry " << entry.m_Name << " lies outside of the payloads of " << m_FileName);
+    }
+    m_EntryIndex[entry.m_Name] = m_Entries.size();
+    m_Entries.push_back(std::move(entry));
+  }
+
+#ifndef _WIN32
+  m_FileDescriptor = open(m_FileName.c_str(), O_RDONLY);
+  if (m_FileDescriptor < 0)
+  {
+    this->Close();
+    itkExceptionMacro("File cannot be read: " << m_FileName);
+  }
+#endif
+  m_IsOpen = true;
+}
+
+bool
+MZ3Archive::IsUpToDate() const
+{
+  if (!m_IsOpen)
+  {
+    return false;
+  }
+  std::error_code error;
+  const auto      fileTime = std::filesystem::last_write_time(m_FileName, error);
+  return !error && fileTime == m_FileTime;
+}
+
+const MZ3Archive::Entry *
+MZ3Archive::FindEntry(const std::string & name) const
+{
+  const auto found = m_EntryIndex.find(name);
+  return found != m_EntryIndex.end() ? &m_Entries[found->second] : nullptr;
+}
+
+void
+MZ3Archive::ReadEntry(const std::string & name, std::vector<uint8_t> & payload) const
+{
+  const Entry * entry = this->FindEntry(name);
+  if (entry == nullptr)
+  {
+    itkExceptionMacro("No entry " << name << " in " << m_FileName);
+  }
+  payload.resize(static_cast<size_t>(entry->m_Size));
+  bool isRead = true;
+#ifdef _WIN32
+  std::ifstream file(m_FileName, std::ios::binary);
+  file.seekg(static_cast<std::streamoff>(entry->m_Offset));
+  file.read(reinterpret_cast<char *>(payload.data()), static_cast<std::streamsize>(entry->m_Size));
+  isRead = static_cast<bool>(file);
+#else
+  for (SizeValueType done = 0; isRead && done < entry->m_Size;)
+  {
+    const ssize_t result = pread(m_FileDescriptor,
+                                 payload.data() + done,
+                                 static_cast<size_t>(std::min<SizeValueType>(entry->m_Size - done, 1u << 30)),
+                                 static_cast<off_t>(entry->m_Offset + done));
+    isRead = result > 0;
+    done += isRead ? static_cast<SizeValueType>(result) : 0;
+  }
+#endif
+  if (!isRead)
+  {
+    itkExceptionMacro("Failed to read entry " << name << " of " << m_FileName);
+  }
+}
+
+std::vector<std::string>
+MZ3Archive::GetEntryPaths() const
+{
+  std::vector<std::string> paths;
+  paths.reserve(m_Entries.size());
+  for (const Entry & entry : m_Entries)
+  {
+    paths.push_back(m_FileName + ':' + entry.m_Name);
+  }
+  return paths;
+}
+
+bool
+MZ3Archive::SplitEntryPath(const std::string & path, std::string & archiveFileName, std::string & entryName)
+{
+  static const std::string separator = ".mz3a:";
+  const auto               position = path.find(separator);
+  if (position == std::string::npos || position + separator.size() == path.size())
+  {
+    return false;
+  }
+  archiveFileName = path.substr(0, position + separator.size() - 1);
+  entryName = path.substr(position + separator.size());
+  return true;
+}
+
+void
+MZ3Archive::AddEntry(const std::string & name, const void * data, SizeValueType size)
+{
+  if (name.empty() || name.size() > 0xFFFF)
+  {
+    itkExceptionMacro("Invalid entry name: " << name);
+  }
+  const auto hasName = [&name](const PendingEntry & pending) { return pending.m_Entry.m_Name == name; };
+  if (std::any_of(m_PendingEntries.begin(), m_PendingEntries.end(), hasName))
+  {
+    itkExceptionMacro("Duplicate entry name: " << name);
+  }
+
+  PendingEntry pending;
+  pending.m_Entry.m_Name = name;
+  pending.m_Entry.m_Size = size;
+  const auto bytes = static_cast<const uint8_t *>(data);
+  if (!DecodeHeader(bytes, size, pending.m_Entry.m_IsCompressed, pending.m_Entry.m_Header))
+  {
+    itkExceptionMacro("Entry " << name << " does not hold MZ3 data");
+  }
+  pending.m_Data.assign(bytes, bytes + size);
+  m_PendingEntries.push_back(std::move(pending));
+  this->Modified();
+}
+
+void
+MZ3Archive::AddFile(const std::string & name, const std::string & fileName)
+{
+  std::ifstream file(fileName, std::ios::binary);
+  if (!file)
+  {
+    itkExceptionMacro("File cannot be read: " << fileName);
+  }
+  const std::vector<uint8_t> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  this->AddEntry(name, contents.data(), contents.size());
+}
+
+void
+MZ3Archive::Write()
+{
+  this->Close();
+  std::ofstream file(m_FileName, std::ios::binary | std::ios::trunc);
+  if (!file)
+  {
+    itkExceptionMacro("File cannot be written: " << m_FileName);
+  }
+
+  // Payloads, each aligned to PayloadAlignment bytes after the header
+  const char    padding[PayloadAlignment] = {};
+  SizeValueType offset = ArchiveHeaderSize;
+  file.seekp(static_cast<std::streamoff>(offset));
+  for (PendingEntry & pending : m_PendingEntries)
+  {
+    const SizeValueType paddingSize = (PayloadAlignment - offset % PayloadAlignment) % PayloadAlignment;
+    file.write(padding, static_cast<std::streamsize>(paddingSize));
+    offset += paddingSize;
+    pending.m_Entry.m_Offset = offset;
+    file.write(reinterpret_cast<const char *>(pending.m_Data.data()),
+               static_cast<std::streamsize>(pending.m_Data.size()));
+    offset += pending.m_Data.size();
+  }
+
+  // Index
+  std::vector<uint8_t> index;
+  for (const PendingEntry & pending : m_PendingEntries)
+  {
+    const Entry & entry = pending.m_Entry;
+    AppendValue<uint64_t>(index, entry.m_Offset);
+    AppendValue<uint64_t>(index, entry.m_Size);
+    AppendValue<uint8_t>(index, entry.m_IsCompressed ? 1 : 0);
+    index.insert(index.end(), entry.m_Header, entry.m_Header + sizeof(entry.m_Header));
+    AppendValue<uint16_t>(index, static_cast<uint16_t>(entry.m_Name.size()));
+    index.insert(index.end(), entry.m_Name.begin(), entry.m_Name.end());
+  }
+  file.write(reinterpret_cast<const char *>(index.data()), static_cast<std::streamsize>(index.size()));
+
+  // Header, written last so that an interrupted write leaves no valid archive
+  std::vector<uint8_t> header(ArchiveMagic, ArchiveMagic + sizeof(ArchiveMagic));
+  AppendValue<uint32_t>(header, ArchiveVersion);
+  AppendValue<uint64_t>(header, m_PendingEntries.size());
+  AppendValue<uint64_t>(header, offset);
+  AppendValue<uint64_t>(header, index.size());
+  file.seekp(0);
+  file.write(reinterpret_cast<const char *>(header.data()), static_cast<std::streamsize>(header.size()));
+  file.close();
+  if (!file)
+  {
+    itkExceptionMacro("Failed to write " << m_FileName);
+  }
+  m_PendingEntries.clear();
+}
+
+void
+MZ3Archive::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "FileName: " << m_FileName << std::endl;
+  os << indent << "Open: " << (m_IsOpen ? "Yes" : "No") << std::endl;
+  os << indent << "NumberOfEntries: " << m_Entries.size() << std::endl;
+  os << indent << "NumberOfPendingEntries: " << m_PendingEntries.size() << std::endl;
+}
+} // namespace itk
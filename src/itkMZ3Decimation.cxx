@@ -0,0 +1,309 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkMZ3Decimation.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace itk
+{
+namespace
+{
+// Bits of each of the three indices of a grid cell in its key.
+constexpr unsigned int KeyBits = 21;
+
+uint64_t
+CellKey(const float * point, const double origin[3], double cellSize)
+{
+  constexpr double maximumIndex = (1u << KeyBits) - 1;
+  uint64_t         key = 0;
+  for (unsigned int kk = 0; kk < 3; ++kk)
+  {
+    const double index = std::floor((point[kk] - origin[kk]) / cellSize);
+    const double clamped = std::isfinite(index) ? std::min(std::max(index, 0.0), maximumIndex) : 0.0;
+    key |= static_cast<uint64_t>(clamped) << (kk * KeyBits);
+  }
+  return key;
+}
+
+/** Number the cells holding points in the order of their keys, into pointMap, and return the
+ * number of cells. */
+SizeValueType
+ClusterPoints(const float *                                points,
+              SizeValueType                                numberOfPoints,
+              const double                                 origin[3],
+              double                                       cellSize,
+              std::vector<std::pair<uint64_t, uint32_t>> & keys,
+              std::vector<uint32_t> &                      pointMap)
+{
+  keys.resize(numberOfPoints);
+  for (SizeValueType ii = 0; ii < numberOfPoints; ++ii)
+  {
+    keys[ii] = { CellKey(points + ii * 3, origin, cellSize), static_cast<uint32_t>(ii) };
+  }
+  std::sort(keys.begin(), keys.end());
+  pointMap.resize(numberOfPoints);
+  uint32_t cluster = 0;
+  for (SizeValueType ii = 0; ii < numberOfPoints; ++ii)
+  {
+    if (ii > 0 && keys[ii].first != keys[ii - 1].first)
+    {
+      ++cluster;
+    }
+    pointMap[keys[ii].second] = cluster;
+  }
+  return numberOfPoints > 0 ? SizeValueType{ cluster } + 1 : 0;
+}
+
+/** Solve the symmetric system of the quadric q, whose terms are xx, xy, xz, yy, yz, zz, x, y, z
+ * and 1, for the point that minimizes it, starting from center. Returns false if the system is
+ * ill-conditioned. */
+bool
+SolveQuadric(const double * q, const double center[3], double point[3])
+{
+  const double a[3][3] = { { q[0], q[1], q[2] }, { q[1], q[3], q[4] }, { q[2], q[4], q[5] } };
+  double       rhs[3];
+  for (unsigned int ii = 0; ii < 3; ++ii)
+  {
+    rhs[ii] = -q[6 + ii] - (a[ii][0] * center[0] + a[ii][1] * center[1] + a[ii][2] * center[2]);
+  }
+  double cofactors[3][3];
+  for (unsigned int ii = 0; ii < 3; ++ii)
+  {
+    for (unsigned int jj = 0; jj < 3; ++jj)
+    {
+      cofactors[ii][jj] = a[(ii + 1) % 3][(jj + 1) % 3] * a[(ii + 2) % 3][(jj + 2) % 3] -
+                          a[(ii + 1) % 3][(jj + 2) % 3] * a[(ii + 2) % 3][(jj + 1) % 3];
+    }
+  }
+  const double determinant = a[0][0] * cofactors[0][0] + a[0][1] * cofactors[0][1] + a[0][2] * cofactors[0][2];
+  const double trace = a[0][0] + a[1][1] + a[2][2];
+  if (!(std::abs(determinant) > 1e-6 * trace * trace * trace))
+  {
+    return false;
+  }
+  // The inverse of a symmetric matrix is the transpose of its cofactors over the determinant
+  for (unsigned int ii = 0; ii < 3; ++ii)
+  {
+    point[ii] =
+      center[ii] + (cofactors[0][ii] * rhs[0] + cofactors[1][ii] * rhs[1] + cofactors[2][ii] * rhs[2]) / determinant;
+  }
+  return true;
+}
+} // namespace
+
+void
+DecimateMZ3Mesh(const float *      points,
+                SizeValueType      numberOfPoints,
+                const uint32_t *   faces,
+                SizeValueType      numberOfFaces,
+                double             fraction,
+                MZ3DecimatedMesh & mesh)
+{
+  const auto isValid = [faces, numberOfPoints](SizeValueType face) {
+    return faces[face * 3] < numberOfPoints && faces[face * 3 + 1] < numberOfPoints &&
+           faces[face * 3 + 2] < numberOfPoints;
+  };
+  const auto targetNumberOfPoints =
+    std::max<SizeValueType>(4, static_cast<SizeValueType>(std::llround(fraction * numberOfPoints)));
+  if (!(fraction < 1.0) || targetNumberOfPoints >= numberOfPoints)
+  {
+    mesh.m_Points.assign(points, points + numberOfPoints * 3);
+    mesh.m_Faces.assign(faces, faces + numberOfFaces * 3);
+    mesh.m_PointMap.resize(numberOfPoints);
+    for (SizeValueType ii = 0; ii < numberOfPoints; ++ii)
+    {
+      mesh.m_PointMap[ii] = static_cast<uint32_t>(ii);
+    }
+    return;
+  }
+
+  // The number of cells that a surface of area A occupies is about A / cellSize^2, so start
+  // from that cell size and correct it by the number of cells that are found
+  double origin[3];
+  double extent = 0.0;
+  for (unsigned int kk = 0; kk < 3; ++kk)
+  {
+    double minimum = std::numeric_limits<double>::max();
+    double maximum = std::numeric_limits<double>::lowest();
+    for (SizeValueType ii = 0; ii < numberOfPoints; ++ii)
+    {
+      if (std::isfinite(points[ii * 3 + kk]))
+      {
+        minimum = std::min<double>(minimum, points[ii * 3 + kk]);
+        maximum = std::max<double>(maximum, points[ii * 3 + kk]);
+      }
+    }
+    origin[kk] = minimum <= maximum ? minimum : 0.0;
+    extent = std::max(extent, maximum - minimum);
+  }
+  double area = 0.0;
+  for (SizeValueType face = 0; face < numberOfFaces; ++face)
+  {
+    if (!isValid(face))
+    {
+      continue;
+    }
+    const float * a = points + SizeValueType{ faces[face * 3] } * 3;
+    const float * b = points + SizeValueType{ faces[face * 3 + 1] } * 3;
+    const float * c = points + SizeValueType{ faces[face * 3 + 2] } * 3;
+    const double  u[3] = { double{ b[0] } - a[0], double{ b[1] } - a[1], double{ b[2] } - a[2] };
+    const double  v[3] = { double{ c[0] } - a[0], double{ c[1] } - a[1], double{ c[2] } - a[2] };
+    area += 0.5 * std::sqrt(std::pow(u[1] * v[2] - u[2] * v[1], 2) + std::pow(u[2] * v[0] - u[0] * v[2], 2) +
+                            std::pow(u[0] * v[1] - u[1] * v[0], 2));
+  }
+  const double minimumCellSize = extent > 0.0 ? extent / ((1u << KeyBits) - 1) : 1.0;
+  double       cellSize = std::sqrt(area / static_cast<double>(targetNumberOfPoints));
+  if (!std::isfinite(cellSize) || cellSize <= 0.0)
+  {
+    cellSize = extent / std::cbrt(static_cast<double>(targetNumberOfPoints));
+  }
+  cellSize = std::max(cellSize, minimumCellSize);
+
+  std::vector<std::pair<uint64_t, uint32_t>> keys;
+  std::vector<uint32_t> &                    pointMap = mesh.m_PointMap;
+  SizeValueType numberOfClusters = ClusterPoints(points, numberOfPoints, origin, cellSize, keys, pointMap);
+  for (unsigned int iteration = 0; iteration < 4; ++iteration)
+  {
+    const double ratio = static_cast<double>(numberOfClusters) / static_cast<double>(targetNumberOfPoints);
+    if (std::abs(ratio - 1.0) < 0.05)
+    {
+      break;
+    }
+    cellSize = std::max(cellSize * std::sqrt(ratio), minimumCellSize);
+    numberOfClusters = ClusterPoints(points, numberOfPoints, origin, cellSize, keys, pointMap);
+  }
+  keys = std::vector<std::pair<uint64_t, uint32_t>>();
+
+  // Sum the quadrics of the planes of the faces, weighted by their areas, and the points of
+  // every cluster
+  std::vector<double>        quadrics(numberOfClusters * 10);
+  std::vector<double>        centers(numberOfClusters * 3);
+  std::vector<SizeValueType> counts(numberOfClusters);
+  for (SizeValueType ii = 0; ii < numberOfPoints; ++ii)
+  {
+    for (unsigned int kk = 0; kk < 3; ++kk)
+    {
+      centers[SizeValueType{ pointMap[ii] } * 3 + kk] += points[ii * 3 + kk];
+    }
+    ++counts[pointMap[ii]];
+  }
+  for (SizeValueType face = 0; face < numberOfFaces; ++face)
+  {
+    if (!isValid(face))
+    {
+      continue;
+    }
+    const float * a = points + SizeValueType{ faces[face * 3] } * 3;
+    const float * b = points + SizeValueType{ faces[face * 3 + 1] } * 3;
+    const float * c = points + SizeValueType{ faces[face * 3 + 2] } * 3;
+    const double  u[3] = { double{ b[0] } - a[0], double{ b[1] } - a[1], double{ b[2] } - a[2] };
+    const double  v[3] = { double{ c[0] } - a[0], double{ c[1] } - a[1], double{ c[2] } - a[2] };
+    double        normal[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+    const double  length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    if (!(length > 0.0))
+    {
+      continue;
+    }
+    for (double & component : normal)
+    {
+      component /= length;
+    }
+    const double distance = -(normal[0] * a[0] + normal[1] * a[1] + normal[2] * a[2]);
+    const double weight = 0.5 * length;
+    const double terms[10] = { normal[0] * normal[0], normal[0] * normal[1], normal[0] * normal[2],
+                               normal[1] * normal[1], normal[1] * normal[2], normal[2] * normal[2],
+                               normal[0] * distance,  normal[1] * distance,  normal[2] * distance,
+                               distance * distance };
+    const uint32_t clusters[3] = { pointMap[faces[face * 3]],
+                                   pointMap[faces[face * 3 + 1]],
+                                   pointMap[faces[face * 3 + 2]] };
+    for (unsigned int jj = 0; jj < 3; ++jj)
+    {
+      if ((jj > 0 && clusters[jj] == clusters[0]) || (jj > 1 && clusters[jj] == clusters[1]))
+      {
+        continue;
+      }
+      double * quadric = quadrics.data() + SizeValueType{ clusters[jj] } * 10;
+      for (unsigned int kk = 0; kk < 10; ++kk)
+      {
+        quadric[kk] += weight * terms[kk];
+      }
+    }
+  }
+
+  // Place every merged point at the minimum of its quadric, unless that leaves its cell
+  mesh.m_Points.resize(numberOfClusters * 3);
+  for (SizeValueType cluster = 0; cluster < numberOfClusters; ++cluster)
+  {
+    double center[3];
+    for (unsigned int kk = 0; kk < 3; ++kk)
+    {
+      center[kk] = centers[cluster * 3 + kk] / static_cast<double>(counts[cluster]);
+    }
+    double point[3];
+    if (!SolveQuadric(quadrics.data() + cluster * 10, center, point) ||
+        std::abs(point[0] - center[0]) > cellSize || std::abs(point[1] - center[1]) > cellSize ||
+        std::abs(point[2] - center[2]) > cellSize)
+    {
+      std::copy_n(center, 3, point);
+    }
+    for (unsigned int kk = 0; kk < 3; ++kk)
+    {
+      mesh.m_Points[cluster * 3 + kk] = static_cast<float>(point[kk]);
+    }
+  }
+
+  // Renumber the faces, and rotate each to start at its smallest index so that duplicates of the
+  // same orientation are adjacent once sorted
+  using Face = std::array<uint32_t, 3>;
+  std::vector<Face> mergedFaces;
+  mergedFaces.reserve(std::min(numberOfFaces, numberOfClusters * 2));
+  for (SizeValueType face = 0; face < numberOfFaces; ++face)
+  {
+    if (!isValid(face))
+    {
+      continue;
+    }
+    Face merged = { pointMap[faces[face * 3]], pointMap[faces[face * 3 + 1]], pointMap[faces[face * 3 + 2]] };
+    if (merged[0] == merged[1] || merged[1] == merged[2] || merged[2] == merged[0])
+    {
+      continue;
+    }
+    std::rotate(merged.begin(), std::min_element(merged.begin(), merged.end()), merged.end());
+    mergedFaces.push_back(merged);
+  }
+  std::sort(mergedFaces.begin(), mergedFaces.end());
+  mergedFaces.erase(std::unique(mergedFaces.begin(), mergedFaces.end()), mergedFaces.end());
+
+  // A face and its reverse enclose nothing where a thin fold collapsed, so drop both
+  mesh.m_Faces.clear();
+  mesh.m_Faces.reserve(mergedFaces.size() * 3);
+  for (const Face & face : mergedFaces)
+  {
+    if (!std::binary_search(mergedFaces.begin(), mergedFaces.end(), Face{ face[0], face[2], face[1] }))
+    {
+      mesh.m_Faces.insert(mesh.m_Faces.end(), face.begin(), face.end());
+    }
+  }
+}
+} // namespace itk
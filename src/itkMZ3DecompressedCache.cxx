@@ -0,0 +1,216 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkMZ3DecompressedCache.h"
+#include "itkMZ3GeometryCache.h"
+
+#include "itk_zlib.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+
+namespace itk
+{
+namespace
+{
+const char * const EntryExtension = ".mz3";
+
+/** Name of the entry for key: its 64-bit hash in hexadecimal. */
+std::string
+EntryName(const std::string & key)
+{
+  constexpr char digits[] = "0123456789abcdef";
+  uint64_t       hash = MZ3GeometryCache::Hash(key.data(), key.size());
+  std::string    name(16, '0');
+  for (auto digit = name.rbegin(); digit != name.rend(); ++digit, hash >>= 4)
+  {
+    *digit = digits[hash & 15];
+  }
+  return name + EntryExtension;
+}
+} // namespace
+
+std::string
+MZ3DecompressedCache::GetCachedFileName(const std::string & fileName)
+{
+  namespace fs = std::filesystem;
+  if (m_Directory.empty())
+  {
+    itkExceptionMacro("No cache directory is set");
+  }
+  std::error_code error;
+  const fs::path  source = fs::absolute(fileName, error);
+  const auto      sourceSize = error ? 0 : fs::file_size(source, error);
+  const auto      sourceTime = error ? fs::file_time_type{} : fs::last_write_time(source, error);
+  if (error)
+  {
+    itkExceptionMacro("File cannot be read: " << fileName);
+  }
+
+  gzFile input = gzopen(fileName.c_str(), "rb");
+  if (input == nullptr)
+  {
+    itkExceptionMacro("File cannot be read: " << fileName);
+  }
+  uint8_t header[16];
+  if (gzdirect(input) || gzread(input, header, sizeof(header)) != sizeof(header) || header[0] != 0x4D ||
+      header[1] != 0x5A)
+  {
+    gzclose(input);
+    itkExceptionMacro("Not a gzip compressed MZ3 file: " << fileName);
+  }
+  gzclose(input);
+
+  std::string key = source.string() + '\n' + std::to_string(sourceSize) + '\n' +
+                    std::to_string(sourceTime.time_since_epoch().count()) + '\n';
+  key.append(reinterpret_cast<const char *>(header), sizeof(header));
+  const fs::path entry = fs::path(m_Directory) / EntryName(key);
+
+  // An entry is complete once it exists, but check its header against a damaged file
+  uint8_t       entryHeader[16];
+  std::ifstream entryFile(entry, std::ios::binary);
+  if (entryFile.read(reinterpret_cast<char *>(entryHeader), sizeof(entryHeader)) &&
+      std::memcmp(entryHeader, header, sizeof(header)) == 0)
+  {
+    entryFile.close();
+    // The modification time orders the entries for eviction
+    fs::last_write_time(entry, fs::file_time_type::clock::now(), error);
+    ++m_NumberOfHits;
+    return entry.string();
+  }
+  entryFile.close();
+  ++m_NumberOfMisses;
+
+  // Inflate into a file of this process that replaces the entry once complete
+  fs::create_directories(m_Directory, error);
+  InflateFile(fileName, entry.string());
+
+  this->Evict(entry.string());
+  return entry.string();
+}
+
+std::string
+MZ3DecompressedCache::GetDefaultDirectory()
+{
+  std::error_code error;
+  return (std::filesystem::temp_directory_path(error) / "itkMZ3DecompressedCache").string();
+}
+
+void
+MZ3DecompressedCache::InflateFile(const std::string & fileName, const std::string & outputFileName)
+{
+  namespace fs = std::filesystem;
+  gzFile input = gzopen(fileName.c_str(), "rb");
+  if (input == nullptr)
+  {
+    itkGenericExceptionMacro("File cannot be read: " << fileName);
+  }
+
+  const std::string partialFileName = outputFileName + '.' + std::to_string(std::random_device{}()) + ".partial";
+  std::ofstream     output(partialFileName, std::ios::binary | std::ios::trunc);
+  gzbuffer(input, 1 << 20);
+  std::vector<char> block(4 * 1024 * 1024);
+  int               bytesRead = 0;
+  while (output && (bytesRead = gzread(input, block.data(), static_cast<unsigned int>(block.size()))) > 0)
+  {
+    output.write(block.data(), bytesRead);
+  }
+  gzclose(input);
+  output.close();
+  std::error_code error;
+  if (bytesRead < 0 || !output)
+  {
+    fs::remove(partialFileName, error);
+    itkGenericExceptionMacro("Failed to inflate " << fileName << " into " << outputFileName);
+  }
+  fs::rename(partialFileName, outputFileName, error);
+  if (error)
+  {
+    fs::remove(partialFileName, error);
+    itkGenericExceptionMacro("Failed to inflate " << fileName << " into " << outputFileName);
+  }
+}
+
+void
+MZ3DecompressedCache::Evict(const std::string & keepFileName)
+{
+  namespace fs = std::filesystem;
+  struct CachedFile
+  {
+    fs::path           m_Path;
+    SizeValueType      m_Size;
+    fs::file_time_type m_Time;
+  };
+  std::vector<CachedFile> files;
+  SizeValueType           totalSize = 0;
+  std::error_code         error;
+  for (fs::directory_iterator it(m_Directory, error), end; !error && it != end; it.increment(error))
+  {
+    std::error_code entryError;
+    if (it->path().extension() != EntryExtension || !it->is_regular_file(entryError))
+    {
+      continue;
+    }
+    CachedFile file{ it->path(), it->file_size(entryError), it->last_write_time(entryError) };
+    if (!entryError)
+    {
+      totalSize += file.m_Size;
+      files.push_back(file);
+    }
+  }
+  if (totalSize <= m_MaximumSize)
+  {
+    return;
+  }
+
+  // Readers that have an entry open keep reading it after it is removed, except on Windows,
+  // where removing it fails and it is left for a later eviction
+  std::sort(files.begin(), files.end(), [](const CachedFile & a, const CachedFile & b) { return a.m_Time < b.m_Time; });
+  const fs::path keep(keepFileName);
+  for (const auto & file : files)
+  {
+    if (totalSize <= m_MaximumSize)
+    {
+      break;
+    }
+    if (!keepFileName.empty() && fs::equivalent(file.m_Path, keep, error))
+    {
+      continue;
+    }
+    if (fs::remove(file.m_Path, error))
+    {
+      totalSize -= file.m_Size;
+    }
+  }
+}
+
+void
+MZ3DecompressedCache::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "Directory: " << m_Directory << std::endl;
+  os << indent << "MaximumSize: " << m_MaximumSize << std::endl;
+  os << indent << "NumberOfHits: " << m_NumberOfHits << std::endl;
+  os << indent << "NumberOfMisses: " << m_NumberOfMisses << std::endl;
+}
+} // namespace itk
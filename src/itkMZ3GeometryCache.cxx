@@ -0,0 +1,233 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkMZ3GeometryCache.h"
+
+#include <cstring>
+
+namespace itk
+{
+namespace
+{
+constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t Prime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+
+uint64_t
+RotateLeft(uint64_t value, unsigned int bits)
+{
+  return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t
+Round(uint64_t accumulator, uint64_t input)
+{
+  return RotateLeft(accumulator + input * Prime2, 31) * Prime1;
+}
+
+uint64_t
+Merge(uint64_t accumulator, uint64_t value)
+{
+  return (accumulator ^ Round(0, value)) * Prime1 + Prime4;
+}
+
+uint64_t
+Load64(const uint8_t * bytes)
+{
+  uint64_t value;
+  std::memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+SizeValueType
+GeometrySize(const MZ3GeometryCache::Geometry & geometry)
+{
+  return geometry.m_Points.size() * sizeof(float) + geometry.m_Faces.size() * sizeof(uint32_t);
+}
+} // namespace
+
+bool
+MZ3GeometryCache::Key::operator==(const Key & other) const
+{
+  return m_Hash == other.m_Hash && m_Size == other.m_Size && std::memcmp(m_Header, other.m_Header, 16) == 0;
+}
+
+MZ3GeometryCache *
+MZ3GeometryCache::GetInstance()
+{
+  static const Pointer instance = [] {
+    Pointer cache = new MZ3GeometryCache;
+    cache->UnRegister();
+    return cache;
+  }();
+  return instance.GetPointer();
+}
+
+uint64_t
+MZ3GeometryCache::Hash(const void * data, SizeValueType size, uint64_t seed)
+{
+  const auto *    bytes = static_cast<const uint8_t *>(data);
+  const uint8_t * end = bytes + size;
+  uint64_t        hash;
+
+  if (size >= 32)
+  {
+    uint64_t lanes[4] = { seed + Prime1 + Prime2, seed + Prime2, seed, seed - Prime1 };
+    for (; bytes + 32 <= end; bytes += 32)
+    {
+      lanes[0] = Round(lanes[0], Load64(bytes));
+      lanes[1] = Round(lanes[1], Load64(bytes + 8));
+      lanes[2] = Round(lanes[2], Load64(bytes + 16));
+      lanes[3] = Round(lanes[3], Load64(bytes + 24));
+    }
+    hash = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) + RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+    for (const uint64_t lane : lanes)
+    {
+      hash = Merge(hash, lane);
+    }
+  }
+  else
+  {
+    hash = seed + Prime5;
+  }
+  hash += static_cast<uint64_t>(size);
+
+  for (; bytes + 8 <= end; bytes += 8)
+  {
+    hash = RotateLeft(hash ^ Round(0, Load64(bytes)), 27) * Prime1 + Prime4;
+  }
+  for (; bytes < end; ++bytes)
+  {
+    hash = RotateLeft(hash ^ (*bytes * Prime5), 11) * Prime1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= Prime2;
+  hash ^= hash >> 29;
+  hash *= Prime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+MZ3GeometryCache::GeometryConstPointer
+MZ3GeometryCache::Find(const Key & key)
+{
+  const std::lock_guard<std::mutex> lock(m_Mutex);
+  const auto                        found = m_Index.find(key);
+  if (found == m_Index.end())
+  {
+    ++m_NumberOfMisses;
+    return nullptr;
+  }
+  ++m_NumberOfHits;
+  m_Entries.splice(m_Entries.begin(), m_Entries, found->second);
+  return found->second->second;
+}
+
+void
+MZ3GeometryCache::Insert(const Key & key, GeometryConstPointer geometry)
+{
+  const SizeValueType size = GeometrySize(*geometry);
+
+  const std::lock_guard<std::mutex> lock(m_Mutex);
+  if (size > m_MaximumSize || m_Index.count(key) > 0)
+  {
+    return;
+  }
+  this->Shrink(m_MaximumSize - size);
+  m_Entries.emplace_front(key, std::move(geometry));
+  m_Index.emplace(key, m_Entries.begin());
+  m_Size += size;
+}
+
+void
+MZ3GeometryCache::Shrink(SizeValueType maximumSize)
+{
+  while (m_Size > maximumSize && !m_Entries.empty())
+  {
+    m_Size -= GeometrySize(*m_Entries.back().second);
+    m_Index.erase(m_Entries.back().first);
+    m_Entries.pop_back();
+  }
+}
+
+void
+MZ3GeometryCache::Clear()
+{
+  const std::lock_guard<std::mutex> lock(m_Mutex);
+  this->Shrink(0);
+}
+
+void
+MZ3GeometryCache::SetMaximumSize(SizeValueType maximumSize)
+{
+  const std::lock_guard<std::mutex> lock(m_Mutex);
+  m_MaximumSize = maximumSize;
+  this->Shrink(maximumSize);
+}
+
+SizeValueType
+MZ3GeometryCache::GetMaximumSize() const
+{
+  const std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_MaximumSize;
+}
+
+SizeValueType
+MZ3GeometryCache::GetSize() const
+{
+  const std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_Size;
+}
+
+SizeValueType
+MZ3GeometryCache::GetNumberOfEntries() const
+{
+  const std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_Entries.size();
+}
+
+SizeValueType
+MZ3GeometryCache::GetNumberOfHits() const
+{
+  const std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_NumberOfHits;
+}
+
+SizeValueType
+MZ3GeometryCache::GetNumberOfMisses() const
+{
+  const std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_NumberOfMisses;
+}
+
+void
+MZ3GeometryCache::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  const std::lock_guard<std::mutex> lock(m_Mutex);
+  os << indent << "MaximumSize: " << m_MaximumSize << std::endl;
+  os << indent << "Size: " << m_Size << std::endl;
+  os << indent << "NumberOfEntries: " << m_Entries.size() << std::endl;
+  os << indent << "NumberOfHits: " << m_NumberOfHits << std::endl;
+  os << indent << "NumberOfMisses: " << m_NumberOfMisses << std::endl;
+}
+} // namespace itk
@@ -0,0 +1,258 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkMZ3MappedMesh.h"
+#include "itkMZ3DecompressedCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#  define WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace itk
+{
+namespace
+{
+bool
+IsGzipFile(const std::string & fileName)
+{
+  std::ifstream file(fileName, std::ios::binary);
+  uint8_t       magic[2] = { 0, 0 };
+  file.read(reinterpret_cast<char *>(magic), 2);
+  return file && magic[0] == 0x1F && magic[1] == 0x8B;
+}
+} // namespace
+
+MZ3MappedMesh::~MZ3MappedMesh()
+{
+  this->Close();
+}
+
+void
+MZ3MappedMesh::UpdateCacheFile()
+{
+  namespace fs = std::filesystem;
+  std::error_code error;
+  const fs::path  source(m_FileName);
+  const auto      sourceTime = fs::last_write_time(source, error);
+  if (error)
+  {
+    itkExceptionMacro("File cannot be read: " << m_FileName);
+  }
+
+  m_MappedFileName = m_CacheFileName;
+  const fs::path cache(m_MappedFileName);
+  const bool     isUpToDate = fs::exists(cache, error) && fs::last_write_time(cache, error) >= sourceTime && !error;
+  if (isUpToDate && !IsGzipFile(cache.string()))
+  {
+    return;
+  }
+  MZ3DecompressedCache::InflateFile(m_FileName, m_MappedFileName);
+}
+
+void
+MZ3MappedMesh::Open()
+{
+  this->Close();
+  if (IsGzipFile(m_FileName) && (!m_CacheDirectory.empty() || m_CacheFileName.empty()))
+  {
+    const auto cache = MZ3DecompressedCache::New();
+    cache->SetDirectory(m_CacheDirectory.empty() ? MZ3DecompressedCache::GetDefaultDirectory() : m_CacheDirectory);
+    m_MappedFileName = cache->GetCachedFileName(m_FileName);
+  }
+  else if (IsGzipFile(m_FileName))
+  {
+    this->UpdateCacheFile();
+  }
+  else
+  {
+    m_MappedFileName = m_FileName;
+  }
+
+#ifdef _WIN32
+  const HANDLE file = CreateFileA(m_MappedFileName.c_str(),
+                                  GENERIC_READ,
+                                  FILE_SHARE_READ,
+                                  nullptr,
+                                  OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL,
+                                  nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    itkExceptionMacro("File cannot be read: " << m_MappedFileName);
+  }
+  LARGE_INTEGER fileSize;
+  const bool    isSized = GetFileSizeEx(file, &fileSize) != 0;
+  if (isSized && fileSize.QuadPart >= 16)
+  {
+    m_MappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_MappingHandle != nullptr)
+    {
+      m_Data = static_cast<const uint8_t *>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+    }
+  }
+  CloseHandle(file);
+  if (m_Data == nullptr)
+  {
+    this->Close();
+    itkExceptionMacro("Not an MZ3 file: " << m_MappedFileName);
+  }
+  m_Size = static_cast<SizeValueType>(fileSize.QuadPart);
+#else
+  const int file = open(m_MappedFileName.c_str(), O_RDONLY);
+  if (file < 0)
+  {
+    itkExceptionMacro("File cannot be read: " << m_MappedFileName);
+  }
+  struct stat fileStatus;
+  if (fstat(file, &fileStatus) == 0 && fileStatus.st_size >= 16)
+  {
+    void * data = mmap(nullptr, static_cast<size_t>(fileStatus.st_size), PROT_READ, MAP_SHARED, file, 0);
+    if (data != MAP_FAILED)
+    {
+      m_Data = static_cast<const uint8_t *>(data);
+      m_Size = static_cast<SizeValueType>(fileStatus.st_size);
+    }
+  }
+  // The mapping keeps the file referenced
+  close(file);
+  if (m_Data == nullptr)
+  {
+    itkExceptionMacro("Not an MZ3 file: " << m_MappedFileName);
+  }
+#endif
+
+  uint16_t attr;
+  uint32_t nface, nvert, nskip;
+  std::memcpy(&attr, m_Data + 2, sizeof(attr));
+  std::memcpy(&nface, m_Data + 4, sizeof(nface));
+  std::memcpy(&nvert, m_Data + 8, sizeof(nvert));
+  std::memcpy(&nskip, m_Data + 12, sizeof(nskip));
+  if (m_Data[0] != 0x4D || m_Data[1] != 0x5A)
+  {
+    this->Close();
+    itkExceptionMacro("Not an MZ3 file: " << m_MappedFileName);
+  }
+
+  // Locate the sections and check that the file holds them
+  m_Attributes = attr;
+  m_NumberOfFaces = (attr & 1) ? nface : 0;
+  m_NumberOfPoints = nvert;
+  SizeValueType offset = 16 + SizeValueType{ nskip };
+  const auto    takeSection = [this, &offset](const uint8_t *& section, SizeValueType size) {
+    if (size > 0 && offset + size <= m_Size)
+    {
+      section = m_Data + offset;
+    }
+    offset += size;
+  };
+  takeSection(m_Faces, m_NumberOfFaces * 12);
+  takeSection(m_Points, (attr & 2) ? m_NumberOfPoints * 12 : 0);
+  takeSection(m_Colors, (attr & 4) ? m_NumberOfPoints * 4 : 0);
+  if (offset > m_Size)
+  {
+    this->Close();
+    itkExceptionMacro("Unexpected end of MZ3 data in " << m_MappedFileName);
+  }
+  const SizeValueType scalarSize = (attr & 16) ? 8 : 4;
+  if ((attr & 24) && m_NumberOfPoints > 0)
+  {
+    m_NumberOfScalarLayers = (m_Size - offset) / (m_NumberOfPoints * scalarSize);
+    takeSection(m_Scalars, m_NumberOfScalarLayers * m_NumberOfPoints * scalarSize);
+  }
+}
+
+void
+MZ3MappedMesh::Close()
+{
+  if (m_Data != nullptr)
+  {
+#ifdef _WIN32
+    UnmapViewOfFile(m_Data);
+#else
+    munmap(const_cast<uint8_t *>(m_Data), static_cast<size_t>(m_Size));
+#endif
+  }
+#ifdef _WIN32
+  if (m_MappingHandle != nullptr)
+  {
+    CloseHandle(m_MappingHandle);
+    m_MappingHandle = nullptr;
+  }
+#endif
+  m_Data = nullptr;
+  m_Size = 0;
+  m_Points = nullptr;
+  m_Faces = nullptr;
+  m_Colors = nullptr;
+  m_Scalars = nullptr;
+  m_Attributes = 0;
+  m_NumberOfPoints = 0;
+  m_NumberOfFaces = 0;
+  m_NumberOfScalarLayers = 0;
+}
+
+MZ3MappedMesh::PointType
+MZ3MappedMesh::GetPoint(SizeValueType pointId) const
+{
+  if (m_Points == nullptr || pointId >= m_NumberOfPoints)
+  {
+    itkExceptionMacro("Point " << pointId << " is out of range");
+  }
+  float coordinates[3];
+  std::memcpy(coordinates, m_Points + pointId * 12, sizeof(coordinates));
+  return PointType(coordinates);
+}
+
+MZ3MappedMesh::FaceType
+MZ3MappedMesh::GetFace(SizeValueType faceId) const
+{
+  if (m_Faces == nullptr || faceId >= m_NumberOfFaces)
+  {
+    itkExceptionMacro("Face " << faceId << " is out of range");
+  }
+  FaceType face;
+  std::memcpy(face.data(), m_Faces + faceId * 12, sizeof(uint32_t) * 3);
+  return face;
+}
+
+void
+MZ3MappedMesh::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "FileName: " << m_FileName << std::endl;
+  os << indent << "CacheFileName: " << m_CacheFileName << std::endl;
+  os << indent << "CacheDirectory: " << m_CacheDirectory << std::endl;
+  os << indent << "MappedFileName: " << m_MappedFileName << std::endl;
+  os << indent << "Open: " << (this->IsOpen() ? "Yes" : "No") << std::endl;
+  os << indent << "Attributes: " << m_Attributes << std::endl;
+  os << indent << "NumberOfPoints: " << m_NumberOfPoints << std::endl;
+  os << indent << "NumberOfFaces: " << m_NumberOfFaces << std::endl;
+  os << indent << "NumberOfScalarLayers: " << m_NumberOfScalarLayers << std::endl;
+}
+} // namespace itk
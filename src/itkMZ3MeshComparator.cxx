@@ -0,0 +1,329 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkMZ3MeshComparator.h"
+
+#include "itkMultiThreaderBase.h"
+#include "itk_zlib.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace itk
+{
+namespace
+{
+constexpr SizeValueType BlockSize = 4 * 1024 * 1024;
+
+/** A raw or gzip compressed file, read through zlib, which passes raw files through. */
+class DecodedFile
+{
+public:
+  explicit DecodedFile(const std::string & fileName)
+    : m_File(gzopen(fileName.c_str(), "rb"))
+  {
+    if (m_File == nullptr)
+    {
+      itkGenericExceptionMacro("File cannot be read: " << fileName);
+    }
+    gzbuffer(m_File, 1 << 20);
+  }
+
+  ~DecodedFile() { gzclose(m_File); }
+
+  DecodedFile(const DecodedFile &) = delete;
+  DecodedFile &
+  operator=(const DecodedFile &) = delete;
+
+  /** Read up to numberOfBytes bytes and return the number of bytes read. */
+  SizeValueType
+  Read(void * buffer, SizeValueType numberOfBytes)
+  {
+    SizeValueType bytesRead = 0;
+    while (bytesRead < numberOfBytes)
+    {
+      const auto request = static_cast<unsigned int>(std::min<SizeValueType>(numberOfBytes - bytesRead, 1u << 30));
+      const int  result = gzread(m_File, static_cast<uint8_t *>(buffer) + bytesRead, request);
+      if (result <= 0)
+      {
+        break;
+      }
+      bytesRead += static_cast<SizeValueType>(result);
+    }
+    return bytesRead;
+  }
+
+private:
+  gzFile m_File;
+};
+
+/** Read the next block of both files concurrently. */
+void
+ReadBlocks(DecodedFile &          baseline,
+           DecodedFile &          test,
+           std::vector<uint8_t> & baselineBlock,
+           std::vector<uint8_t> & testBlock,
+           SizeValueType          numberOfBytes,
+           SizeValueType          bytesRead[2])
+{
+  const auto multiThreader = MultiThreaderBase::New();
+  multiThreader->SetNumberOfWorkUnits(2);
+  multiThreader->ParallelizeArray(
+    0,
+    2,
+    [&](SizeValueType file) {
+      bytesRead[file] = file == 0 ? baseline.Read(baselineBlock.data(), numberOfBytes)
+                                  : test.Read(testBlock.data(), numberOfBytes);
+    },
+    nullptr);
+}
+
+/** Compare count values at baseline and test, whose first value has index first in the section. */
+template <typename T>
+void
+CompareValues(const T *                              baseline,
+              const T *                              test,
+              SizeValueType                          count,
+              SizeValueType                          first,
+              double                                 tolerance,
+              MZ3MeshComparator::SectionComparison & section)
+{
+  const bool isExact = tolerance == 0.0;
+  if (isExact && std::memcmp(baseline, test, count * sizeof(T)) == 0)
+  {
+    return;
+  }
+
+  // Without branches, so that the compiler vectorizes the loop
+  double        maximumError = 0.0;
+  SizeValueType numberOfDifferences = 0;
+  for (SizeValueType ii = 0; ii < count; ++ii)
+  {
+    const double error = std::abs(static_cast<double>(baseline[ii]) - static_cast<double>(test[ii]));
+    maximumError = error > maximumError ? error : maximumError;
+    const bool isNaN = (baseline[ii] != baseline[ii]) != (test[ii] != test[ii]);
+    numberOfDifferences += static_cast<SizeValueType>(error > tolerance || isNaN);
+  }
+  if (isExact)
+  {
+    // Values that are equal but differ in their bits, like 0 and -0, also count
+    numberOfDifferences = 0;
+    for (SizeValueType ii = 0; ii < count; ++ii)
+    {
+      numberOfDifferences += static_cast<SizeValueType>(std::memcmp(baseline + ii, test + ii, sizeof(T)) != 0);
+    }
+  }
+  section.m_MaximumError = std::max(section.m_MaximumError, maximumError);
+  if (numberOfDifferences == 0)
+  {
+    return;
+  }
+
+  if (section.m_NumberOfDifferences == 0)
+  {
+    for (SizeValueType ii = 0; ii < count; ++ii)
+    {
+      const bool isDifferent =
+        isExact ? std::memcmp(baseline + ii, test + ii, sizeof(T)) != 0
+                : std::abs(static_cast<double>(baseline[ii]) - static_cast<double>(test[ii])) > tolerance ||
+                    (baseline[ii] != baseline[ii]) != (test[ii] != test[ii]);
+      if (isDifferent)
+      {
+        section.m_FirstDifference = first + ii;
+        break;
+      }
+    }
+  }
+  section.m_NumberOfDifferences += numberOfDifferences;
+}
+
+/** Compare a section of numberOfValues values, or, for numberOfValues == 0, the rest of the files. */
+template <typename T>
+MZ3MeshComparator::SectionComparison
+CompareSection(const char *           name,
+               DecodedFile &          baseline,
+               DecodedFile &          test,
+               std::vector<uint8_t> & baselineBlock,
+               std::vector<uint8_t> & testBlock,
+               SizeValueType          numberOfValues,
+               double                 tolerance)
+{
+  MZ3MeshComparator::SectionComparison section;
+  section.m_Name = name;
+  const bool    isRest = numberOfValues == 0;
+  SizeValueType remaining = numberOfValues * sizeof(T);
+  while (isRest || remaining > 0)
+  {
+    const SizeValueType blockSize = isRest ? BlockSize : std::min(BlockSize, remaining);
+    SizeValueType       bytesRead[2] = { 0, 0 };
+    ReadBlocks(baseline, test, baselineBlock, testBlock, blockSize, bytesRead);
+
+    const SizeValueType count = std::min(bytesRead[0], bytesRead[1]) / sizeof(T);
+    CompareValues(reinterpret_cast<const T *>(baselineBlock.data()),
+                  reinterpret_cast<const T *>(testBlock.data()),
+                  count,
+                  section.m_NumberOfValues,
+                  tolerance,
+                  section);
+    section.m_NumberOfValues += count;
+
+    // Values that only one of the files holds differ
+    const SizeValueType missing = (std::max(bytesRead[0], bytesRead[1]) - count * sizeof(T)) / sizeof(T);
+    if (missing > 0 || bytesRead[0] != bytesRead[1])
+    {
+      if (section.m_NumberOfDifferences == 0)
+      {
+        section.m_FirstDifference = section.m_NumberOfValues;
+      }
+      section.m_NumberOfDifferences += std::max<SizeValueType>(missing, 1);
+      section.m_MaximumError = std::numeric_limits<double>::infinity();
+      break;
+    }
+    if (bytesRead[0] < blockSize)
+    {
+      break;
+    }
+    remaining -= isRest ? 0 : blockSize;
+  }
+  return section;
+}
+} // namespace
+
+bool
+MZ3MeshComparator::Compare()
+{
+  m_Sections.clear();
+  DecodedFile baseline(m_BaselineFileName);
+  DecodedFile test(m_TestFileName);
+
+  uint8_t headers[2][16]{};
+  if (baseline.Read(headers[0], 16) != 16 || headers[0][0] != 0x4D || headers[0][1] != 0x5A)
+  {
+    itkExceptionMacro("Not an MZ3 file: " << m_BaselineFileName);
+  }
+  if (test.Read(headers[1], 16) != 16 || headers[1][0] != 0x4D || headers[1][1] != 0x5A)
+  {
+    itkExceptionMacro("Not an MZ3 file: " << m_TestFileName);
+  }
+  uint16_t attr[2];
+  uint32_t nface[2], nvert[2], nskip[2];
+  for (unsigned int file = 0; file < 2; ++file)
+  {
+    std::memcpy(&attr[file], headers[file] + 2, sizeof(uint16_t));
+    std::memcpy(&nface[file], headers[file] + 4, sizeof(uint32_t));
+    std::memcpy(&nvert[file], headers[file] + 8, sizeof(uint32_t));
+    std::memcpy(&nskip[file], headers[file] + 12, sizeof(uint32_t));
+  }
+
+  // Attributes, number of faces and number of vertices
+  const uint32_t    baselineFields[3] = { attr[0], nface[0], nvert[0] };
+  const uint32_t    testFields[3] = { attr[1], nface[1], nvert[1] };
+  SectionComparison header;
+  header.m_Name = "Header";
+  header.m_NumberOfValues = 3;
+  CompareValues(baselineFields, testFields, 3, 0, 0.0, header);
+  if (header.m_NumberOfDifferences > 0)
+  {
+    m_Sections.push_back(header);
+    return false;
+  }
+
+  std::vector<uint8_t> baselineBlock(BlockSize);
+  std::vector<uint8_t> testBlock(BlockSize);
+  for (unsigned int file = 0; file < 2; ++file)
+  {
+    SizeValueType skipped = 0;
+    DecodedFile & decodedFile = file == 0 ? baseline : test;
+    while (skipped < nskip[file])
+    {
+      const SizeValueType bytesRead =
+        decodedFile.Read(baselineBlock.data(), std::min<SizeValueType>(BlockSize, nskip[file] - skipped));
+      if (bytesRead == 0)
+      {
+        itkExceptionMacro("Unexpected end of MZ3 data");
+      }
+      skipped += bytesRead;
+    }
+  }
+
+  const uint16_t      attributes = attr[0];
+  const SizeValueType numberOfVertices = nvert[0];
+  if (attributes & 1)
+  {
+    m_Sections.push_back(
+      CompareSection<uint32_t>("Faces", baseline, test, baselineBlock, testBlock, SizeValueType{ nface[0] } * 3, 0.0));
+  }
+  if (attributes & 2)
+  {
+    m_Sections.push_back(CompareSection<float>(
+      "Vertices", baseline, test, baselineBlock, testBlock, numberOfVertices * 3, m_CoordinateTolerance));
+  }
+  if (attributes & 4)
+  {
+    m_Sections.push_back(
+      CompareSection<uint8_t>("Colors", baseline, test, baselineBlock, testBlock, numberOfVertices * 4, 0.0));
+  }
+  // The scalar layers take up the rest of the files
+  if (attributes & 16)
+  {
+    m_Sections.push_back(
+      CompareSection<double>("Scalars", baseline, test, baselineBlock, testBlock, 0, m_ScalarTolerance));
+  }
+  else if (attributes & 8)
+  {
+    m_Sections.push_back(
+      CompareSection<float>("Scalars", baseline, test, baselineBlock, testBlock, 0, m_ScalarTolerance));
+  }
+
+  return std::all_of(m_Sections.begin(), m_Sections.end(), [](const SectionComparison & section) {
+    return section.m_NumberOfDifferences == 0;
+  });
+}
+
+void
+MZ3MeshComparator::PrintReport(std::ostream & os) const
+{
+  for (const SectionComparison & section : m_Sections)
+  {
+    os << section.m_Name << ": " << section.m_NumberOfValues << " values";
+    if (section.m_NumberOfDifferences > 0)
+    {
+      os << ", " << section.m_NumberOfDifferences << " differ, first at index " << section.m_FirstDifference;
+    }
+    else
+    {
+      os << ", all equal";
+    }
+    os << ", maximum error " << section.m_MaximumError << std::endl;
+  }
+}
+
+void
+MZ3MeshComparator::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "BaselineFileName: " << m_BaselineFileName << std::endl;
+  os << indent << "TestFileName: " << m_TestFileName << std::endl;
+  os << indent << "CoordinateTolerance: " << m_CoordinateTolerance << std::endl;
+  os << indent << "ScalarTolerance: " << m_ScalarTolerance << std::endl;
+  os << indent << "Sections: " << m_Sections.size() << std::endl;
+}
+} // namespace itk
@@ -17,378 +17,2328 @@
  *=========================================================================*/
 
 #include "itkMZ3MeshIO.h"
+#include "itkMZ3Decimation.h"
+#include "itkMZ3DecompressedCache.h"
+#include "itkMZ3OverlayMatrix.h"
+#include "itkMZ3ParallelGzipDecompressor.h"
 
 #include "itkMakeUniqueForOverwrite.h"
+#include "itkMultiThreaderBase.h"
 #include "itksys/SystemTools.hxx"
 #include "itkCommonEnums.h"
 
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <utility>
+
+#ifdef _WIN32
+#  include <io.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+#ifdef ITK_MZ3_USE_NUMA
+#  include <numa.h>
+#endif
+
 namespace itk
 {
+namespace
+{
+/** Ends an initialized deflate stream when it goes out of scope. */
+class DeflateEndGuard
+{
+public:
+  explicit DeflateEndGuard(z_stream & stream)
+    : m_Stream(stream)
+  {}
+  ~DeflateEndGuard() { deflateEnd(&m_Stream); }
+  DeflateEndGuard(const DeflateEndGuard &) = delete;
+  DeflateEndGuard &
+  operator=(const DeflateEndGuard &) = delete;
 
-MZ3MeshIO::MZ3MeshIO()
-  : m_Internal(std::make_unique<MZ3MeshIOInternals>())
+private:
+  z_stream & m_Stream;
+};
+
+/** Call a function when the scope is left by an exception, such as one that fails a write. */
+template <typename TFunction>
+class ExceptionGuard
 {
-  this->m_PointDimension = 3;
-  this->m_PointComponentType = IOComponentEnum::FLOAT;
-  this->m_CellComponentType = IOComponentEnum::UINT;
-  this->m_FileType = IOFileEnum::BINARY;
-  this->m_ByteOrder = IOByteOrderEnum::LittleEndian;
+public:
+  explicit ExceptionGuard(TFunction function)
+    : m_Function(std::move(function))
+    , m_NumberOfExceptions(std::uncaught_exceptions())
+  {}
+  ~ExceptionGuard()
+  {
+    if (std::uncaught_exceptions() > m_NumberOfExceptions)
+    {
+      m_Function();
+    }
+  }
+  ExceptionGuard(const ExceptionGuard &) = delete;
+  ExceptionGuard &
+  operator=(const ExceptionGuard &) = delete;
 
-  this->AddSupportedReadExtension(".mz3");
-  this->AddSupportedWriteExtension(".mz3");
-  this->m_UseCompression = true;
-  this->m_IsCompressed = true;
-}
+private:
+  TFunction m_Function;
+  int       m_NumberOfExceptions;
+};
 
-MZ3MeshIO::~MZ3MeshIO()
+/** Compress size bytes at data into a single gzip member. */
+std::vector<uint8_t>
+GzipCompress(const uint8_t * data, SizeValueType size)
 {
-  if (m_IsCompressed)
+  z_stream stream{};
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
   {
-    if (m_Internal->m_GzFile != nullptr)
+    itkGenericExceptionMacro("Failed to initialize the gzip compressor");
+  }
+  const DeflateEndGuard streamGuard(stream);
+  std::vector<uint8_t> output(deflateBound(&stream, static_cast<uLong>(size)));
+  SizeValueType        outputSize = 0;
+  int                  status = Z_OK;
+  stream.next_in = const_cast<Bytef *>(data);
+  while (status == Z_OK)
+  {
+    const auto inputSize = static_cast<uInt>(std::min<SizeValueType>(size, 1u << 30));
+    stream.avail_in = inputSize;
+    if (output.size() == outputSize)
     {
-      gzclose(m_Internal->m_GzFile);
-      m_Internal->m_GzFile = nullptr;
+      output.resize(outputSize + 65536);
     }
+    stream.next_out = output.data() + outputSize;
+    stream.avail_out = static_cast<uInt>(std::min<SizeValueType>(output.size() - outputSize, 1u << 30));
+    const uInt availableOut = stream.avail_out;
+    status = deflate(&stream, inputSize == size ? Z_FINISH : Z_NO_FLUSH);
+    outputSize += availableOut - stream.avail_out;
+    size -= inputSize - stream.avail_in;
   }
-  else
+  if (status != Z_STREAM_END)
   {
-    m_Ifstream.close();
+    itkGenericExceptionMacro("Failed to compress MZ3 data");
   }
+  output.resize(outputSize);
+  return output;
 }
 
+/** Flush file and ask the operating system to write it to the storage device. */
 bool
-MZ3MeshIO::CanReadFile(const char * fileName)
+FlushToDisk(FILE * file)
 {
-  if (!itksys::SystemTools::FileExists(fileName, true))
+  if (std::fflush(file) != 0)
   {
     return false;
   }
+#ifdef _WIN32
+  return _commit(_fileno(file)) == 0;
+#else
+  return fsync(fileno(file)) == 0;
+#endif
+}
 
-  if (itksys::SystemTools::GetFilenameLastExtension(fileName) != ".mz3")
+/** Ask the operating system to write the closed file fileName to the storage device. */
+bool
+FlushToDisk(const std::string & fileName)
+{
+  FILE *     file = std::fopen(fileName.c_str(), "r+b");
+  const bool isFlushed = file != nullptr && FlushToDisk(file);
+  if (file != nullptr)
   {
-    return false;
+    std::fclose(file);
   }
+  return isFlushed;
+}
 
-  std::ifstream file(fileName, std::ios::binary);
-  if (!file)
+#ifndef _WIN32
+/** Read up to numberOfBytes bytes at offset of fileDescriptor, retrying short reads. Returns the
+ * number of bytes read, which is less than numberOfBytes at the end of the file or on error. */
+SizeValueType
+PositionalRead(int fileDescriptor, void * buffer, SizeValueType numberOfBytes, SizeValueType offset)
+{
+  SizeValueType bytesRead = 0;
+  while (bytesRead < numberOfBytes)
   {
-    return false;
+    const ssize_t result = pread(fileDescriptor,
+                                 static_cast<uint8_t *>(buffer) + bytesRead,
+                                 static_cast<size_t>(numberOfBytes - bytesRead),
+                                 static_cast<off_t>(offset + bytesRead));
+    if (result < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (result <= 0)
+    {
+      break;
+    }
+    bytesRead += static_cast<SizeValueType>(result);
   }
+  return bytesRead;
+}
 
-  // Read magic number (first 2 bytes)
-  uint8_t magic1;
-  uint8_t magic2;
-  file.read((char *)&magic1, static_cast<std::streamsize>(sizeof(uint8_t)));
-  file.read((char *)&magic2, static_cast<std::streamsize>(sizeof(uint8_t)));
-
-  // Check for MZ3 signature
-  if (magic1 == 0x4D && magic2 == 0x5A)
+/** Write numberOfBytes bytes at offset of fileDescriptor, retrying short writes. */
+bool
+PositionalWrite(int fileDescriptor, const void * buffer, SizeValueType numberOfBytes, SizeValueType offset)
+{
+  SizeValueType bytesWritten = 0;
+  while (bytesWritten < numberOfBytes)
   {
-    return true;
+    const ssize_t result = pwrite(fileDescriptor,
+                                  static_cast<const uint8_t *>(buffer) + bytesWritten,
+                                  static_cast<size_t>(numberOfBytes - bytesWritten),
+                                  static_cast<off_t>(offset + bytesWritten));
+    if (result < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (result <= 0)
+    {
+      return false;
+    }
+    bytesWritten += static_cast<SizeValueType>(result);
   }
+  return true;
+}
+#endif
 
-  // Check for GZip signature
-  if (magic1 == 0x1F && magic2 == 0x8B)
-  {
-    return true;
-  }
+constexpr char     SkipRegionMagic[4] = { 'I', 'T', 'K', 'X' };
+constexpr uint32_t SkipRegionVersion = 1;
+constexpr char     SummaryTag[4] = { 'S', 'U', 'M', 'M' };
+constexpr uint32_t SummaryVersion = 1;
+constexpr char     SpatialChunksTag[4] = { 'C', 'H', 'N', 'K' };
+constexpr uint32_t SpatialChunksVersion = 1;
+// Bounds, first face, number of faces, first point and number of points of a chunk.
+constexpr SizeValueType SpatialChunkRecordSize = 6 * 4 + 4 * 4;
+// Skip regions larger than this are not searched for blocks.
+constexpr SizeValueType MaximumSkipRegionSize = 16 * 1024 * 1024;
 
-  return false;
+template <typename T>
+void
+AppendValue(std::vector<uint8_t> & bytes, T value)
+{
+  const auto begin = reinterpret_cast<const uint8_t *>(&value);
+  bytes.insert(bytes.end(), begin, begin + sizeof(T));
 }
 
-bool
-MZ3MeshIO::CanWriteFile(const char * fileName)
+/** Size of the payload of a summary block with the given number of layers and bins. */
+SizeValueType
+SummaryPayloadSize(SizeValueType numberOfLayers, SizeValueType numberOfBins)
 {
-  if (itksys::SystemTools::GetFilenameLastExtension(fileName) != ".mz3")
-  {
-    return false;
-  }
+  return 4 + 3 * 8 + 3 * 4 + 6 * 4 + 2 * 4 + numberOfLayers * (2 * 8 + numberOfBins * 4);
+}
 
-  return true;
+/** Size of the payload of a block of numberOfChunks spatial chunks. */
+SizeValueType
+SpatialChunksPayloadSize(SizeValueType numberOfChunks)
+{
+  return 4 + 4 + numberOfChunks * SpatialChunkRecordSize;
 }
 
-void
-MZ3MeshIO::ReadMeshInformation()
+/** Size of a skip region holding blocks of the given total size, including their tags and sizes,
+ * a multiple of 8 so that the sections after it stay aligned. */
+SizeValueType
+SkipRegionSize(SizeValueType blocksSize)
 {
-  // Check if file is gzip compressed
-  std::ifstream file(this->m_FileName.c_str(), std::ios::binary);
-  // Read magic number (first 2 bytes)
-  uint8_t magic1;
-  uint8_t magic2;
-  file.read((char *)&magic1, static_cast<std::streamsize>(sizeof(uint8_t)));
-  file.read((char *)&magic2, static_cast<std::streamsize>(sizeof(uint8_t)));
-  file.close();
+  return (8 + blocksSize + 7) / 8 * 8;
+}
 
-  // GZip signature (0x1F8B)
-  if (magic1 == 0x1F && magic2 == 0x8B)
+/** Number of leaves of the median split of numberOfFaces faces into chunks of at most
+ * maximumFacesPerChunk faces: the smallest sufficient power of two. */
+SizeValueType
+NumberOfSpatialChunks(SizeValueType numberOfFaces, SizeValueType maximumFacesPerChunk)
+{
+  if (numberOfFaces == 0)
   {
-    m_IsCompressed = true;
+    return 0;
   }
-  else
+  SizeValueType numberOfChunks = 1;
+  while (numberOfChunks * maximumFacesPerChunk < numberOfFaces)
   {
-    m_IsCompressed = false;
+    numberOfChunks *= 2;
   }
+  return numberOfChunks;
+}
 
-  if (m_IsCompressed)
+/** Append a SUMM block holding summary to bytes. */
+void
+AppendSummaryBlock(std::vector<uint8_t> & bytes, const MZ3MeshIO::Summary & summary)
+{
+  const SizeValueType numberOfBins = summary.m_Layers.empty() ? 0 : summary.m_Layers.front().m_Histogram.size();
+  bytes.insert(bytes.end(), SummaryTag, SummaryTag + 4);
+  AppendValue<uint32_t>(bytes, static_cast<uint32_t>(SummaryPayloadSize(summary.m_Layers.size(), numberOfBins)));
+  AppendValue<uint32_t>(bytes, SummaryVersion);
+  AppendValue<uint64_t>(bytes, summary.m_FaceSectionSize);
+  AppendValue<uint64_t>(bytes, summary.m_VertexSectionSize);
+  AppendValue<uint64_t>(bytes, summary.m_PointDataSectionSize);
+  AppendValue<uint32_t>(bytes, summary.m_FaceChecksum);
+  AppendValue<uint32_t>(bytes, summary.m_VertexChecksum);
+  AppendValue<uint32_t>(bytes, summary.m_PointDataChecksum);
+  for (const float bound : summary.m_Bounds)
   {
-    if (m_Internal->m_GzFile != nullptr)
+    AppendValue<float>(bytes, bound);
+  }
+  AppendValue<uint32_t>(bytes, static_cast<uint32_t>(summary.m_Layers.size()));
+  AppendValue<uint32_t>(bytes, static_cast<uint32_t>(numberOfBins));
+  for (const MZ3MeshIO::Summary::Layer & layer : summary.m_Layers)
+  {
+    AppendValue<double>(bytes, layer.m_Minimum);
+    AppendValue<double>(bytes, layer.m_Maximum);
+    for (const uint32_t count : layer.m_Histogram)
     {
-      gzclose(m_Internal->m_GzFile);
-      m_Internal->m_GzFile = nullptr;
+      AppendValue<uint32_t>(bytes, count);
     }
-    m_Internal->m_GzFile = gzopen(m_FileName.c_str(), "rb");
-    if (m_Internal->m_GzFile == nullptr)
+  }
+}
+
+/** Append a CHNK block holding chunks to bytes. */
+void
+AppendSpatialChunksBlock(std::vector<uint8_t> & bytes, const std::vector<MZ3MeshIO::SpatialChunk> & chunks)
+{
+  bytes.insert(bytes.end(), SpatialChunksTag, SpatialChunksTag + 4);
+  AppendValue<uint32_t>(bytes, static_cast<uint32_t>(SpatialChunksPayloadSize(chunks.size())));
+  AppendValue<uint32_t>(bytes, SpatialChunksVersion);
+  AppendValue<uint32_t>(bytes, static_cast<uint32_t>(chunks.size()));
+  for (const MZ3MeshIO::SpatialChunk & chunk : chunks)
+  {
+    for (const float bound : chunk.m_Bounds)
     {
-      ExceptionObject exception(__FILE__, __LINE__);
-      exception.SetDescription("File cannot be read");
-      throw exception;
+      AppendValue<float>(bytes, bound);
     }
+    AppendValue<uint32_t>(bytes, chunk.m_FirstFace);
+    AppendValue<uint32_t>(bytes, chunk.m_NumberOfFaces);
+    AppendValue<uint32_t>(bytes, chunk.m_FirstPoint);
+    AppendValue<uint32_t>(bytes, chunk.m_NumberOfPoints);
   }
-  else
+}
+
+/** Find the block tagged tag in the ITKX container of the skip region. */
+bool
+FindSkipRegionBlock(const uint8_t *  skip,
+                    SizeValueType    skipSize,
+                    const char *     tag,
+                    const uint8_t *& block,
+                    SizeValueType &  blockSize)
+{
+  if (skipSize < 8 || std::memcmp(skip, SkipRegionMagic, 4) != 0)
+  {
+    return false;
+  }
+  uint32_t version = 0;
+  std::memcpy(&version, skip + 4, 4);
+  if (version != SkipRegionVersion)
+  {
+    return false;
+  }
+  SizeValueType position = 8;
+  while (position + 8 <= skipSize)
   {
-    if (m_Ifstream.is_open())
+    uint32_t size = 0;
+    std::memcpy(&size, skip + position + 4, 4);
+    if (position + 8 + size > skipSize)
+    {
+      return false;
+    }
+    if (std::memcmp(skip + position, tag, 4) == 0)
     {
-      m_Ifstream.close();
+      block = skip + position + 8;
+      blockSize = size;
+      return true;
     }
-    m_Ifstream.open(m_FileName.c_str(), std::ios::binary);
+    position += 8 + size;
   }
+  return false;
+}
 
-  // Read 16-byte header
-  uint16_t magic, attr;
-  uint32_t nface, nvert, nskip;
+/** Decode the SUMM block of the skip region into summary. */
+bool
+DecodeSummary(const uint8_t * skip, SizeValueType skipSize, MZ3MeshIO::Summary & summary)
+{
+  const uint8_t * block = nullptr;
+  SizeValueType   blockSize = 0;
+  if (!FindSkipRegionBlock(skip, skipSize, SummaryTag, block, blockSize))
+  {
+    return false;
+  }
 
-  if (m_IsCompressed)
+  SizeValueType offset = 0;
+  const auto    read = [&](void * value, SizeValueType size) {
+    const bool isInside = offset + size <= blockSize;
+    if (isInside)
+    {
+      std::memcpy(value, block + offset, size);
+    }
+    offset += size;
+    return isInside;
+  };
+  uint32_t summaryVersion = 0;
+  uint64_t sizes[3];
+  uint32_t counts[2];
+  // The counts are bounded before the payload size is computed from them, so that it cannot wrap
+  if (!read(&summaryVersion, 4) || summaryVersion != SummaryVersion || !read(sizes, sizeof(sizes)) ||
+      !read(&summary.m_FaceChecksum, 4) || !read(&summary.m_VertexChecksum, 4) ||
+      !read(&summary.m_PointDataChecksum, 4) || !read(summary.m_Bounds, sizeof(summary.m_Bounds)) ||
+      !read(counts, sizeof(counts)) || counts[0] > blockSize / 16 || counts[1] > blockSize / 4 ||
+      SummaryPayloadSize(counts[0], counts[1]) > blockSize)
   {
-    gzread(m_Internal->m_GzFile, (char *)&magic, static_cast<unsigned int>(sizeof(magic)));
-    gzread(m_Internal->m_GzFile, (char *)&attr, static_cast<unsigned int>(sizeof(attr)));
-    gzread(m_Internal->m_GzFile, (char *)&nface, static_cast<unsigned int>(sizeof(nface)));
-    gzread(m_Internal->m_GzFile, (char *)&nvert, static_cast<unsigned int>(sizeof(nvert)));
-    gzread(m_Internal->m_GzFile, (char *)&nskip, static_cast<unsigned int>(sizeof(nskip)));
+    return false;
   }
-  else
+  summary.m_FaceSectionSize = sizes[0];
+  summary.m_VertexSectionSize = sizes[1];
+  summary.m_PointDataSectionSize = sizes[2];
+  summary.m_Layers.resize(counts[0]);
+  for (MZ3MeshIO::Summary::Layer & layer : summary.m_Layers)
   {
-    m_Ifstream.read((char *)&magic, static_cast<std::streamsize>(sizeof(magic)));
-    m_Ifstream.read((char *)&attr, static_cast<std::streamsize>(sizeof(attr)));
-    m_Ifstream.read((char *)&nface, static_cast<std::streamsize>(sizeof(nface)));
-    m_Ifstream.read((char *)&nvert, static_cast<std::streamsize>(sizeof(nvert)));
-    m_Ifstream.read((char *)&nskip, static_cast<std::streamsize>(sizeof(nskip)));
+    layer.m_Histogram.resize(counts[1]);
+    read(&layer.m_Minimum, 8);
+    read(&layer.m_Maximum, 8);
+    read(layer.m_Histogram.data(), counts[1] * 4);
   }
+  return true;
+}
 
-  // const auto isFace = (attr & 1) != 0;
-  const auto isVert = (attr & 2) != 0;
-  const auto isRGBA = (attr & 4) != 0;
-  const auto isScalar = (attr & 8) != 0;
-  const auto isDouble = (attr & 16) != 0;
-
-  // Set mesh information
-  if (isVert)
+/** Decode the CHNK block of the skip region into chunks, checking every chunk against the
+ * numbers of faces and points of the file. */
+bool
+DecodeSpatialChunks(const uint8_t *                       skip,
+                    SizeValueType                         skipSize,
+                    SizeValueType                         numberOfFaces,
+                    SizeValueType                         numberOfPoints,
+                    std::vector<MZ3MeshIO::SpatialChunk> & chunks)
+{
+  const uint8_t * block = nullptr;
+  SizeValueType   blockSize = 0;
+  uint32_t        header[2] = { 0, 0 };
+  if (!FindSkipRegionBlock(skip, skipSize, SpatialChunksTag, block, blockSize) || blockSize < sizeof(header))
   {
-    this->m_NumberOfPoints = nvert;
+    return false;
   }
-  else
+  std::memcpy(header, block, sizeof(header));
+  if (header[0] != SpatialChunksVersion || SpatialChunksPayloadSize(header[1]) > blockSize)
   {
-    this->m_NumberOfPoints = 0;
+    return false;
   }
-  this->m_NumberOfCells = nface;
-  this->m_PointDimension = 3;
-  if (this->m_NumberOfPoints == 0)
+  chunks.resize(header[1]);
+  const uint8_t * record = block + sizeof(header);
+  for (MZ3MeshIO::SpatialChunk & chunk : chunks)
   {
-    this->m_UpdatePoints = false;
+    std::memcpy(chunk.m_Bounds, record, sizeof(chunk.m_Bounds));
+    uint32_t ranges[4];
+    std::memcpy(ranges, record + sizeof(chunk.m_Bounds), sizeof(ranges));
+    record += SpatialChunkRecordSize;
+    chunk.m_FirstFace = ranges[0];
+    chunk.m_NumberOfFaces = ranges[1];
+    chunk.m_FirstPoint = ranges[2];
+    chunk.m_NumberOfPoints = ranges[3];
+    if (SizeValueType{ ranges[0] } + ranges[1] > numberOfFaces ||
+        SizeValueType{ ranges[2] } + ranges[3] > numberOfPoints)
+    {
+      chunks.clear();
+      return false;
+    }
   }
-  else
+  return true;
+}
+
+/** Size, in bytes, of a point pixel component of type componentType that MZ3MeshIO writes. */
+SizeValueType
+PointPixelComponentSize(IOComponentEnum componentType)
+{
+  switch (componentType)
   {
-    this->m_UpdatePoints = true;
+    case IOComponentEnum::UCHAR:
+    case IOComponentEnum::CHAR:
+      return 1;
+    case IOComponentEnum::USHORT:
+    case IOComponentEnum::SHORT:
+      return 2;
+    case IOComponentEnum::FLOAT:
+      return 4;
+    case IOComponentEnum::DOUBLE:
+      return 8;
+    default:
+      itkGenericExceptionMacro("Unsupported point pixel component type");
   }
-  if (this->m_NumberOfCells == 0)
+}
+
+/** Accumulate the bounds and checksum of numberOfPoints vertices, as they are stored as floats. */
+template <typename T>
+void
+SummarizePoints(const T * buffer, SizeValueType numberOfPoints, MZ3MeshIO::Summary & summary)
+{
+  float * bounds = summary.m_Bounds;
+  for (unsigned int ii = 0; ii < 3; ++ii)
   {
-    this->m_UpdateCells = false;
+    bounds[2 * ii] = numberOfPoints > 0 ? std::numeric_limits<float>::max() : 0.0f;
+    bounds[2 * ii + 1] = numberOfPoints > 0 ? std::numeric_limits<float>::lowest() : 0.0f;
   }
-  else
+  constexpr SizeValueType blockSize = 4096 * 3;
+  float                   block[blockSize];
+  uLong                   checksum = crc32(0L, Z_NULL, 0);
+  for (SizeValueType begin = 0; begin < numberOfPoints * 3; begin += blockSize)
   {
-    this->m_UpdateCells = true;
+    const SizeValueType count = std::min(blockSize, numberOfPoints * 3 - begin);
+    for (SizeValueType ii = 0; ii < count; ++ii)
+    {
+      block[ii] = static_cast<float>(buffer[begin + ii]);
+      float & minimum = bounds[2 * (ii % 3)];
+      float & maximum = bounds[2 * (ii % 3) + 1];
+      minimum = std::min(minimum, block[ii]);
+      maximum = std::max(maximum, block[ii]);
+    }
+    checksum = crc32(checksum, reinterpret_cast<const Bytef *>(block), static_cast<uInt>(count * sizeof(float)));
   }
-  this->m_CellBufferSize = this->m_NumberOfCells * (3 + 2);
+  summary.m_VertexChecksum = static_cast<uint32_t>(checksum);
+}
 
-  // Set point and cell component types
-  this->m_PointComponentType = IOComponentEnum::FLOAT;
-  this->m_CellComponentType = IOComponentEnum::UINT;
-  this->m_FileType = IOFileEnum::BINARY;
-  this->m_ByteOrder = IOByteOrderEnum::LittleEndian;
+/** Compute the statistics of every layer and the checksum of the scalars, as they are stored as
+ * TStored. */
+template <typename TStored, typename TInput>
+void
+SummarizeScalars(const TInput * buffer, SizeValueType numberOfValues, MZ3MeshIO::Summary & summary)
+{
+  constexpr SizeValueType blockSize = 4096;
+  TStored                 block[blockSize];
+  uLong                   checksum = crc32(0L, Z_NULL, 0);
+  for (SizeValueType begin = 0; begin < numberOfValues; begin += blockSize)
+  {
+    const SizeValueType count = std::min(blockSize, numberOfValues - begin);
+    for (SizeValueType ii = 0; ii < count; ++ii)
+    {
+      block[ii] = static_cast<TStored>(buffer[begin + ii]);
+    }
+    checksum = crc32(checksum, reinterpret_cast<const Bytef *>(block), static_cast<uInt>(count * sizeof(TStored)));
+  }
+  summary.m_PointDataChecksum = static_cast<uint32_t>(checksum);
 
-  if (isScalar)
+  const SizeValueType numberOfLayers = summary.m_Layers.size();
+  const SizeValueType layerSize = numberOfLayers > 0 ? numberOfValues / numberOfLayers : 0;
+  for (SizeValueType layerIndex = 0; layerIndex < numberOfLayers; ++layerIndex)
   {
-    this->m_PointPixelType = IOPixelEnum::SCALAR;
-    this->m_PointPixelComponentType = IOComponentEnum::FLOAT;
-    this->m_NumberOfPointPixelComponents = 1;
-    this->m_NumberOfPointPixels = nvert;
-    this->m_UpdatePointData = true;
+    MZ3MeshIO::Summary::Layer & layer = summary.m_Layers[layerIndex];
+    const TInput *              values = buffer + layerIndex * layerSize;
+    double                      minimum = std::numeric_limits<double>::max();
+    double                      maximum = std::numeric_limits<double>::lowest();
+    for (SizeValueType ii = 0; ii < layerSize; ++ii)
+    {
+      const auto value = static_cast<double>(static_cast<TStored>(values[ii]));
+      minimum = value < minimum ? value : minimum;
+      maximum = value > maximum ? value : maximum;
+    }
+    std::fill(layer.m_Histogram.begin(), layer.m_Histogram.end(), 0);
+    if (minimum > maximum)
+    {
+      // No value that is not NaN
+      layer.m_Minimum = std::numeric_limits<double>::quiet_NaN();
+      layer.m_Maximum = std::numeric_limits<double>::quiet_NaN();
+      continue;
+    }
+    layer.m_Minimum = minimum;
+    layer.m_Maximum = maximum;
+    const SizeValueType numberOfBins = layer.m_Histogram.size();
+    const double        scale = maximum > minimum ? numberOfBins / (maximum - minimum) : 0.0;
+    for (SizeValueType ii = 0; ii < layerSize; ++ii)
+    {
+      const auto value = static_cast<double>(static_cast<TStored>(values[ii]));
+      if (value == value)
+      {
+        const auto bin = static_cast<SizeValueType>((value - minimum) * scale);
+        ++layer.m_Histogram[std::min(bin, numberOfBins - 1)];
+      }
+    }
   }
-  else if (isDouble)
+}
+
+constexpr SizeValueType PageSize = 4096;
+constexpr SizeValueType HugePageSize = 2 * 1024 * 1024;
+// Buffers smaller than this span too few pages to be worth placing.
+constexpr SizeValueType PlacementMinimumSize = 64 * 1024;
+
+/** Call fill(begin, end) for one range of the numberOfBytes bytes at buffer per work unit. The
+ * ranges are contiguous and of nearly equal size, as MultiThreaderBase::ParallelizeArray() splits
+ * an array, and start on page boundaries so that no page is touched by two work units. */
+template <typename TFill>
+void
+FillInParallel(const void * buffer, SizeValueType numberOfBytes, const TFill & fill)
+{
+  const auto          address = reinterpret_cast<uintptr_t>(buffer);
+  const SizeValueType head = std::min<SizeValueType>(numberOfBytes, (PageSize - address % PageSize) % PageSize);
+  const SizeValueType numberOfPages = (numberOfBytes - head + PageSize - 1) / PageSize;
+  const auto          numberOfWorkUnits = static_cast<unsigned int>(std::max<SizeValueType>(
+    1, std::min<SizeValueType>(MultiThreaderBase::GetGlobalDefaultNumberOfThreads(), numberOfPages)));
+  const auto          boundary = [=](SizeValueType workUnit) {
+    if (workUnit == 0)
+    {
+      return SizeValueType{ 0 };
+    }
+    return std::min(numberOfBytes, head + numberOfPages * workUnit / numberOfWorkUnits * PageSize);
+  };
+
+  const auto multiThreader = MultiThreaderBase::New();
+  multiThreader->SetNumberOfWorkUnits(numberOfWorkUnits);
+  multiThreader->ParallelizeArray(
+    0,
+    numberOfWorkUnits,
+    [&](SizeValueType workUnit) {
+      const SizeValueType begin = boundary(workUnit);
+      const SizeValueType end = boundary(workUnit + 1);
+      if (begin < end)
+      {
+        fill(begin, end);
+      }
+    },
+    nullptr);
+}
+
+/** Transform the numberOfPoints points of input by the rows of an affine matrix into output,
+ * which may be input. Work units transform the points that start in their page aligned ranges
+ * of output. Without branches in the loops, the compiler vectorizes them. */
+template <typename TCompute, typename TInput>
+void
+TransformPoints(const double * matrix,
+                bool           isFlippingAxes,
+                const TInput * input,
+                float *        output,
+                SizeValueType  numberOfPoints)
+{
+  constexpr SizeValueType pointBytes = 3 * sizeof(float);
+  FillInParallel(output, numberOfPoints * pointBytes, [=](SizeValueType begin, SizeValueType end) {
+    const SizeValueType first = (begin + pointBytes - 1) / pointBytes;
+    const SizeValueType last = (end + pointBytes - 1) / pointBytes;
+    if (isFlippingAxes)
+    {
+      const TCompute sign[3] = { static_cast<TCompute>(matrix[0]),
+                                 static_cast<TCompute>(matrix[5]),
+                                 static_cast<TCompute>(matrix[10]) };
+      for (SizeValueType ii = first * 3; ii < last * 3; ii += 3)
+      {
+        output[ii] = static_cast<float>(sign[0] * static_cast<TCompute>(input[ii]));
+        output[ii + 1] = static_cast<float>(sign[1] * static_cast<TCompute>(input[ii + 1]));
+        output[ii + 2] = static_cast<float>(sign[2] * static_cast<TCompute>(input[ii + 2]));
+      }
+      return;
+    }
+    TCompute m[12];
+    std::copy_n(matrix, 12, m);
+    for (SizeValueType ii = first * 3; ii < last * 3; ii += 3)
+    {
+      const auto x = static_cast<TCompute>(input[ii]);
+      const auto y = static_cast<TCompute>(input[ii + 1]);
+      const auto z = static_cast<TCompute>(input[ii + 2]);
+      output[ii] = static_cast<float>(m[0] * x + m[1] * y + m[2] * z + m[3]);
+      output[ii + 1] = static_cast<float>(m[4] * x + m[5] * y + m[6] * z + m[7]);
+      output[ii + 2] = static_cast<float>(m[8] * x + m[9] * y + m[10] * z + m[11]);
+    }
+  });
+}
+
+/** Set offsets[i + 1] to the sum of counts[0] to counts[i], and offsets[0] to zero, summing
+ * blocks of rows concurrently. */
+template <typename TCount>
+void
+PrefixSumInParallel(const TCount * counts, SizeValueType numberOfRows, std::vector<SizeValueType> & offsets)
+{
+  constexpr SizeValueType    rowsPerBlock = 16384;
+  const SizeValueType        numberOfBlocks = (numberOfRows + rowsPerBlock - 1) / rowsPerBlock;
+  std::vector<SizeValueType> blockOffsets(numberOfBlocks + 1, 0);
+  offsets.resize(numberOfRows + 1);
+
+  const auto multiThreader = MultiThreaderBase::New();
+  multiThreader->ParallelizeArray(
+    0,
+    numberOfBlocks,
+    [&](SizeValueType block) {
+      const SizeValueType end = std::min(numberOfRows, (block + 1) * rowsPerBlock);
+      SizeValueType       sum = 0;
+      for (SizeValueType row = block * rowsPerBlock; row < end; ++row)
+      {
+        sum += counts[row];
+      }
+      blockOffsets[block + 1] = sum;
+    },
+    nullptr);
+  std::partial_sum(blockOffsets.begin(), blockOffsets.end(), blockOffsets.begin());
+  multiThreader->ParallelizeArray(
+    0,
+    numberOfBlocks,
+    [&](SizeValueType block) {
+      const SizeValueType end = std::min(numberOfRows, (block + 1) * rowsPerBlock);
+      SizeValueType       sum = blockOffsets[block];
+      for (SizeValueType row = block * rowsPerBlock; row < end; ++row)
+      {
+        offsets[row] = sum;
+        sum += counts[row];
+      }
+    },
+    nullptr);
+  offsets[numberOfRows] = blockOffsets[numberOfBlocks];
+}
+/** Mean of the valuesPerPoint values of the points that pointMap merges into every one of
+ * numberOfPoints points. */
+std::vector<double>
+ResamplePointData(const std::vector<double> &   values,
+                  SizeValueType                 valuesPerPoint,
+                  const std::vector<uint32_t> & pointMap,
+                  SizeValueType                 numberOfPoints)
+{
+  std::vector<double>        means(numberOfPoints * valuesPerPoint);
+  std::vector<SizeValueType> counts(numberOfPoints);
+  for (SizeValueType ii = 0; ii < pointMap.size(); ++ii)
   {
-    this->m_PointPixelType = IOPixelEnum::SCALAR;
-    this->m_PointPixelComponentType = IOComponentEnum::DOUBLE;
-    this->m_NumberOfPointPixelComponents = 1;
-    this->m_NumberOfPointPixels = nvert;
-    this->m_UpdatePointData = true;
+    for (SizeValueType kk = 0; kk < valuesPerPoint; ++kk)
+    {
+      means[SizeValueType{ pointMap[ii] } * valuesPerPoint + kk] += values[ii * valuesPerPoint + kk];
+    }
+    ++counts[pointMap[ii]];
   }
-  else if (isRGBA)
+  for (SizeValueType ii = 0; ii < numberOfPoints; ++ii)
   {
-    this->m_PointPixelType = IOPixelEnum::RGBA;
-    this->m_PointPixelComponentType = IOComponentEnum::UCHAR;
-    this->m_NumberOfPointPixelComponents = 4;
-    this->m_NumberOfPointPixels = nvert;
+    for (SizeValueType kk = 0; kk < valuesPerPoint && counts[ii] > 1; ++kk)
+    {
+      means[ii * valuesPerPoint + kk] /= static_cast<double>(counts[ii]);
+    }
+  }
+  return means;
+}
+} // namespace
+
+std::ostream &
+operator<<(std::ostream & out, const MZ3MeshIOEnums::MemoryPlacement value)
+{
+  return out << [value] {
+    switch (value)
+    {
+      case MZ3MeshIOEnums::MemoryPlacement::Default:
+        return "itk::MZ3MeshIOEnums::MemoryPlacement::Default";
+      case MZ3MeshIOEnums::MemoryPlacement::FirstTouch:
+        return "itk::MZ3MeshIOEnums::MemoryPlacement::FirstTouch";
+      case MZ3MeshIOEnums::MemoryPlacement::Interleaved:
+        return "itk::MZ3MeshIOEnums::MemoryPlacement::Interleaved";
+      default:
+        return "INVALID VALUE FOR itk::MZ3MeshIOEnums::MemoryPlacement";
+    }
+  }();
+}
+
+std::ostream &
+operator<<(std::ostream & out, const MZ3MeshIOEnums::Durability value)
+{
+  return out << [value] {
+    switch (value)
+    {
+      case MZ3MeshIOEnums::Durability::None:
+        return "itk::MZ3MeshIOEnums::Durability::None";
+      case MZ3MeshIOEnums::Durability::Sync:
+        return "itk::MZ3MeshIOEnums::Durability::Sync";
+      default:
+        return "INVALID VALUE FOR itk::MZ3MeshIOEnums::Durability";
+    }
+  }();
+}
+
+void
+MZ3MeshIO::MZ3MeshIOInternals::DeflateStreamDeleter::operator()(z_stream * stream) const
+{
+  deflateEnd(stream);
+  delete stream;
+}
+
+MZ3MeshIO::MZ3MeshIO()
+  : m_Internal(std::make_unique<MZ3MeshIOInternals>())
+{
+  this->m_PointDimension = 3;
+  this->m_PointComponentType = IOComponentEnum::FLOAT;
+  this->m_CellComponentType = IOComponentEnum::UINT;
+  this->m_FileType = IOFileEnum::BINARY;
+  this->m_ByteOrder = IOByteOrderEnum::LittleEndian;
+
+  this->AddSupportedReadExtension(".mz3");
+  this->AddSupportedWriteExtension(".mz3");
+  this->m_UseCompression = true;
+  this->m_IsCompressed = true;
+  m_PointTransform.SetIdentity();
+}
+
+MZ3MeshIO::~MZ3MeshIO()
+{
+  this->CloseInput();
+#ifndef _WIN32
+  if (m_Internal->m_OutputFileDescriptor >= 0)
+  {
+    close(m_Internal->m_OutputFileDescriptor);
+  }
+#endif
+}
+
+void
+MZ3MeshIO::CloseInput()
+{
+  if (m_Internal->m_GzFile != nullptr)
+  {
+    gzclose(m_Internal->m_GzFile);
+    m_Internal->m_GzFile = nullptr;
+  }
+  if (m_Ifstream.is_open())
+  {
+    m_Ifstream.close();
+  }
+#ifndef _WIN32
+  for (int * fileDescriptor : { &m_Internal->m_FileDescriptor, &m_Internal->m_DirectFileDescriptor })
+  {
+    if (*fileDescriptor >= 0)
+    {
+      close(*fileDescriptor);
+      *fileDescriptor = -1;
+    }
+  }
+#endif
+}
+
+bool
+MZ3MeshIO::CanReadFile(const char * fileName)
+{
+  std::string archiveFileName;
+  std::string entryName;
+  if (MZ3Archive::SplitEntryPath(fileName, archiveFileName, entryName))
+  {
+    const auto archive = MZ3Archive::New();
+    archive->SetFileName(archiveFileName);
+    try
+    {
+      archive->Open();
+    }
+    catch (const ExceptionObject &)
+    {
+      return false;
+    }
+    return archive->FindEntry(entryName) != nullptr;
+  }
+
+  if (!itksys::SystemTools::FileExists(fileName, true))
+  {
+    return false;
+  }
+
+  if (itksys::SystemTools::GetFilenameLastExtension(fileName) != ".mz3")
+  {
+    return false;
+  }
+
+  std::ifstream file(fileName, std::ios::binary);
+  if (!file)
+  {
+    return false;
+  }
+
+  // Read magic number (first 2 bytes)
+  uint8_t magic1;
+  uint8_t magic2;
+  file.read((char *)&magic1, static_cast<std::streamsize>(sizeof(uint8_t)));
+  file.read((char *)&magic2, static_cast<std::streamsize>(sizeof(uint8_t)));
+
+  // Check for MZ3 signature
+  if (magic1 == 0x4D && magic2 == 0x5A)
+  {
+    return true;
+  }
+
+  // Check for GZip signature
+  if (magic1 == 0x1F && magic2 == 0x8B)
+  {
+    return true;
+  }
+
+  return false;
+}
+
+bool
+MZ3MeshIO::CanWriteFile(const char * fileName)
+{
+  if (itksys::SystemTools::GetFilenameLastExtension(fileName) != ".mz3")
+  {
+    return false;
+  }
+
+  return true;
+}
+
+void
+MZ3MeshIO::SetInputBuffer(const void * buffer, SizeValueType size)
+{
+  m_InputBuffer = buffer;
+  m_InputBufferSize = buffer != nullptr ? size : 0;
+  this->Modified();
+}
+
+void
+MZ3MeshIO::ReadMeshInformation()
+{
+  this->CloseInput();
+  m_Internal->m_Payload.clear();
+  m_Internal->m_PayloadData = nullptr;
+  m_Internal->m_PayloadSize = 0;
+  m_Internal->m_Points.clear();
+  m_Internal->m_Faces.clear();
+  m_Internal->m_VertexNormals.clear();
+  m_Internal->m_FaceAreas.clear();
+  m_Internal->m_VertexFaceOffsets.clear();
+  m_Internal->m_VertexFaces.clear();
+  m_Internal->m_VertexNeighborOffsets.clear();
+  m_Internal->m_VertexNeighbors.clear();
+  m_Internal->m_Geometry = nullptr;
+  m_SpatialIndex = nullptr;
+  m_NumberOfBytesProcessed = 0;
+  m_NumberOfBytesToProcess = 0;
+  m_Internal->m_NextProgressReport = 0;
+  this->SetAbortGenerateData(false);
+  // A read never removes its input, even after a write of this object failed
+  m_Internal->m_IsWriting = false;
+  m_Internal->m_IsWritingLevelsOfDetail = false;
+  m_Internal->m_InputFileName = GetLevelOfDetailFileName(m_FileName, m_LevelOfDetail);
+  const std::string & fileName = m_Internal->m_InputFileName;
+
+  const auto decompressor = MZ3ParallelGzipDecompressor::New();
+  if (!m_UseParallelDecompression)
+  {
+    // A single work unit inflates with zlib directly.
+    decompressor->SetNumberOfWorkUnits(1);
+  }
+
+  // An archive entry is read with one positioned read and decoded like an input buffer
+  const uint8_t * inputBytes = static_cast<const uint8_t *>(m_InputBuffer);
+  SizeValueType   inputSize = m_InputBufferSize;
+  std::string     archiveFileName;
+  std::string     entryName;
+  m_Internal->m_ArchiveEntry.clear();
+  if (inputBytes == nullptr && MZ3Archive::SplitEntryPath(fileName, archiveFileName, entryName))
+  {
+    this->UpdateArchive(archiveFileName);
+    m_Archive->ReadEntry(entryName, m_Internal->m_ArchiveEntry);
+    inputBytes = m_Internal->m_ArchiveEntry.data();
+    inputSize = m_Internal->m_ArchiveEntry.size();
+  }
+
+  if (inputBytes != nullptr)
+  {
+    m_IsCompressed = inputSize >= 2 && inputBytes[0] == 0x1F && inputBytes[1] == 0x8B;
+    if (m_IsCompressed)
+    {
+      decompressor->Decompress(inputBytes, inputSize, m_Internal->m_Payload);
+      m_Internal->m_PayloadData = m_Internal->m_Payload.data();
+      m_Internal->m_PayloadSize = m_Internal->m_Payload.size();
+    }
+    else if (inputSize >= 2 && inputBytes[0] == 0x4D && inputBytes[1] == 0x5A)
+    {
+      m_Internal->m_PayloadData = inputBytes;
+      m_Internal->m_PayloadSize = inputSize;
+    }
+    else
+    {
+      itkExceptionMacro("Input buffer does not hold MZ3 data");
+    }
+  }
+  else
+  {
+    // Check if file is gzip compressed
+    std::ifstream file(fileName.c_str(), std::ios::binary);
+    // Read magic number (first 2 bytes)
+    uint8_t magic1 = 0;
+    uint8_t magic2 = 0;
+    file.read((char *)&magic1, static_cast<std::streamsize>(sizeof(uint8_t)));
+    file.read((char *)&magic2, static_cast<std::streamsize>(sizeof(uint8_t)));
+
+    // GZip signature (0x1F8B)
+    if (magic1 == 0x1F && magic2 == 0x8B)
+    {
+      m_IsCompressed = true;
+    }
+    else
+    {
+      m_IsCompressed = false;
+    }
+
+    // A compressed file in the decompressed cache is read like an uncompressed file
+    std::string rawFileName = fileName;
+    if (m_IsCompressed && !m_DecompressedCacheDirectory.empty())
+    {
+      const auto cache = MZ3DecompressedCache::New();
+      cache->SetDirectory(m_DecompressedCacheDirectory);
+      cache->SetMaximumSize(m_DecompressedCacheMaximumSize);
+      rawFileName = cache->GetCachedFileName(fileName);
+      m_IsCompressed = false;
+    }
+
+    if (m_IsCompressed && m_UseParallelDecompression)
+    {
+      file.seekg(0, std::ios::end);
+      std::vector<uint8_t> compressed(static_cast<size_t>(file.tellg()));
+      file.seekg(0);
+      file.read(reinterpret_cast<char *>(compressed.data()), static_cast<std::streamsize>(compressed.size()));
+      if (!file)
+      {
+        itkExceptionMacro("File cannot be read");
+      }
+      decompressor->Decompress(compressed.data(), compressed.size(), m_Internal->m_Payload);
+      m_Internal->m_PayloadData = m_Internal->m_Payload.data();
+      m_Internal->m_PayloadSize = m_Internal->m_Payload.size();
+    }
+    else if (m_IsCompressed)
+    {
+      m_Internal->m_GzFile = gzopen(fileName.c_str(), "rb");
+      if (m_Internal->m_GzFile == nullptr)
+      {
+        ExceptionObject exception(__FILE__, __LINE__);
+        exception.SetDescription("File cannot be read");
+        throw exception;
+      }
+    }
+    else
+    {
+      m_Ifstream.open(rawFileName.c_str(), std::ios::binary);
+      if (!m_Ifstream.is_open())
+      {
+        itkExceptionMacro("File cannot be read");
+      }
+#ifndef _WIN32
+      if (m_ParallelReadMinimumSize > 0)
+      {
+        m_Internal->m_FileDescriptor = open(rawFileName.c_str(), O_RDONLY);
+#  ifdef POSIX_FADV_SEQUENTIAL
+        if (m_Internal->m_FileDescriptor >= 0)
+        {
+          posix_fadvise(m_Internal->m_FileDescriptor, 0, 0, POSIX_FADV_SEQUENTIAL);
+        }
+#  endif
+#  ifdef O_DIRECT
+        if (m_UseDirectIO && m_Internal->m_FileDescriptor >= 0)
+        {
+          m_Internal->m_DirectFileDescriptor = open(rawFileName.c_str(), O_RDONLY | O_DIRECT);
+        }
+#  endif
+      }
+#endif
+    }
+  }
+
+  // Read 16-byte header
+  uint8_t header[16];
+  this->ReadBytes(0, header, sizeof(header));
+  uint16_t magic, attr;
+  uint32_t nface, nvert, nskip;
+  std::memcpy(&magic, header, sizeof(magic));
+  std::memcpy(&attr, header + 2, sizeof(attr));
+  std::memcpy(&nface, header + 4, sizeof(nface));
+  std::memcpy(&nvert, header + 8, sizeof(nvert));
+  std::memcpy(&nskip, header + 12, sizeof(nskip));
+
+  // const auto isFace = (attr & 1) != 0;
+  const auto isVert = (attr & 2) != 0;
+  const auto isRGBA = (attr & 4) != 0;
+  const auto isScalar = (attr & 8) != 0;
+  const auto isDouble = (attr & 16) != 0;
+
+  // Set mesh information
+  if (isVert)
+  {
+    this->m_NumberOfPoints = nvert;
+  }
+  else
+  {
+    this->m_NumberOfPoints = 0;
+  }
+  this->m_NumberOfCells = nface;
+  m_Internal->m_NumberOfFaces = nface;
+  this->m_PointDimension = 3;
+  if (this->m_NumberOfPoints == 0)
+  {
+    this->m_UpdatePoints = false;
+  }
+  else
+  {
+    this->m_UpdatePoints = true;
+  }
+  if (this->m_NumberOfCells == 0)
+  {
+    this->m_UpdateCells = false;
+  }
+  else
+  {
+    this->m_UpdateCells = true;
+  }
+  this->m_CellBufferSize = this->m_NumberOfCells * (3 + 2);
+
+  // Set point and cell component types
+  this->m_PointComponentType = IOComponentEnum::FLOAT;
+  this->m_CellComponentType = IOComponentEnum::UINT;
+  this->m_FileType = IOFileEnum::BINARY;
+  this->m_ByteOrder = IOByteOrderEnum::LittleEndian;
+
+  if (isScalar)
+  {
+    this->m_PointPixelType = IOPixelEnum::SCALAR;
+    this->m_PointPixelComponentType = IOComponentEnum::FLOAT;
+    this->m_NumberOfPointPixelComponents = 1;
+    this->m_NumberOfPointPixels = nvert;
+    this->m_UpdatePointData = true;
+  }
+  else if (isDouble)
+  {
+    this->m_PointPixelType = IOPixelEnum::SCALAR;
+    this->m_PointPixelComponentType = IOComponentEnum::DOUBLE;
+    this->m_NumberOfPointPixelComponents = 1;
+    this->m_NumberOfPointPixels = nvert;
+    this->m_UpdatePointData = true;
+  }
+  else if (isRGBA)
+  {
+    this->m_PointPixelType = IOPixelEnum::RGBA;
+    this->m_PointPixelComponentType = IOComponentEnum::UCHAR;
+    this->m_NumberOfPointPixelComponents = 4;
+    this->m_NumberOfPointPixels = nvert;
     this->m_UpdatePointData = true;
   }
 
   this->m_Internal->m_Attributes = attr;
   this->m_Internal->m_Skip = nskip;
+  SizeValueType bytesPerPointPixel = isDouble ? 8 : ((isScalar || isRGBA) ? 4 : 0);
+
+  // Scalars paired from a scalar-only file replace any point data of the file
+  if (!m_PointDataFileName.empty())
+  {
+    // zlib passes uncompressed files through
+    gzFile   pointDataFile = gzopen(m_PointDataFileName.c_str(), "rb");
+    uint8_t  pointDataHeader[16];
+    uint16_t pointDataAttributes = 0;
+    uint32_t numberOfValues = 0;
+    if (pointDataFile == nullptr)
+    {
+      itkExceptionMacro("File cannot be read: " << m_PointDataFileName);
+    }
+    const bool isHeaderRead =
+      gzread(pointDataFile, pointDataHeader, sizeof(pointDataHeader)) == static_cast<int>(sizeof(pointDataHeader));
+    gzclose(pointDataFile);
+    if (!isHeaderRead || pointDataHeader[0] != 0x4D || pointDataHeader[1] != 0x5A)
+    {
+      itkExceptionMacro("Not an MZ3 file: " << m_PointDataFileName);
+    }
+    std::memcpy(&pointDataAttributes, pointDataHeader + 2, sizeof(pointDataAttributes));
+    std::memcpy(&numberOfValues, pointDataHeader + 8, sizeof(numberOfValues));
+    if ((pointDataAttributes & 24) == 0)
+    {
+      itkExceptionMacro("The MZ3 file holds no scalars: " << m_PointDataFileName);
+    }
+    if (!isVert || numberOfValues != nvert)
+    {
+      itkExceptionMacro(<< m_PointDataFileName << " holds " << numberOfValues << " values per layer, but "
+                        << fileName << " has " << this->m_NumberOfPoints << " vertices");
+    }
+    const bool isPairedDouble = (pointDataAttributes & 16) != 0;
+    this->m_PointPixelType = IOPixelEnum::SCALAR;
+    this->m_PointPixelComponentType = isPairedDouble ? IOComponentEnum::DOUBLE : IOComponentEnum::FLOAT;
+    this->m_NumberOfPointPixelComponents = 1;
+    this->m_NumberOfPointPixels = nvert;
+    this->m_UpdatePointData = true;
+    bytesPerPointPixel = isPairedDouble ? 8 : 4;
+  }
+  m_NumberOfBytesToProcess = 16 + SizeValueType{ nskip } + ((attr & 1) ? SizeValueType{ nface } * 12 : 0) +
+                             (isVert ? SizeValueType{ nvert } * 12 : 0) + SizeValueType{ nvert } * bytesPerPointPixel;
+
+  m_Internal->m_HasSummary = false;
+  m_Internal->m_SpatialChunks.clear();
+  if (nskip >= 8 && nskip <= MaximumSkipRegionSize)
+  {
+    std::vector<uint8_t> skip(nskip);
+    this->ReadBytes(16, skip.data(), nskip);
+    m_Internal->m_HasSummary = DecodeSummary(skip.data(), nskip, m_Internal->m_Summary);
+    if ((attr & 1) && isVert)
+    {
+      DecodeSpatialChunks(skip.data(), nskip, nface, nvert, m_Internal->m_SpatialChunks);
+    }
+  }
+
+  if (m_UseGeometryCache)
+  {
+    this->ReadCachedGeometry(header);
+  }
+}
+
+void
+MZ3MeshIO::ReadCachedGeometry(const uint8_t * header)
+{
+  const SizeValueType    numberOfIndices = m_Internal->m_Attributes & 1 ? m_NumberOfCells * 3 : 0;
+  const SizeValueType    numberOfCoordinates = m_Internal->m_Attributes & 2 ? m_NumberOfPoints * 3 : 0;
+  const StreamOffsetType geometryOffset = 16 + StreamOffsetType{ m_Internal->m_Skip };
+  const SizeValueType    geometrySize = (numberOfIndices + numberOfCoordinates) * 4;
+
+  // Key the faces and vertices, which follow the skip region, by the magic number, the face and
+  // vertex flags and the counts of the header, so that the point data and skip region do not
+  // take part
+  MZ3GeometryCache::Key key{};
+  std::memcpy(key.m_Header, header, 12);
+  key.m_Header[2] &= 3;
+  key.m_Header[3] = 0;
+  key.m_Size = geometrySize;
+
+  // Hash each section block by block, chaining the hashes. Streamed sections are read once, into
+  // the geometry that is stored on a miss, and streamed gzip data is inflated up to the point
+  // data. Sections in memory are hashed in place and only copied on a miss.
+  constexpr SizeValueType blockSize = 1 << 20;
+  const uint8_t *         payload = m_Internal->m_PayloadData;
+  if (payload != nullptr && static_cast<SizeValueType>(geometryOffset) + geometrySize > m_Internal->m_PayloadSize)
+  {
+    itkExceptionMacro("Unexpected end of MZ3 data");
+  }
+  const auto geometry = std::make_shared<MZ3GeometryCache::Geometry>();
+  if (payload == nullptr)
+  {
+    geometry->m_Faces.resize(numberOfIndices);
+    geometry->m_Points.resize(numberOfCoordinates);
+  }
+  const auto readSection = [&](StreamOffsetType offset, void * section, SizeValueType size) {
+    const auto bytes = static_cast<uint8_t *>(section);
+    for (SizeValueType begin = 0; begin < size; begin += blockSize)
+    {
+      const SizeValueType blockBytes = std::min(blockSize, size - begin);
+      if (payload != nullptr)
+      {
+        key.m_Hash = MZ3GeometryCache::Hash(payload + offset + begin, blockBytes, key.m_Hash);
+        this->ReportBytes(blockBytes);
+      }
+      else
+      {
+        this->ReadBytes(offset + begin, bytes + begin, blockBytes);
+        key.m_Hash = MZ3GeometryCache::Hash(bytes + begin, blockBytes, key.m_Hash);
+      }
+    }
+  };
+  const SizeValueType    facesSize = numberOfIndices * sizeof(uint32_t);
+  const SizeValueType    pointsSize = numberOfCoordinates * sizeof(float);
+  const StreamOffsetType vertexOffset = this->GetVertexOffset();
+  readSection(geometryOffset, geometry->m_Faces.data(), facesSize);
+  readSection(vertexOffset, geometry->m_Points.data(), pointsSize);
+  const uint8_t * faces = payload != nullptr ? payload + geometryOffset
+                                             : reinterpret_cast<const uint8_t *>(geometry->m_Faces.data());
+  const uint8_t * points = payload != nullptr ? payload + vertexOffset
+                                              : reinterpret_cast<const uint8_t *>(geometry->m_Points.data());
+
+  // A hit is only taken if its sections match, so that a hash collision keeps this geometry
+  const auto isEqual = [](const void * cached, const uint8_t * bytes, SizeValueType size) {
+    return size == 0 || std::memcmp(cached, bytes, size) == 0;
+  };
+  MZ3GeometryCache *                           cache = MZ3GeometryCache::GetInstance();
+  const MZ3GeometryCache::GeometryConstPointer cached = cache->Find(key);
+  if (cached != nullptr && isEqual(cached->m_Faces.data(), faces, facesSize) &&
+      isEqual(cached->m_Points.data(), points, pointsSize))
+  {
+    m_Internal->m_Geometry = cached;
+    return;
+  }
+  if (payload != nullptr)
+  {
+    geometry->m_Faces.resize(numberOfIndices);
+    geometry->m_Points.resize(numberOfCoordinates);
+    this->CopyBytes(geometry->m_Faces.data(), faces, facesSize);
+    this->CopyBytes(geometry->m_Points.data(), points, pointsSize);
+  }
+  m_Internal->m_Geometry = geometry;
+  if (cached == nullptr)
+  {
+    cache->Insert(key, geometry);
+  }
+}
+
+MZ3GeometryCache::GeometryConstPointer
+MZ3MeshIO::GetGeometry() const
+{
+  return m_Internal->m_Geometry;
+}
+
+void
+MZ3MeshIO::ReadBytes(StreamOffsetType offset, void * buffer, SizeValueType numberOfBytes)
+{
+  if (m_Internal->m_PayloadData != nullptr)
+  {
+    if (offset < 0 || static_cast<SizeValueType>(offset) + numberOfBytes > m_Internal->m_PayloadSize)
+    {
+      itkExceptionMacro("Unexpected end of MZ3 data");
+    }
+    // Copied at once, so that the copy is split across the work units as the buffer is placed
+    this->CopyBytes(buffer, m_Internal->m_PayloadData + offset, numberOfBytes);
+    this->ReportBytes(numberOfBytes);
+    return;
+  }
+
+  // Read in chunks, reporting progress and checking for an abort after each
+  const bool isInParallel = !m_IsCompressed && m_Internal->m_FileDescriptor >= 0 && m_ParallelReadMinimumSize > 0 &&
+                            numberOfBytes >= m_ParallelReadMinimumSize;
+  const SizeValueType chunkSize =
+    isInParallel ? std::max<SizeValueType>(m_SectionChunkSize,
+                                           ParallelChunkSize * MultiThreaderBase::GetGlobalDefaultNumberOfThreads())
+                 : m_SectionChunkSize;
+  const auto bytes = static_cast<uint8_t *>(buffer);
+  if (m_IsCompressed)
+  {
+    gzseek(m_Internal->m_GzFile, static_cast<z_off_t>(offset), SEEK_SET);
+  }
+  else if (!isInParallel)
+  {
+    m_Ifstream.seekg(offset);
+  }
+  for (SizeValueType begin = 0; begin < numberOfBytes; begin += chunkSize)
+  {
+    const SizeValueType size = std::min(chunkSize, numberOfBytes - begin);
+    if (m_IsCompressed)
+    {
+      // gzread() takes an unsigned int, so chunks of SectionChunkSize are read 1 GiB at a time
+      for (SizeValueType bytesRead = 0; bytesRead < size;)
+      {
+        const auto request = static_cast<unsigned int>(std::min<SizeValueType>(size - bytesRead, 1u << 30));
+        const int  result = gzread(m_Internal->m_GzFile, bytes + begin + bytesRead, request);
+        if (result <= 0)
+        {
+          itkExceptionMacro("Unexpected end of MZ3 data");
+        }
+        bytesRead += static_cast<SizeValueType>(result);
+      }
+    }
+    else if (isInParallel)
+    {
+      this->ReadBytesInParallel(offset + begin, bytes + begin, size);
+    }
+    else
+    {
+      m_Ifstream.read(reinterpret_cast<char *>(bytes + begin), static_cast<std::streamsize>(size));
+      if (static_cast<SizeValueType>(m_Ifstream.gcount()) != size)
+      {
+        itkExceptionMacro("Unexpected end of MZ3 data");
+      }
+    }
+    this->ReportBytes(size);
+  }
+}
+
+void
+MZ3MeshIO::ReadBytesInParallel(StreamOffsetType offset, void * buffer, SizeValueType numberOfBytes)
+{
+#ifdef _WIN32
+  itkExceptionMacro("Concurrent reads are not available on Windows");
+#else
+  // Chunks start at multiples of chunkSize in the file, so direct reads of a chunk only need
+  // to be widened to whole blocks at the ends of the section
+  constexpr SizeValueType alignment = 4096;
+  constexpr SizeValueType chunkSize = ParallelChunkSize;
+  const auto              begin = static_cast<SizeValueType>(offset);
+  const SizeValueType     end = begin + numberOfBytes;
+  const SizeValueType     firstChunk = begin / chunkSize;
+  const SizeValueType     numberOfChunks = (end + chunkSize - 1) / chunkSize - firstChunk;
+  const int               fileDescriptor = m_Internal->m_FileDescriptor;
+  const int               directFileDescriptor = m_Internal->m_DirectFileDescriptor;
+  std::atomic<bool>       isRead{ true };
+
+  const auto multiThreader = MultiThreaderBase::New();
+  multiThreader->SetNumberOfWorkUnits(static_cast<unsigned int>(
+    std::min<SizeValueType>(MultiThreaderBase::GetGlobalDefaultNumberOfThreads(), numberOfChunks)));
+  multiThreader->ParallelizeArray(
+    0,
+    numberOfChunks,
+    [&](SizeValueType chunk) {
+      const SizeValueType chunkBegin = std::max(begin, (firstChunk + chunk) * chunkSize);
+      const SizeValueType chunkEnd = std::min(end, (firstChunk + chunk + 1) * chunkSize);
+      uint8_t *           destination = static_cast<uint8_t *>(buffer) + (chunkBegin - begin);
+      if (directFileDescriptor >= 0)
+      {
+        const SizeValueType blockBegin = chunkBegin / alignment * alignment;
+        const SizeValueType blockEnd = (chunkEnd + alignment - 1) / alignment * alignment;
+        void *              block = nullptr;
+        if (posix_memalign(&block, alignment, blockEnd - blockBegin) == 0)
+        {
+          const std::unique_ptr<void, decltype(&std::free)> blockOwner(block, &std::free);
+          // The last block may extend past the end of the file
+          if (PositionalRead(directFileDescriptor, block, blockEnd - blockBegin, blockBegin) >= chunkEnd - blockBegin)
+          {
+            std::memcpy(destination, static_cast<uint8_t *>(block) + (chunkBegin - blockBegin), chunkEnd - chunkBegin);
+            return;
+          }
+        }
+        // Fall back to a cached read
+      }
+      if (PositionalRead(fileDescriptor, destination, chunkEnd - chunkBegin, chunkBegin) != chunkEnd - chunkBegin)
+      {
+        isRead = false;
+      }
+    },
+    nullptr);
+  if (!isRead)
+  {
+    itkExceptionMacro("Unexpected end of MZ3 data");
+  }
+#endif
+}
+
+void
+MZ3MeshIO::ReadPoints(void * buffer)
+{
+  const bool          isInMemory = m_Internal->m_Geometry != nullptr || m_Internal->m_PayloadData != nullptr;
+  const SizeValueType numberOfBytes = m_NumberOfPoints * 3 * sizeof(float);
+  const auto          points = static_cast<float *>(buffer);
+  this->PlaceBuffer(buffer, numberOfBytes, isInMemory);
+  const StreamOffsetType offset = this->GetVertexOffset();
+  const float *          source = nullptr;
+  if (m_Internal->m_Geometry != nullptr)
+  {
+    source = m_Internal->m_Geometry->m_Points.data();
+  }
+  else if (m_Internal->m_PayloadData != nullptr && offset >= 0 &&
+           static_cast<SizeValueType>(offset) + numberOfBytes <= m_Internal->m_PayloadSize &&
+           reinterpret_cast<uintptr_t>(m_Internal->m_PayloadData + offset) % alignof(float) == 0)
+  {
+    source = reinterpret_cast<const float *>(m_Internal->m_PayloadData + offset);
+  }
+
+  const double * matrix = m_Internal->m_PointTransformMatrix;
+  if (m_Internal->m_IsTransformingPoints && source != nullptr)
+  {
+    // Transform as the vertices are copied from memory
+    TransformPoints<float>(matrix, m_Internal->m_IsFlippingAxes, source, points, m_NumberOfPoints);
+  }
+  else if (m_Internal->m_Geometry != nullptr)
+  {
+    this->CopyBytes(buffer, source, numberOfBytes);
+  }
+  else
+  {
+    // Read vertex coordinates
+    this->ReadBytes(offset, buffer, numberOfBytes);
+    if (m_Internal->m_IsTransformingPoints)
+    {
+      TransformPoints<float>(matrix, m_Internal->m_IsFlippingAxes, points, points, m_NumberOfPoints);
+    }
+  }
+
+  if (m_BuildSpatialIndex || m_ComputeNormalsAndAreas)
+  {
+    m_Internal->m_Points.assign(points, points + m_NumberOfPoints * 3);
+  }
+}
+
+void
+MZ3MeshIO::ReadCells(void * buffer)
+{
+  const auto cellSize = m_Internal->m_Attributes & 1 ? 12 : 0;
+  // Faces without a vertex section refer to points of another file, so they are not indexed
+  const bool isSpatiallyIndexed = m_BuildSpatialIndex && (m_Internal->m_Attributes & 2) != 0;
+  if (cellSize)
+  {
+    const auto bufferAsUint = static_cast<uint32_t *>(buffer);
+    // Faces expanded concurrently touch the cell buffer in the ranges that it is placed in
+    this->PlaceBuffer(buffer, m_NumberOfCells * 5 * sizeof(uint32_t), !m_LowMemoryReading && !m_ComputeNormalsAndAreas);
+    std::unique_ptr<uint32_t[]> faceBuffer;
+    const uint32_t *            faces;
+    bool                        isInPlace = false;
+    if (m_Internal->m_Geometry != nullptr)
+    {
+      faces = m_Internal->m_Geometry->m_Faces.data();
+    }
+    else if (m_LowMemoryReading)
+    {
+      // Skip header and optional skip bytes, and read face indices into the last 12 of the 20
+      // bytes per face of the cell buffer
+      isInPlace = true;
+      this->ReadBytes(16 + m_Internal->m_Skip, bufferAsUint + m_NumberOfCells * 2, m_NumberOfCells * cellSize);
+      faces = bufferAsUint + m_NumberOfCells * 2;
+    }
+    else
+    {
+      faceBuffer = make_unique_for_overwrite<uint32_t[]>(m_NumberOfCells * 3);
+      // Skip header and optional skip bytes, and read face indices
+      this->ReadBytes(16 + m_Internal->m_Skip, faceBuffer.get(), m_NumberOfCells * cellSize);
+      faces = faceBuffer.get();
+    }
+
+    if (isSpatiallyIndexed)
+    {
+      m_Internal->m_Faces.assign(faces, faces + m_NumberOfCells * 3);
+    }
+
+    // The second and third vertices of every face, swapped to reverse the winding
+    const unsigned int second = m_Internal->m_IsReversingWinding ? 2 : 1;
+    const unsigned int third = 3 - second;
+
+    if (isInPlace)
+    {
+      // Expand from the front. The cell of face i ends at 5 i + 5, which does not pass the start
+      // of face i + 1 at 2 n + 3 (i + 1), so every face is read before it is overwritten.
+      for (SizeValueType i = 0; i < m_NumberOfCells; ++i)
+      {
+        const uint32_t vertices[3] = { faces[i * 3], faces[i * 3 + second], faces[i * 3 + third] };
+        uint32_t *     cell = bufferAsUint + i * 5;
+        cell[0] = static_cast<uint32_t>(CellGeometryEnum::TRIANGLE_CELL);
+        cell[1] = 3;
+        cell[2] = vertices[0];
+        cell[3] = vertices[1];
+        cell[4] = vertices[2];
+      }
+      if (m_ComputeNormalsAndAreas)
+      {
+        this->ExpandCellsAndComputeNormals(nullptr, bufferAsUint);
+      }
+    }
+    else if (m_ComputeNormalsAndAreas)
+    {
+      this->ExpandCellsAndComputeNormals(faces, bufferAsUint);
+    }
+    else if (m_MemoryPlacement != MemoryPlacementEnum::Default)
+    {
+      // Every work unit expands the faces whose cells start in its range of the cell buffer
+      constexpr SizeValueType cellBytes = 5 * sizeof(uint32_t);
+      FillInParallel(bufferAsUint, m_NumberOfCells * cellBytes, [&](SizeValueType begin, SizeValueType end) {
+        for (SizeValueType i = (begin + cellBytes - 1) / cellBytes; i < (end + cellBytes - 1) / cellBytes; ++i)
+        {
+          uint32_t * cell = bufferAsUint + i * 5;
+          cell[0] = static_cast<uint32_t>(CellGeometryEnum::TRIANGLE_CELL);
+          cell[1] = 3;
+          cell[2] = faces[i * 3];
+          cell[3] = faces[i * 3 + second];
+          cell[4] = faces[i * 3 + third];
+        }
+      });
+    }
+    else
+    {
+      SizeValueType index = 0;
+      for (SizeValueType i = 0; i < m_NumberOfCells; ++i)
+      {
+        bufferAsUint[index++] = static_cast<unsigned int>(CellGeometryEnum::TRIANGLE_CELL);
+        bufferAsUint[index++] = 3;
+        bufferAsUint[index++] = faces[i * 3];
+        bufferAsUint[index++] = faces[i * 3 + second];
+        bufferAsUint[index++] = faces[i * 3 + third];
+      }
+    }
+
+    if (m_ComputeAdjacency)
+    {
+      // Faces read in place were overwritten by their cells
+      if (isInPlace)
+      {
+        this->UpdateAdjacency(bufferAsUint + 2, 5);
+      }
+      else
+      {
+        this->UpdateAdjacency(faces, 3);
+      }
+    }
+  }
+
+  if (isSpatiallyIndexed)
+  {
+    this->UpdateSpatialIndex();
+  }
+  else
+  {
+    // The vertices were only kept for the normals
+    m_Internal->m_Points = std::vector<float>();
+  }
+}
+
+void
+MZ3MeshIO::ExpandCellsAndComputeNormals(const uint32_t * faces, uint32_t * cells)
+{
+  const SizeValueType numberOfPoints = m_NumberOfPoints;
+  const SizeValueType numberOfFaces = m_NumberOfCells;
+  if (m_Internal->m_Points.size() != numberOfPoints * 3)
+  {
+    // ReadPoints() was not called; take the vertices from the geometry or read them here
+    if (m_Internal->m_Geometry != nullptr)
+    {
+      m_Internal->m_Points = m_Internal->m_Geometry->m_Points;
+    }
+    else
+    {
+      m_Internal->m_Points.resize(numberOfPoints * 3);
+      this->ReadBytes(this->GetVertexOffset(), m_Internal->m_Points.data(), numberOfPoints * 3 * sizeof(float));
+    }
+    if (m_Internal->m_IsTransformingPoints)
+    {
+      float * points = m_Internal->m_Points.data();
+      TransformPoints<float>(
+        m_Internal->m_PointTransformMatrix, m_Internal->m_IsFlippingAxes, points, points, numberOfPoints);
+    }
+  }
+  const float * points = m_Internal->m_Points.data();
+  m_Internal->m_FaceAreas.resize(numberOfFaces);
+  float * faceAreas = m_Internal->m_FaceAreas.data();
+
+  // Work units take contiguous blocks of faces and scatter their normals into private
+  // accumulators, so no two work units write to the same vertex.
+  constexpr SizeValueType minimumFacesPerWorkUnit = 65536;
+  const SizeValueType     maximumNumberOfWorkUnits =
+    m_LowMemoryReading ? 1 : MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+  const auto              numberOfWorkUnits = static_cast<unsigned int>(std::max<SizeValueType>(
+    1, std::min<SizeValueType>(maximumNumberOfWorkUnits, numberOfFaces / minimumFacesPerWorkUnit)));
+  std::vector<float> accumulators(numberOfWorkUnits * numberOfPoints * 3, 0.0f);
+  std::atomic<bool>  isValid{ true };
+  // Cells expanded here have the second and third vertices of their faces swapped to reverse
+  // the winding
+  const unsigned int second = m_Internal->m_IsReversingWinding ? 2 : 1;
+  const unsigned int third = 3 - second;
+
+  const auto multiThreader = MultiThreaderBase::New();
+  multiThreader->SetNumberOfWorkUnits(numberOfWorkUnits);
+  multiThreader->ParallelizeArray(
+    0,
+    numberOfWorkUnits,
+    [&](SizeValueType workUnit) {
+      const SizeValueType begin = numberOfFaces * workUnit / numberOfWorkUnits;
+      const SizeValueType end = numberOfFaces * (workUnit + 1) / numberOfWorkUnits;
+      float *             normals = accumulators.data() + workUnit * numberOfPoints * 3;
+      for (SizeValueType face = begin; face < end; ++face)
+      {
+        uint32_t * cell = cells + face * 5;
+        if (faces != nullptr)
+        {
+          cell[2] = faces[face * 3];
+          cell[3] = faces[face * 3 + second];
+          cell[4] = faces[face * 3 + third];
+        }
+        cell[0] = static_cast<uint32_t>(CellGeometryEnum::TRIANGLE_CELL);
+        cell[1] = 3;
+        const uint32_t * vertices = cell + 2;
+        if (vertices[0] >= numberOfPoints || vertices[1] >= numberOfPoints || vertices[2] >= numberOfPoints)
+        {
+          isValid = false;
+          faceAreas[face] = 0.0f;
+          continue;
+        }
+
+        // The cross product of two edges is normal to the triangle, with twice its area as length
+        const float * a = points + vertices[0] * 3;
+        const float * b = points + vertices[1] * 3;
+        const float * c = points + vertices[2] * 3;
+        const float   ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        const float   ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        const float   normal[3] = { ab[1] * ac[2] - ab[2] * ac[1],
+                                    ab[2] * ac[0] - ab[0] * ac[2],
+                                    ab[0] * ac[1] - ab[1] * ac[0] };
+        faceAreas[face] = 0.5f * std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        for (unsigned int vertex = 0; vertex < 3; ++vertex)
+        {
+          float * accumulator = normals + vertices[vertex] * 3;
+          accumulator[0] += normal[0];
+          accumulator[1] += normal[1];
+          accumulator[2] += normal[2];
+        }
+      }
+    },
+    nullptr);
+  if (!isValid)
+  {
+    itkExceptionMacro("A face refers to a point index that is out of range");
+  }
+
+  // Sum the accumulators and normalize, in place in the first accumulator
+  constexpr SizeValueType pointsPerBlock = 16384;
+  const SizeValueType     numberOfBlocks = (numberOfPoints + pointsPerBlock - 1) / pointsPerBlock;
+  multiThreader->SetNumberOfWorkUnits(MultiThreaderBase::GetGlobalDefaultNumberOfThreads());
+  multiThreader->ParallelizeArray(
+    0,
+    numberOfBlocks,
+    [&](SizeValueType block) {
+      const SizeValueType begin = block * pointsPerBlock * 3;
+      const SizeValueType end = std::min(numberOfPoints, (block + 1) * pointsPerBlock) * 3;
+      for (unsigned int workUnit = 1; workUnit < numberOfWorkUnits; ++workUnit)
+      {
+        const float * normals = accumulators.data() + workUnit * numberOfPoints * 3;
+        for (SizeValueType ii = begin; ii < end; ++ii)
+        {
+          accumulators[ii] += normals[ii];
+        }
+      }
+      for (SizeValueType ii = begin; ii < end; ii += 3)
+      {
+        float * normal = accumulators.data() + ii;
+        const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (length > 0.0f)
+        {
+          normal[0] /= length;
+          normal[1] /= length;
+          normal[2] /= length;
+        }
+      }
+    },
+    nullptr);
+  accumulators.resize(numberOfPoints * 3);
+  m_Internal->m_VertexNormals = std::move(accumulators);
+}
+
+void
+MZ3MeshIO::UpdateAdjacency(const uint32_t * ids, SizeValueType stride)
+{
+  const SizeValueType     numberOfPoints = m_NumberOfPoints;
+  const SizeValueType     numberOfFaces = m_NumberOfCells;
+  constexpr SizeValueType facesPerBlock = 65536;
+  constexpr SizeValueType pointsPerBlock = 16384;
+  const SizeValueType     numberOfFaceBlocks = (numberOfFaces + facesPerBlock - 1) / facesPerBlock;
+  const SizeValueType     numberOfPointBlocks = (numberOfPoints + pointsPerBlock - 1) / pointsPerBlock;
+  const auto              multiThreader = MultiThreaderBase::New();
+  const auto              forEachFace = [&](const auto & visit) {
+    multiThreader->ParallelizeArray(
+      0,
+      numberOfFaceBlocks,
+      [&](SizeValueType block) {
+        const SizeValueType end = std::min(numberOfFaces, (block + 1) * facesPerBlock);
+        for (SizeValueType face = block * facesPerBlock; face < end; ++face)
+        {
+          visit(face, ids + face * stride);
+        }
+      },
+      nullptr);
+  };
+
+  // Count the faces of every vertex
+  const std::unique_ptr<std::atomic<uint32_t>[]> counts(new std::atomic<uint32_t>[numberOfPoints]());
+  std::atomic<bool>                              isValid{ true };
+  forEachFace([&](SizeValueType, const uint32_t * face) {
+    for (unsigned int kk = 0; kk < 3; ++kk)
+    {
+      if (face[kk] >= numberOfPoints)
+      {
+        isValid = false;
+        continue;
+      }
+      counts[face[kk]].fetch_add(1, std::memory_order_relaxed);
+    }
+  });
+  if (!isValid)
+  {
+    itkExceptionMacro("A face refers to a point index that is out of range");
+  }
+
+  // Scatter the faces into the rows of their vertices, counting the rows up again
+  std::vector<SizeValueType> & faceOffsets = m_Internal->m_VertexFaceOffsets;
+  std::vector<uint32_t> &      vertexFaces = m_Internal->m_VertexFaces;
+  PrefixSumInParallel(counts.get(), numberOfPoints, faceOffsets);
+  vertexFaces.resize(faceOffsets[numberOfPoints]);
+  for (SizeValueType point = 0; point < numberOfPoints; ++point)
+  {
+    counts[point].store(0, std::memory_order_relaxed);
+  }
+  forEachFace([&](SizeValueType face, const uint32_t * vertices) {
+    for (unsigned int kk = 0; kk < 3; ++kk)
+    {
+      const uint32_t point = vertices[kk];
+      vertexFaces[faceOffsets[point] + counts[point].fetch_add(1, std::memory_order_relaxed)] =
+        static_cast<uint32_t>(face);
+    }
+  });
+
+  // The neighbors of a vertex are the other vertices of its faces
+  const auto findNeighbors = [&](SizeValueType point, std::vector<uint32_t> & neighbors) {
+    neighbors.clear();
+    for (SizeValueType ii = faceOffsets[point]; ii < faceOffsets[point + 1]; ++ii)
+    {
+      const uint32_t * vertices = ids + vertexFaces[ii] * stride;
+      for (unsigned int kk = 0; kk < 3; ++kk)
+      {
+        if (vertices[kk] != point)
+        {
+          neighbors.push_back(vertices[kk]);
+        }
+      }
+    }
+    std::sort(neighbors.begin(), neighbors.end());
+    neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+  };
+
+  // Sort the faces of every vertex, which were scattered in any order, and count its neighbors
+  multiThreader->ParallelizeArray(
+    0,
+    numberOfPointBlocks,
+    [&](SizeValueType block) {
+      std::vector<uint32_t> neighbors;
+      const SizeValueType   end = std::min(numberOfPoints, (block + 1) * pointsPerBlock);
+      for (SizeValueType point = block * pointsPerBlock; point < end; ++point)
+      {
+        std::sort(vertexFaces.begin() + faceOffsets[point], vertexFaces.begin() + faceOffsets[point + 1]);
+        findNeighbors(point, neighbors);
+        counts[point].store(static_cast<uint32_t>(neighbors.size()), std::memory_order_relaxed);
+      }
+    },
+    nullptr);
+
+  std::vector<SizeValueType> & neighborOffsets = m_Internal->m_VertexNeighborOffsets;
+  std::vector<uint32_t> &      vertexNeighbors = m_Internal->m_VertexNeighbors;
+  PrefixSumInParallel(counts.get(), numberOfPoints, neighborOffsets);
+  vertexNeighbors.resize(neighborOffsets[numberOfPoints]);
+  multiThreader->ParallelizeArray(
+    0,
+    numberOfPointBlocks,
+    [&](SizeValueType block) {
+      std::vector<uint32_t> neighbors;
+      const SizeValueType   end = std::min(numberOfPoints, (block + 1) * pointsPerBlock);
+      for (SizeValueType point = block * pointsPerBlock; point < end; ++point)
+      {
+        findNeighbors(point, neighbors);
+        std::copy(neighbors.begin(), neighbors.end(), vertexNeighbors.begin() + neighborOffsets[point]);
+      }
+    },
+    nullptr);
+}
+
+const std::vector<SizeValueType> &
+MZ3MeshIO::GetVertexFaceOffsets() const
+{
+  return m_Internal->m_VertexFaceOffsets;
+}
+
+const std::vector<uint32_t> &
+MZ3MeshIO::GetVertexFaces() const
+{
+  return m_Internal->m_VertexFaces;
+}
+
+const std::vector<SizeValueType> &
+MZ3MeshIO::GetVertexNeighborOffsets() const
+{
+  return m_Internal->m_VertexNeighborOffsets;
+}
+
+const std::vector<uint32_t> &
+MZ3MeshIO::GetVertexNeighbors() const
+{
+  return m_Internal->m_VertexNeighbors;
+}
+
+const std::vector<float> &
+MZ3MeshIO::GetVertexNormals() const
+{
+  return m_Internal->m_VertexNormals;
+}
+
+const std::vector<float> &
+MZ3MeshIO::GetFaceAreas() const
+{
+  return m_Internal->m_FaceAreas;
+}
+
+void
+MZ3MeshIO::UpdateSpatialIndex()
+{
+  // The index takes the kept vertices and faces over, so they are not held twice
+  m_SpatialIndex = MZ3SpatialIndex::New();
+  if (m_SpatialIndexFileName.empty() ||
+      !m_SpatialIndex->Read(m_SpatialIndexFileName, m_Internal->m_Points, m_Internal->m_Faces))
+  {
+    m_SpatialIndex->Build(std::move(m_Internal->m_Points), std::move(m_Internal->m_Faces));
+    if (!m_SpatialIndexFileName.empty())
+    {
+      m_SpatialIndex->Write(m_SpatialIndexFileName);
+    }
+  }
+  m_Internal->m_Points = std::vector<float>();
+  m_Internal->m_Faces = std::vector<uint32_t>();
+}
+
+MZ3SpatialIndex *
+MZ3MeshIO::GetSpatialIndex()
+{
+  // Meshes without faces are not passed to ReadCells()
+  if (m_BuildSpatialIndex && m_SpatialIndex == nullptr && !m_Internal->m_Points.empty())
+  {
+    this->UpdateSpatialIndex();
+  }
+  return m_SpatialIndex;
+}
+
+void
+MZ3MeshIO::ReadPointData(void * buffer)
+{
+  if (!m_PointDataFileName.empty())
+  {
+    // The first layer of the paired file, with the type that ReadMeshInformation() found
+    MZ3OverlayMatrixOptions options;
+    options.NumberOfWorkUnits = 1;
+    const bool          isDouble = this->m_PointPixelComponentType == IOComponentEnum::DOUBLE;
+    const SizeValueType numberOfBytes = m_NumberOfPointPixels * (isDouble ? sizeof(double) : sizeof(float));
+    this->PlaceBuffer(buffer, numberOfBytes, false);
+    if (isDouble)
+    {
+      ReadMZ3OverlayMatrix({ m_PointDataFileName }, m_NumberOfPointPixels, static_cast<double *>(buffer), options);
+    }
+    else
+    {
+      ReadMZ3OverlayMatrix({ m_PointDataFileName }, m_NumberOfPointPixels, static_cast<float *>(buffer), options);
+    }
+    this->ReportBytes(numberOfBytes);
+    return;
+  }
+  const auto isScalar = (m_Internal->m_Attributes & 8) != 0;
+  const auto isDouble = (m_Internal->m_Attributes & 16) != 0;
+  const auto isRGBA = (m_Internal->m_Attributes & 4) != 0;
+
+  if (!isScalar && !isDouble && !isRGBA)
+  {
+    return;
+  }
+  // Colors and float scalars take 4 bytes per point, double scalars 8
+  const SizeValueType numberOfBytes = m_NumberOfPointPixels * (!isScalar && isDouble ? 8 : 4);
+  this->PlaceBuffer(buffer, numberOfBytes, m_Internal->m_PayloadData != nullptr);
+
+  // Skip header and optional skip bytes
+  StreamOffsetType offset = 16 + m_Internal->m_Skip;
+  // Skip faces if present
+  if (m_Internal->m_Attributes & 1)
+  {
+    offset += m_NumberOfCells * 12;
+  }
+  // Skip vertices if present
+  if (m_Internal->m_Attributes & 2)
+  {
+    offset += m_NumberOfPoints * 12;
+  }
+  // Read point data. Scalars follow the colors when both are present, and take precedence
+  if ((isScalar || isDouble) && isRGBA)
+  {
+    offset += m_NumberOfPointPixels * 4;
+  }
+  this->ReadBytes(offset, buffer, numberOfBytes);
+}
+
+void
+MZ3MeshIO::PlaceBuffer(void * buffer, SizeValueType numberOfBytes, bool isFilledInParallel)
+{
+  if (buffer == nullptr || numberOfBytes < PlacementMinimumSize)
+  {
+    return;
+  }
+  // madvise() and mbind() take whole pages
+  const auto      address = reinterpret_cast<uintptr_t>(buffer);
+  const uintptr_t pagesBegin = (address + PageSize - 1) / PageSize * PageSize;
+  const uintptr_t pagesEnd = (address + numberOfBytes) / PageSize * PageSize;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  if (m_UseHugePages && numberOfBytes >= HugePageSize && pagesBegin < pagesEnd)
+  {
+    // Only advice; the kernel backs the 2 MiB aligned parts of the range with huge pages
+    madvise(reinterpret_cast<void *>(pagesBegin), pagesEnd - pagesBegin, MADV_HUGEPAGE);
+  }
+#endif
+  if (m_MemoryPlacement == MemoryPlacementEnum::Default)
+  {
+    return;
+  }
+#ifdef ITK_MZ3_USE_NUMA
+  if (m_MemoryPlacement == MemoryPlacementEnum::Interleaved && numa_available() >= 0 && pagesBegin < pagesEnd)
+  {
+    // Pages that are not touched yet are allocated round robin across the nodes
+    numa_interleave_memory(reinterpret_cast<void *>(pagesBegin), pagesEnd - pagesBegin, numa_all_nodes_ptr);
+    return;
+  }
+#else
+  (void)pagesBegin;
+  (void)pagesEnd;
+#endif
+  if (!isFilledInParallel)
+  {
+    const auto bytes = static_cast<uint8_t *>(buffer);
+    FillInParallel(buffer, numberOfBytes, [bytes](SizeValueType begin, SizeValueType end) {
+      std::memset(bytes + begin, 0, end - begin);
+    });
+  }
+}
+
+void
+MZ3MeshIO::CopyBytes(void * destination, const void * source, SizeValueType numberOfBytes)
+{
+  if (m_MemoryPlacement == MemoryPlacementEnum::Default || numberOfBytes < PlacementMinimumSize)
+  {
+    std::memcpy(destination, source, numberOfBytes);
+    return;
+  }
+  const auto to = static_cast<uint8_t *>(destination);
+  const auto from = static_cast<const uint8_t *>(source);
+  FillInParallel(destination, numberOfBytes, [to, from](SizeValueType begin, SizeValueType end) {
+    std::memcpy(to + begin, from + begin, end - begin);
+  });
+}
+
+void
+MZ3MeshIO::SetPointTransform(const PointTransformType & transform)
+{
+  if (transform[3][0] != 0.0 || transform[3][1] != 0.0 || transform[3][2] != 0.0 || transform[3][3] != 1.0)
+  {
+    itkExceptionMacro("The point transform is not affine: its last row must be 0 0 0 1");
+  }
+  double * matrix = m_Internal->m_PointTransformMatrix;
+  bool     isIdentity = true;
+  bool     isFlippingAxes = true;
+  for (unsigned int row = 0; row < 3; ++row)
+  {
+    for (unsigned int column = 0; column < 4; ++column)
+    {
+      const double value = transform[row][column];
+      matrix[row * 4 + column] = value;
+      isIdentity = isIdentity && value == (row == column ? 1.0 : 0.0);
+      isFlippingAxes = isFlippingAxes && (row == column ? std::abs(value) == 1.0 : value == 0.0);
+    }
+  }
+  const double determinant = matrix[0] * (matrix[5] * matrix[10] - matrix[6] * matrix[9]) -
+                             matrix[1] * (matrix[4] * matrix[10] - matrix[6] * matrix[8]) +
+                             matrix[2] * (matrix[4] * matrix[9] - matrix[5] * matrix[8]);
+  m_Internal->m_IsTransformingPoints = !isIdentity;
+  m_Internal->m_IsFlippingAxes = isFlippingAxes;
+  m_Internal->m_IsReversingWinding = determinant < 0.0;
+  m_PointTransform = transform;
+  this->Modified();
+}
+
+std::string
+MZ3MeshIO::GetLevelOfDetailFileName(const std::string & fileName, unsigned int level)
+{
+  if (level == 0)
+  {
+    return fileName;
+  }
+  const std::string suffix = "_lod" + std::to_string(level);
+  std::string       archiveFileName;
+  std::string       entryName;
+  if (MZ3Archive::SplitEntryPath(fileName, archiveFileName, entryName))
+  {
+    return fileName + suffix;
+  }
+  const std::string extension = itksys::SystemTools::GetFilenameLastExtension(fileName);
+  return fileName.substr(0, fileName.size() - extension.size()) + suffix + extension;
+}
+
+const std::vector<MZ3MeshIO::SpatialChunk> &
+MZ3MeshIO::GetSpatialChunks() const
+{
+  return m_Internal->m_SpatialChunks;
+}
+
+void
+MZ3MeshIO::ReadRegionInBox(const float bounds[6], RegionMesh & region)
+{
+  std::vector<SpatialChunk> chunks;
+  for (const SpatialChunk & chunk : m_Internal->m_SpatialChunks)
+  {
+    bool isOverlapping = true;
+    for (unsigned int ii = 0; ii < 3; ++ii)
+    {
+      isOverlapping = isOverlapping && chunk.m_Bounds[2 * ii] <= bounds[2 * ii + 1] &&
+                      bounds[2 * ii] <= chunk.m_Bounds[2 * ii + 1];
+    }
+    if (isOverlapping)
+    {
+      chunks.push_back(chunk);
+    }
+  }
+  this->ReadSpatialChunks(chunks, region);
 }
 
 void
-MZ3MeshIO::ReadPoints(void * buffer)
+MZ3MeshIO::ReadRegionInSphere(const float center[3], float radius, RegionMesh & region)
 {
-  if (m_IsCompressed)
+  std::vector<SpatialChunk> chunks;
+  for (const SpatialChunk & chunk : m_Internal->m_SpatialChunks)
   {
-    // Skip header and optional skip bytes
-    gzseek(m_Internal->m_GzFile, 16 + m_Internal->m_Skip, SEEK_SET);
-    // Skip faces if present
-    if (m_Internal->m_Attributes & 1)
+    // Squared distance from the center to the nearest point of the bounds
+    float squaredDistance = 0.0f;
+    for (unsigned int ii = 0; ii < 3; ++ii)
     {
-      gzseek(m_Internal->m_GzFile, m_NumberOfCells * 12, SEEK_CUR);
+      const float difference =
+        std::max({ chunk.m_Bounds[2 * ii] - center[ii], 0.0f, center[ii] - chunk.m_Bounds[2 * ii + 1] });
+      squaredDistance += difference * difference;
     }
-    // Read vertex coordinates
-    gzread(m_Internal->m_GzFile, buffer, m_NumberOfPoints * 3 * sizeof(float));
-  }
-  else
-  {
-    // Skip header and optional skip bytes
-    m_Ifstream.seekg(16 + m_Internal->m_Skip);
-    // Skip faces if present
-    if (m_Internal->m_Attributes & 1)
+    if (squaredDistance <= radius * radius)
     {
-      m_Ifstream.seekg(m_NumberOfCells * 12, std::ios::cur);
+      chunks.push_back(chunk);
     }
-    // Read vertex coordinates
-    m_Ifstream.read(static_cast<char *>(buffer), m_NumberOfPoints * 3 * sizeof(float));
   }
+  this->ReadSpatialChunks(chunks, region);
 }
 
 void
-MZ3MeshIO::ReadCells(void * buffer)
+MZ3MeshIO::ReadSpatialChunks(std::vector<SpatialChunk> chunks, RegionMesh & region)
 {
-  const auto cellSize = m_Internal->m_Attributes & 1 ? 12 : 0;
-  if (!cellSize)
+  region = RegionMesh{};
+  if ((m_Internal->m_Attributes & 3) != 3)
   {
-    return;
+    itkExceptionMacro("Only files with faces and vertices can be read by region");
   }
-  const auto faceBuffer = make_unique_for_overwrite<uint32_t[]>(m_NumberOfCells * 3);
-  if (m_IsCompressed)
+  if (m_Internal->m_SpatialChunks.empty())
   {
-    // Skip header and optional skip bytes
-    gzseek(m_Internal->m_GzFile, 16 + m_Internal->m_Skip, SEEK_SET);
-    // Read face indices
-    gzread(m_Internal->m_GzFile, faceBuffer.get(), m_NumberOfCells * cellSize);
+    // The whole file is a single chunk that overlaps every region
+    SpatialChunk chunk;
+    chunk.m_NumberOfFaces = static_cast<uint32_t>(m_Internal->m_NumberOfFaces);
+    chunk.m_NumberOfPoints = static_cast<uint32_t>(m_NumberOfPoints);
+    chunks.assign(1, chunk);
   }
-  else
+
+  // Read the faces of the chunks in file order
+  std::sort(chunks.begin(), chunks.end(), [](const SpatialChunk & a, const SpatialChunk & b) {
+    return a.m_FirstFace < b.m_FirstFace;
+  });
+  std::vector<uint32_t> & faces = region.m_Faces;
+  for (const SpatialChunk & chunk : chunks)
+  {
+    const SizeValueType begin = faces.size();
+    faces.resize(begin + SizeValueType{ chunk.m_NumberOfFaces } * 3);
+    this->ReadBytes(16 + m_Internal->m_Skip + SizeValueType{ chunk.m_FirstFace } * 12,
+                    faces.data() + begin,
+                    SizeValueType{ chunk.m_NumberOfFaces } * 12);
+  }
+
+  // The points that the faces refer to, in file order
+  std::vector<uint32_t> & pointIds = region.m_PointIds;
+  pointIds = faces;
+  std::sort(pointIds.begin(), pointIds.end());
+  pointIds.erase(std::unique(pointIds.begin(), pointIds.end()), pointIds.end());
+  if (!pointIds.empty() && pointIds.back() >= m_NumberOfPoints)
   {
-    // Skip header and optional skip bytes
-    m_Ifstream.seekg(16 + m_Internal->m_Skip);
-    // Read face indices
-    m_Ifstream.read(reinterpret_cast<char *>(faceBuffer.get()), m_NumberOfCells * cellSize);
+    itkExceptionMacro("A face refers to a point index that is out of range");
   }
 
-  SizeValueType index = 0;
-  const auto    bufferAsUint = static_cast<uint32_t *>(buffer);
-  for (SizeValueType i = 0; i < m_NumberOfCells; ++i)
+  // Points are numbered in the order the chunks first refer to them, so the points of a region
+  // mostly come in runs. Read every run of points that are at most maximumGap apart at once.
+  constexpr SizeValueType maximumGap = 256;
+  const StreamOffsetType  vertexOffset = this->GetVertexOffset();
+  std::vector<float>      run;
+  region.m_Points.resize(pointIds.size() * 3);
+  for (SizeValueType first = 0; first < pointIds.size();)
   {
-    bufferAsUint[index++] = static_cast<unsigned int>(CellGeometryEnum::TRIANGLE_CELL);
-    bufferAsUint[index++] = 3;
-    for (unsigned int j = 0; j < 3; ++j)
+    SizeValueType last = first;
+    while (last + 1 < pointIds.size() && pointIds[last + 1] - pointIds[last] <= maximumGap)
+    {
+      ++last;
+    }
+    run.resize((SizeValueType{ pointIds[last] } - pointIds[first] + 1) * 3);
+    this->ReadBytes(vertexOffset + SizeValueType{ pointIds[first] } * 12, run.data(), run.size() * sizeof(float));
+    for (SizeValueType ii = first; ii <= last; ++ii)
     {
-      bufferAsUint[index++] = faceBuffer[i * 3 + j];
+      std::copy_n(run.data() + (pointIds[ii] - pointIds[first]) * 3, 3, region.m_Points.data() + ii * 3);
     }
+    first = last + 1;
+  }
+
+  // Renumber the faces from zero
+  for (uint32_t & pointId : faces)
+  {
+    pointId = static_cast<uint32_t>(std::lower_bound(pointIds.begin(), pointIds.end(), pointId) - pointIds.begin());
   }
 }
 
 void
-MZ3MeshIO::ReadPointData(void * buffer)
+MZ3MeshIO::ReadCellData(void * itkNotUsed(buffer))
 {
-  const auto isScalar = (m_Internal->m_Attributes & 8) != 0;
-  const auto isDouble = (m_Internal->m_Attributes & 16) != 0;
-  const auto isRGBA = (m_Internal->m_Attributes & 4) != 0;
+  // No cell data
+}
 
-  if (!isScalar && !isDouble && !isRGBA)
+void
+MZ3MeshIO::SetOutputBuffer(std::vector<uint8_t> * buffer)
+{
+  if (m_OutputBuffer != buffer)
+  {
+    m_OutputBuffer = buffer;
+    this->Modified();
+  }
+}
+
+void
+MZ3MeshIO::AppendScalarLayers(const std::string & fileName, const float * layers, SizeValueType numberOfLayers)
+{
+  if (numberOfLayers == 0)
   {
     return;
   }
 
-  if (m_IsCompressed)
+  // Read the header, which is inside the first member of compressed files
+  uint8_t header[16]{};
+  bool    isCompressed = false;
   {
-    // Skip header and optional skip bytes
-    gzseek(m_Internal->m_GzFile, 16 + m_Internal->m_Skip, SEEK_SET);
-    // Skip faces if present
-    if (m_Internal->m_Attributes & 1)
-    {
-      gzseek(m_Internal->m_GzFile, m_NumberOfCells * 12, SEEK_CUR);
-    }
-    // Skip vertices if present
-    if (m_Internal->m_Attributes & 2)
+    std::ifstream file(fileName, std::ios::binary);
+    file.read(reinterpret_cast<char *>(header), sizeof(header));
+    if (file.gcount() < 2)
     {
-      gzseek(m_Internal->m_GzFile, m_NumberOfPoints * 12, SEEK_CUR);
+      itkGenericExceptionMacro("File cannot be read: " << fileName);
     }
-    // Read point data
-    if (isRGBA)
+    isCompressed = header[0] == 0x1F && header[1] == 0x8B;
+  }
+  if (isCompressed)
+  {
+    const gzFile compressedFile = gzopen(fileName.c_str(), "rb");
+    const int    bytesRead = compressedFile != nullptr ? gzread(compressedFile, header, sizeof(header)) : 0;
+    if (compressedFile != nullptr)
     {
-      gzread(m_Internal->m_GzFile, buffer, m_NumberOfPointPixels * 4);
+      gzclose(compressedFile);
     }
-    else if (isScalar)
+    if (bytesRead != static_cast<int>(sizeof(header)))
     {
-      gzread(m_Internal->m_GzFile, buffer, m_NumberOfPointPixels * 4);
+      itkGenericExceptionMacro("File cannot be read: " << fileName);
     }
-    else if (isDouble)
+  }
+  uint16_t attr;
+  uint32_t nface, nvert, nskip;
+  std::memcpy(&attr, header + 2, sizeof(attr));
+  std::memcpy(&nface, header + 4, sizeof(nface));
+  std::memcpy(&nvert, header + 8, sizeof(nvert));
+  std::memcpy(&nskip, header + 12, sizeof(nskip));
+  if (header[0] != 0x4D || header[1] != 0x5A)
+  {
+    itkGenericExceptionMacro("Not an MZ3 file: " << fileName);
+  }
+  if (nvert == 0)
+  {
+    itkGenericExceptionMacro("Scalar layers cannot be appended to a file without vertices: " << fileName);
+  }
+
+  // Layers in the scalar type of the file
+  const bool          isDouble = (attr & 16) != 0;
+  const bool          hasScalars = (attr & (8 | 16)) != 0;
+  const SizeValueType layerSize = static_cast<SizeValueType>(nvert) * (isDouble ? 8 : 4);
+  std::vector<uint8_t> layerBytes(numberOfLayers * layerSize);
+  if (isDouble)
+  {
+    for (SizeValueType ii = 0; ii < numberOfLayers * nvert; ++ii)
     {
-      gzread(m_Internal->m_GzFile, buffer, m_NumberOfPointPixels * 8);
+      const auto value = static_cast<double>(layers[ii]);
+      std::memcpy(layerBytes.data() + ii * sizeof(double), &value, sizeof(double));
     }
   }
   else
   {
-    // Skip header and optional skip bytes
-    m_Ifstream.seekg(16 + m_Internal->m_Skip);
-    // Skip faces if present
-    if (m_Internal->m_Attributes & 1)
+    std::memcpy(layerBytes.data(), layers, layerBytes.size());
+  }
+
+  // Size of everything before the scalars
+  SizeValueType geometrySize = 16 + static_cast<SizeValueType>(nskip);
+  if (attr & 1)
+  {
+    geometrySize += static_cast<SizeValueType>(nface) * 12;
+  }
+  if (attr & 2)
+  {
+    geometrySize += static_cast<SizeValueType>(nvert) * 12;
+  }
+  if (attr & 4)
+  {
+    geometrySize += static_cast<SizeValueType>(nvert) * 4;
+  }
+  const auto hasWholeLayers = [&](SizeValueType size) {
+    return size >= geometrySize && (size - geometrySize) % layerSize == 0 && (hasScalars || size == geometrySize);
+  };
+
+  if (isCompressed)
+  {
+    // A gzip stream cannot be cut back to its last whole member once a write tears it, so the
+    // file is written to a uniquely named temporary file that replaces the original. Concatenated
+    // gzip members decompress to the concatenation of their contents, so layers are appended to a
+    // copy of a file with scalars as another member. The scalar flag of a file without scalars is
+    // inside the first member, so that file is decompressed, patched and recompressed.
+    std::vector<uint8_t> output;
+    if (hasScalars)
     {
-      m_Ifstream.seekg(m_NumberOfCells * 12, std::ios::cur);
+      output = GzipCompress(layerBytes.data(), layerBytes.size());
     }
-    // Skip vertices if present
-    if (m_Internal->m_Attributes & 2)
+    else
     {
-      m_Ifstream.seekg(m_NumberOfPoints * 12, std::ios::cur);
+      std::ifstream        file(fileName, std::ios::binary);
+      std::vector<uint8_t> compressed((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+      std::vector<uint8_t> payload;
+      const auto           decompressor = MZ3ParallelGzipDecompressor::New();
+      decompressor->SetNumberOfWorkUnits(1);
+      decompressor->Decompress(compressed.data(), compressed.size(), payload);
+      if (!hasWholeLayers(payload.size()))
+      {
+        itkGenericExceptionMacro("Unexpected size of the MZ3 data in " << fileName);
+      }
+      attr |= 8;
+      std::memcpy(payload.data() + 2, &attr, sizeof(attr));
+      payload.insert(payload.end(), layerBytes.begin(), layerBytes.end());
+      output = GzipCompress(payload.data(), payload.size());
     }
-    // Read point data
-    if (isRGBA)
+
+    const std::string temporaryFileName = fileName + '.' + std::to_string(std::random_device{}()) + ".partial";
+    std::error_code   error;
+    bool              isWritten = !hasScalars || std::filesystem::copy_file(fileName, temporaryFileName, error);
+    FILE *            temporaryFile = isWritten ? std::fopen(temporaryFileName.c_str(), "ab") : nullptr;
+    isWritten = temporaryFile != nullptr &&
+                std::fwrite(output.data(), 1, output.size(), temporaryFile) == output.size() &&
+                FlushToDisk(temporaryFile);
+    if (temporaryFile != nullptr)
     {
-      m_Ifstream.read(static_cast<char *>(buffer), m_NumberOfPointPixels * 4);
+      isWritten = std::fclose(temporaryFile) == 0 && isWritten;
     }
-    else if (isScalar)
+    if (isWritten)
     {
-      m_Ifstream.read(static_cast<char *>(buffer), m_NumberOfPointPixels * 4);
+      std::filesystem::rename(temporaryFileName, fileName, error);
     }
-    else if (isDouble)
+    if (!isWritten || error)
     {
-      m_Ifstream.read(static_cast<char *>(buffer), m_NumberOfPointPixels * 8);
+      std::filesystem::remove(temporaryFileName, error);
+      itkGenericExceptionMacro("Failed to append scalar layers to " << fileName);
     }
+    return;
   }
-}
 
-void
-MZ3MeshIO::ReadCellData(void * itkNotUsed(buffer))
-{
-  // No cell data
+  SizeValueType originalSize = static_cast<SizeValueType>(std::filesystem::file_size(fileName));
+  if (!hasWholeLayers(originalSize))
+  {
+    if (originalSize < geometrySize)
+    {
+      itkGenericExceptionMacro("Unexpected size of the MZ3 data in " << fileName);
+    }
+    // An append that was interrupted left a partial layer, or layers whose scalar flag was never
+    // set, after the last whole layer. Readers ignore them, and they are overwritten here.
+    originalSize = hasScalars ? originalSize - (originalSize - geometrySize) % layerSize : geometrySize;
+    std::error_code error;
+    std::filesystem::resize_file(fileName, originalSize, error);
+    if (error)
+    {
+      itkGenericExceptionMacro("File cannot be written: " << fileName);
+    }
+  }
+  FILE * file = std::fopen(fileName.c_str(), "r+b");
+  if (file == nullptr)
+  {
+    itkGenericExceptionMacro("File cannot be written: " << fileName);
+  }
+  bool isWritten = std::fseek(file, 0, SEEK_END) == 0 &&
+                   std::fwrite(layerBytes.data(), 1, layerBytes.size(), file) == layerBytes.size() && FlushToDisk(file);
+  if (isWritten && !hasScalars)
+  {
+    // Set the scalar flag only once the layers are on disk
+    attr |= 8;
+    isWritten = std::fseek(file, 2, SEEK_SET) == 0 && std::fwrite(&attr, sizeof(attr), 1, file) == 1 &&
+                FlushToDisk(file);
+  }
+  isWritten = std::fclose(file) == 0 && isWritten;
+  if (!isWritten)
+  {
+    std::error_code error;
+    std::filesystem::resize_file(fileName, originalSize, error);
+    itkGenericExceptionMacro("Failed to append scalar layers to " << fileName);
+  }
 }
 
 void
 MZ3MeshIO::WriteMeshInformation()
 {
+  const ExceptionGuard outputGuard([this] { this->RemovePartialOutput(); });
+  m_Internal->m_IsWriting = false;
+  m_NumberOfBytesProcessed = 0;
+  m_NumberOfBytesToProcess = 0;
+  m_Internal->m_NextProgressReport = 0;
+  this->SetAbortGenerateData(false);
   if (this->m_UseCompression)
   {
     m_IsCompressed = true;
@@ -398,30 +2348,15 @@ MZ3MeshIO::WriteMeshInformation()
     m_IsCompressed = false;
   }
 
-  if (m_IsCompressed)
-  {
-    m_Internal->m_GzFile = gzopen(m_FileName.c_str(), "wb");
-    if (m_Internal->m_GzFile == nullptr)
-    {
-      ExceptionObject exception(__FILE__, __LINE__);
-      exception.SetDescription("File cannot be written");
-      throw exception;
-    }
-  }
-  else
-  {
-    m_Ofstream.open(m_FileName.c_str(), std::ios::binary);
-  }
-
   // Write header
   uint8_t  magic1 = 0x4D;
   uint8_t  magic2 = 0x5A;
   uint16_t attr = 0;
-  if (this->m_NumberOfCells > 0)
+  if (this->m_NumberOfCells > 0 && !m_WriteScalarsOnly)
   {
     attr |= 1;
   }
-  if (this->m_NumberOfPoints > 0)
+  if (this->m_NumberOfPoints > 0 && !m_WriteScalarsOnly)
   {
     attr |= 2;
   }
@@ -463,77 +2398,571 @@ MZ3MeshIO::WriteMeshInformation()
         }
     }
   }
-  else if (this->m_PointPixelComponentType != IOComponentEnum::UNKNOWNCOMPONENTTYPE)
+  else if (this->m_PointPixelComponentType != IOComponentEnum::UNKNOWNCOMPONENTTYPE)
+  {
+    itkExceptionMacro("Unsupported point pixel type");
+  }
+
+  // Every cell of n points becomes n - 2 triangles, and holds n + 2 values in the cell buffer.
+  // WriteCells() checks that no cell has fewer than 3 points.
+  SizeValueType numberOfFaces = this->m_NumberOfCells;
+  if (this->m_CellBufferSize > 4 * this->m_NumberOfCells)
+  {
+    numberOfFaces = this->m_CellBufferSize - 4 * this->m_NumberOfCells;
+  }
+  if (numberOfFaces > std::numeric_limits<uint32_t>::max())
+  {
+    itkExceptionMacro("Too many triangles for the MZ3 format: " << numberOfFaces);
+  }
+  m_Internal->m_NumberOfFaces = numberOfFaces;
+
+  uint32_t nface = static_cast<uint32_t>(numberOfFaces);
+  uint32_t nvert = this->m_NumberOfPoints;
+  if (this->m_NumberOfPoints == 0 || m_WriteScalarsOnly)
+  {
+    nvert = this->m_NumberOfPointPixels;
+  }
+  if (m_WriteScalarsOnly)
+  {
+    // Only the header, the skip region and the scalars are written
+    if ((attr & 24) == 0 || this->m_NumberOfPointPixels == 0)
+    {
+      itkExceptionMacro("Writing scalars only requires scalar point data");
+    }
+    nface = 0;
+    m_Internal->m_NumberOfFaces = 0;
+  }
+
+  // The summary and the spatial chunks are filled in as the sections are written, into a skip
+  // region of fixed size
+  Summary & summary = m_Internal->m_Summary;
+  summary = Summary{};
+  m_Internal->m_HasSummary = m_WriteSummary;
+  SizeValueType blocksSize = 0;
+  if (m_WriteSummary)
+  {
+    const SizeValueType numberOfLayers = (attr & 24) ? 1 : 0;
+    summary.m_Layers.resize(numberOfLayers);
+    for (Summary::Layer & layer : summary.m_Layers)
+    {
+      layer.m_Histogram.assign(m_NumberOfSummaryHistogramBins, 0);
+    }
+    blocksSize += 8 + SummaryPayloadSize(numberOfLayers, m_NumberOfSummaryHistogramBins);
+  }
+  m_Internal->m_SpatialChunks.clear();
+  m_Internal->m_PointOrder.clear();
+  if (m_WriteSpatialChunks && (attr & 1) && this->m_NumberOfPoints > 0)
+  {
+    m_Internal->m_SpatialChunks.resize(NumberOfSpatialChunks(numberOfFaces, m_MaximumFacesPerSpatialChunk));
+    blocksSize += 8 + SpatialChunksPayloadSize(m_Internal->m_SpatialChunks.size());
+  }
+  if (blocksSize > 0)
+  {
+    if (SkipRegionSize(blocksSize) > MaximumSkipRegionSize)
+    {
+      itkExceptionMacro("The summary and spatial chunks do not fit in the skip region");
+    }
+    nskip = static_cast<uint32_t>(SkipRegionSize(blocksSize));
+  }
+  m_Internal->m_Attributes = attr;
+  m_Internal->m_Skip = nskip;
+  m_Internal->m_IsWritingLevelsOfDetail = !m_LevelOfDetailFractions.empty() && (attr & 1) && this->m_NumberOfPoints > 0;
+  m_Internal->m_LevelOfDetailFaces.clear();
+  m_Internal->m_LevelOfDetailPointData.clear();
+  if ((attr & 2) && (m_IsCompressed || m_SplitQuadsAlongShortestDiagonal || !m_Internal->m_SpatialChunks.empty() ||
+                     m_Internal->m_IsTransformingPoints || m_Internal->m_IsWritingLevelsOfDetail))
+  {
+    m_Internal->m_VertexBuffer.resize(static_cast<SizeValueType>(nvert) * 3);
+  }
+
+  SizeValueType pointDataSize = 0;
+  if (attr & 4)
+  {
+    pointDataSize = static_cast<SizeValueType>(nvert) * 4;
+  }
+  else if (attr & 16)
+  {
+    pointDataSize = static_cast<SizeValueType>(nvert) * 8;
+  }
+  else if (attr & 8)
+  {
+    pointDataSize = static_cast<SizeValueType>(nvert) * 4;
+  }
+  const SizeValueType totalSize = this->GetPointDataOffset() + pointDataSize;
+  m_NumberOfBytesToProcess = totalSize;
+  summary.m_FaceSectionSize = (attr & 1) ? numberOfFaces * 12 : 0;
+  summary.m_VertexSectionSize = (attr & 2) ? static_cast<SizeValueType>(nvert) * 12 : 0;
+  summary.m_PointDataSectionSize = pointDataSize;
+
+  // The output is only removed on a failure once it is opened, so that an existing file is kept
+  // when it cannot be written
+  m_Internal->m_OutputBufferSize = 0;
+  if (m_OutputBuffer != nullptr)
+  {
+    m_OutputBuffer->clear();
+    if (m_IsCompressed)
+    {
+      m_Internal->m_DeflateStream.reset();
+      auto stream = std::make_unique<z_stream>();
+      if (deflateInit2(stream.get(), Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+      {
+        itkExceptionMacro("Failed to initialize the gzip compressor");
+      }
+      m_Internal->m_DeflateStream.reset(stream.release());
+      m_OutputBuffer->reserve(deflateBound(m_Internal->m_DeflateStream.get(), static_cast<uLong>(totalSize)));
+    }
+    else
+    {
+      m_OutputBuffer->resize(totalSize);
+    }
+    m_Internal->m_IsWriting = true;
+  }
+  else if (m_IsCompressed)
+  {
+    m_Internal->m_GzFile = gzopen(m_FileName.c_str(), "wb");
+    if (m_Internal->m_GzFile == nullptr)
+    {
+      ExceptionObject exception(__FILE__, __LINE__);
+      exception.SetDescription("File cannot be written");
+      throw exception;
+    }
+    m_Internal->m_IsWriting = true;
+  }
+  else
+  {
+#ifdef _WIN32
+    m_Ofstream.open(m_FileName.c_str(), std::ios::binary);
+    m_Internal->m_IsWriting = m_Ofstream.is_open();
+#else
+    // Every section size is known, so allocate the whole file up front and write each section
+    // at its offset
+    if (m_Internal->m_OutputFileDescriptor >= 0)
+    {
+      close(m_Internal->m_OutputFileDescriptor);
+    }
+    m_Internal->m_OutputFileDescriptor = open(m_FileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (m_Internal->m_OutputFileDescriptor < 0)
+    {
+      itkExceptionMacro("File cannot be written");
+    }
+    m_Internal->m_IsWriting = true;
+    bool isAllocated = false;
+#  ifdef __linux__
+    isAllocated = posix_fallocate(m_Internal->m_OutputFileDescriptor, 0, static_cast<off_t>(totalSize)) == 0;
+#  endif
+    if (!isAllocated && ftruncate(m_Internal->m_OutputFileDescriptor, static_cast<off_t>(totalSize)) != 0)
+    {
+      itkExceptionMacro("File cannot be written");
+    }
+#endif
+  }
+
+  uint8_t header[16];
+  header[0] = magic1;
+  header[1] = magic2;
+  std::memcpy(header + 2, &attr, sizeof(attr));
+  std::memcpy(header + 4, &nface, sizeof(nface));
+  std::memcpy(header + 8, &nvert, sizeof(nvert));
+  std::memcpy(header + 12, &nskip, sizeof(nskip));
+  m_Internal->m_DeferredOutput.clear();
+  m_Internal->m_IsDeferringOutput = nskip > 0 && m_IsCompressed;
+  this->WriteBytes(0, header, sizeof(header));
+}
+
+MZ3MeshIO::StreamOffsetType
+MZ3MeshIO::GetVertexOffset() const
+{
+  // Skip header, optional skip bytes and faces if present
+  StreamOffsetType offset = 16 + m_Internal->m_Skip;
+  if (m_Internal->m_Attributes & 1)
+  {
+    offset += static_cast<StreamOffsetType>(m_Internal->m_NumberOfFaces) * 12;
+  }
+  return offset;
+}
+
+MZ3MeshIO::StreamOffsetType
+MZ3MeshIO::GetPointDataOffset() const
+{
+  // Skip vertices if present
+  StreamOffsetType offset = this->GetVertexOffset();
+  if (m_Internal->m_Attributes & 2)
+  {
+    offset += static_cast<StreamOffsetType>(m_NumberOfPoints) * 12;
+  }
+  return offset;
+}
+
+const MZ3MeshIO::Summary *
+MZ3MeshIO::GetSummary() const
+{
+  return m_Internal->m_HasSummary ? &m_Internal->m_Summary : nullptr;
+}
+
+void
+MZ3MeshIO::UpdateArchive(const std::string & archiveFileName)
+{
+  if (m_Archive == nullptr || archiveFileName != m_Archive->GetFileName() || !m_Archive->IsUpToDate())
+  {
+    m_Archive = MZ3Archive::New();
+    m_Archive->SetFileName(archiveFileName);
+    m_Archive->Open();
+  }
+}
+
+bool
+MZ3MeshIO::ReadHeader(uint8_t header[16])
+{
+  const std::string fileName = GetLevelOfDetailFileName(m_FileName, m_LevelOfDetail);
+  std::string       archiveFileName;
+  std::string       entryName;
+  if (MZ3Archive::SplitEntryPath(fileName, archiveFileName, entryName))
+  {
+    this->UpdateArchive(archiveFileName);
+    const MZ3Archive::Entry * entry = m_Archive->FindEntry(entryName);
+    if (entry == nullptr)
+    {
+      itkExceptionMacro("No entry " << entryName << " in " << archiveFileName);
+    }
+    std::memcpy(header, entry->m_Header, 16);
+    return header[0] == 0x4D && header[1] == 0x5A;
+  }
+
+  // zlib passes uncompressed files through
+  gzFile file = gzopen(fileName.c_str(), "rb");
+  if (file == nullptr)
+  {
+    itkExceptionMacro("File cannot be read: " << fileName);
+  }
+  const bool isRead = gzread(file, header, 16) == 16;
+  gzclose(file);
+  return isRead && header[0] == 0x4D && header[1] == 0x5A;
+}
+
+bool
+MZ3MeshIO::ReadSummary(const std::string & fileName, Summary & summary)
+{
+  // zlib passes uncompressed files through
+  gzFile file = gzopen(fileName.c_str(), "rb");
+  if (file == nullptr)
+  {
+    itkGenericExceptionMacro("File cannot be read: " << fileName);
+  }
+  uint8_t  header[16];
+  uint32_t nskip = 0;
+  bool     hasSummary = false;
+  if (gzread(file, header, sizeof(header)) == sizeof(header) && header[0] == 0x4D && header[1] == 0x5A)
+  {
+    std::memcpy(&nskip, header + 12, sizeof(nskip));
+    if (nskip >= 8 && nskip <= MaximumSkipRegionSize)
+    {
+      std::vector<uint8_t> skip(nskip);
+      hasSummary = gzread(file, skip.data(), nskip) == static_cast<int>(nskip) &&
+                   DecodeSummary(skip.data(), nskip, summary);
+    }
+  }
+  gzclose(file);
+  return hasSummary;
+}
+
+uint32_t
+MZ3MeshIO::UpdateChecksum(uint32_t checksum, const void * data, SizeValueType size)
+{
+  uLong      result = checksum;
+  const auto bytes = static_cast<const Bytef *>(data);
+  for (SizeValueType begin = 0; begin < size; begin += 1u << 30)
+  {
+    result = crc32(result, bytes + begin, static_cast<uInt>(std::min<SizeValueType>(size - begin, 1u << 30)));
+  }
+  return static_cast<uint32_t>(result);
+}
+
+void
+MZ3MeshIO::WriteSkipRegion()
+{
+  if (m_Internal->m_Skip == 0 || (m_IsCompressed && !m_Internal->m_IsDeferringOutput))
+  {
+    return;
+  }
+  std::vector<uint8_t> skip(SkipRegionMagic, SkipRegionMagic + 4);
+  AppendValue<uint32_t>(skip, SkipRegionVersion);
+  if (m_Internal->m_HasSummary)
+  {
+    AppendSummaryBlock(skip, m_Internal->m_Summary);
+  }
+  if (!m_Internal->m_SpatialChunks.empty())
+  {
+    AppendSpatialChunksBlock(skip, m_Internal->m_SpatialChunks);
+  }
+  skip.resize(m_Internal->m_Skip, 0);
+  if (m_Internal->m_IsDeferringOutput)
+  {
+    // The header, skip region, faces and vertices now go into the stream in file order
+    std::vector<uint8_t> deferred;
+    deferred.swap(m_Internal->m_DeferredOutput);
+    deferred.resize(std::max<SizeValueType>(deferred.size(), 16 + skip.size()));
+    std::copy(skip.begin(), skip.end(), deferred.begin() + 16);
+    m_Internal->m_IsDeferringOutput = false;
+    this->WriteBytes(0, deferred.data(), deferred.size());
+  }
+  else
+  {
+    this->WriteBytes(16, skip.data(), skip.size());
+  }
+}
+
+void
+MZ3MeshIO::WriteBytes(StreamOffsetType offset, const void * buffer, SizeValueType numberOfBytes)
+{
+  if (m_Internal->m_IsDeferringOutput)
+  {
+    // Counted once the deferred output is written
+    std::vector<uint8_t> & deferred = m_Internal->m_DeferredOutput;
+    deferred.resize(std::max<SizeValueType>(deferred.size(), offset + numberOfBytes));
+    std::memcpy(deferred.data() + offset, buffer, numberOfBytes);
+    return;
+  }
+  if (m_OutputBuffer != nullptr && !m_IsCompressed && offset + numberOfBytes > m_OutputBuffer->size())
+  {
+    m_OutputBuffer->resize(offset + numberOfBytes);
+  }
+
+  // Write in chunks, reporting progress and checking for an abort after each
+  const bool isInParallel = m_OutputBuffer == nullptr && !m_IsCompressed && m_Internal->m_OutputFileDescriptor >= 0 &&
+                            m_ParallelWriteMinimumSize > 0 && numberOfBytes >= m_ParallelWriteMinimumSize;
+  const SizeValueType chunkSize =
+    isInParallel ? std::max<SizeValueType>(m_SectionChunkSize,
+                                           ParallelChunkSize * MultiThreaderBase::GetGlobalDefaultNumberOfThreads())
+                 : m_SectionChunkSize;
+  const auto bytes = static_cast<const uint8_t *>(buffer);
+  for (SizeValueType begin = 0; begin < numberOfBytes; begin += chunkSize)
+  {
+    const SizeValueType    size = std::min(chunkSize, numberOfBytes - begin);
+    const StreamOffsetType chunkOffset = offset + begin;
+    if (m_OutputBuffer != nullptr && !m_IsCompressed)
+    {
+      std::memcpy(m_OutputBuffer->data() + chunkOffset, bytes + begin, size);
+    }
+    else if (m_OutputBuffer != nullptr)
+    {
+      // Deflate straight into the output buffer, growing it when it is full
+      z_stream & stream = *m_Internal->m_DeflateStream;
+      stream.next_in = const_cast<Bytef *>(bytes + begin);
+      for (SizeValueType remaining = size; remaining > 0;)
+      {
+        const auto inputSize = static_cast<uInt>(std::min<SizeValueType>(remaining, 1u << 30));
+        stream.avail_in = inputSize;
+        while (stream.avail_in > 0)
+        {
+          if (m_OutputBuffer->size() == m_Internal->m_OutputBufferSize)
+          {
+            const SizeValueType growth =
+              std::max<SizeValueType>(65536, m_OutputBuffer->capacity() - m_OutputBuffer->size());
+            m_OutputBuffer->resize(m_Internal->m_OutputBufferSize + growth);
+          }
+          const SizeValueType available = m_OutputBuffer->size() - m_Internal->m_OutputBufferSize;
+          stream.next_out = m_OutputBuffer->data() + m_Internal->m_OutputBufferSize;
+          stream.avail_out = static_cast<uInt>(std::min<SizeValueType>(available, 1u << 30));
+          const uInt availableOut = stream.avail_out;
+          if (deflate(&stream, Z_NO_FLUSH) == Z_STREAM_ERROR)
+          {
+            itkExceptionMacro("Failed to compress MZ3 data");
+          }
+          m_Internal->m_OutputBufferSize += availableOut - stream.avail_out;
+        }
+        remaining -= inputSize;
+      }
+    }
+    else if (m_IsCompressed)
+    {
+      gzwrite(m_Internal->m_GzFile, bytes + begin, static_cast<unsigned int>(size));
+    }
+    else if (isInParallel)
+    {
+      this->WriteBytesInParallel(chunkOffset, bytes + begin, size);
+    }
+#ifndef _WIN32
+    else if (m_Internal->m_OutputFileDescriptor >= 0)
+    {
+      if (!PositionalWrite(m_Internal->m_OutputFileDescriptor, bytes + begin, size, chunkOffset))
+      {
+        itkExceptionMacro("Failed to write MZ3 data");
+      }
+    }
+#endif
+    else
+    {
+      m_Ofstream.seekp(chunkOffset);
+      m_Ofstream.write(reinterpret_cast<const char *>(bytes + begin), static_cast<std::streamsize>(size));
+    }
+    this->ReportBytes(size);
+  }
+}
+
+void
+MZ3MeshIO::ReportBytes(SizeValueType numberOfBytes)
+{
+  // The header is read before the size of the file is known
+  m_NumberOfBytesProcessed += numberOfBytes;
+  if (m_NumberOfBytesToProcess > 0 && (m_NumberOfBytesProcessed >= m_Internal->m_NextProgressReport ||
+                                       m_NumberOfBytesProcessed >= m_NumberOfBytesToProcess))
   {
-    itkExceptionMacro("Unsupported point pixel type");
+    m_Internal->m_NextProgressReport = m_NumberOfBytesProcessed + m_SectionChunkSize;
+    this->UpdateProgress(static_cast<float>(
+      std::min(1.0, static_cast<double>(m_NumberOfBytesProcessed) / static_cast<double>(m_NumberOfBytesToProcess))));
   }
+  if (this->GetAbortGenerateData())
+  {
+    this->RemovePartialOutput();
+    ProcessAborted exception(__FILE__, __LINE__);
+    exception.SetDescription("MZ3 I/O was aborted");
+    throw exception;
+  }
+}
 
-  uint32_t nface = this->m_NumberOfCells;
-  uint32_t nvert = this->m_NumberOfPoints;
-  if (this->m_NumberOfPoints == 0)
+void
+MZ3MeshIO::RemovePartialOutput()
+{
+  if (!m_Internal->m_IsWriting)
   {
-    nvert = this->m_NumberOfPointPixels;
+    return;
   }
-  m_Internal->m_Attributes = attr;
-  m_Internal->m_Skip = nskip;
-  if (m_IsCompressed)
+  m_Internal->m_IsWriting = false;
+  m_Internal->m_IsDeferringOutput = false;
+  m_Internal->m_DeferredOutput = std::vector<uint8_t>();
+  if (m_Internal->m_IsWritingLevelsOfDetail)
   {
-    m_Internal->m_VertexBuffer.resize(nvert * 3);
+    this->RemoveLevelsOfDetail();
   }
+  if (m_OutputBuffer != nullptr)
+  {
+    m_Internal->m_DeflateStream.reset();
+    m_OutputBuffer->clear();
+    m_Internal->m_OutputBufferSize = 0;
+    return;
+  }
+  if (m_Internal->m_GzFile != nullptr)
+  {
+    gzclose(m_Internal->m_GzFile);
+    m_Internal->m_GzFile = nullptr;
+  }
+#ifndef _WIN32
+  if (m_Internal->m_OutputFileDescriptor >= 0)
+  {
+    close(m_Internal->m_OutputFileDescriptor);
+    m_Internal->m_OutputFileDescriptor = -1;
+  }
+#endif
+  m_Ofstream.close();
+  std::error_code error;
+  std::filesystem::remove(m_FileName, error);
+}
 
-  if (m_IsCompressed)
+void
+MZ3MeshIO::RemoveLevelsOfDetail()
+{
+  m_Internal->m_IsWritingLevelsOfDetail = false;
+  m_Internal->m_LevelOfDetailFaces = std::vector<uint32_t>();
+  m_Internal->m_LevelOfDetailPointData = std::vector<double>();
+  std::error_code error;
+  if (!m_LevelOfDetailArchiveFileName.empty())
+  {
+    std::filesystem::remove(m_LevelOfDetailArchiveFileName, error);
+    return;
+  }
+  for (SizeValueType level = 1; level <= m_LevelOfDetailFractions.size(); ++level)
   {
-    gzwrite(m_Internal->m_GzFile, (char *)&magic1, sizeof(magic1));
-    gzwrite(m_Internal->m_GzFile, (char *)&magic2, sizeof(magic2));
-    gzwrite(m_Internal->m_GzFile, (char *)&attr, sizeof(attr));
-    gzwrite(m_Internal->m_GzFile, (char *)&nface, sizeof(nface));
-    gzwrite(m_Internal->m_GzFile, (char *)&nvert, sizeof(nvert));
-    gzwrite(m_Internal->m_GzFile, (char *)&nskip, sizeof(nskip));
+    std::filesystem::remove(GetLevelOfDetailFileName(m_FileName, static_cast<unsigned int>(level)), error);
   }
-  else
+}
+
+void
+MZ3MeshIO::WriteBytesInParallel(StreamOffsetType offset, const void * buffer, SizeValueType numberOfBytes)
+{
+#ifdef _WIN32
+  itkExceptionMacro("Concurrent writes are not available on Windows");
+#else
+  constexpr SizeValueType chunkSize = ParallelChunkSize;
+  const SizeValueType     numberOfChunks = (numberOfBytes + chunkSize - 1) / chunkSize;
+  const int               fileDescriptor = m_Internal->m_OutputFileDescriptor;
+  std::atomic<bool>       isWritten{ true };
+
+  const auto multiThreader = MultiThreaderBase::New();
+  multiThreader->SetNumberOfWorkUnits(static_cast<unsigned int>(
+    std::min<SizeValueType>(MultiThreaderBase::GetGlobalDefaultNumberOfThreads(), numberOfChunks)));
+  multiThreader->ParallelizeArray(
+    0,
+    numberOfChunks,
+    [&](SizeValueType chunk) {
+      const SizeValueType begin = chunk * chunkSize;
+      const SizeValueType size = std::min(chunkSize, numberOfBytes - begin);
+      if (!PositionalWrite(fileDescriptor, static_cast<const uint8_t *>(buffer) + begin, size, offset + begin))
+      {
+        isWritten = false;
+      }
+    },
+    nullptr);
+  if (!isWritten)
   {
-    m_Ofstream.write(reinterpret_cast<char *>(&magic1), sizeof(magic1));
-    m_Ofstream.write(reinterpret_cast<char *>(&magic2), sizeof(magic2));
-    m_Ofstream.write(reinterpret_cast<char *>(&attr), sizeof(attr));
-    m_Ofstream.write(reinterpret_cast<char *>(&nface), sizeof(nface));
-    m_Ofstream.write(reinterpret_cast<char *>(&nvert), sizeof(nvert));
-    m_Ofstream.write(reinterpret_cast<char *>(&nskip), sizeof(nskip));
+    itkExceptionMacro("Failed to write MZ3 data");
   }
+#endif
 }
 
 void
 MZ3MeshIO::WritePoints(void * buffer)
 {
+  const ExceptionGuard outputGuard([this] { this->RemovePartialOutput(); });
+  if (m_WriteScalarsOnly)
+  {
+    return;
+  }
+  // Transformed points are written from the vertex buffer
+  const bool     isTransformed = m_Internal->m_IsTransformingPoints;
+  const double * matrix = m_Internal->m_PointTransformMatrix;
+  const bool     isFlippingAxes = m_Internal->m_IsFlippingAxes;
+  float *        vertices = m_Internal->m_VertexBuffer.data();
   switch (this->m_PointComponentType)
   {
     case IOComponentEnum::FLOAT:
     {
-      if (m_IsCompressed)
-      {
-        // Copy for deferred writing
-        std::memcpy(m_Internal->m_VertexBuffer.data(), buffer, m_NumberOfPoints * 3 * sizeof(float));
-      }
-      else
+      const auto points = static_cast<const float *>(buffer);
+      if (isTransformed)
       {
-        // Skip header and optional skip bytes
-        m_Ofstream.seekp(16 + m_Internal->m_Skip);
-        // Skip faces if present
-        if (m_Internal->m_Attributes & 1)
-        {
-          m_Ofstream.seekp(m_NumberOfCells * 12, std::ios::cur);
-        }
-        // Write vertex coordinates
-        m_Ofstream.write(static_cast<char *>(buffer), m_NumberOfPoints * 3 * sizeof(float));
+        TransformPoints<float>(matrix, isFlippingAxes, points, vertices, m_NumberOfPoints);
       }
+      this->WriteFloatPoints(isTransformed ? vertices : points);
       break;
     }
     case IOComponentEnum::DOUBLE:
     {
+      if (isTransformed)
+      {
+        TransformPoints<double>(
+          matrix, isFlippingAxes, static_cast<const double *>(buffer), vertices, m_NumberOfPoints);
+        this->WriteFloatPoints(vertices);
+        break;
+      }
+      if (m_Internal->m_HasSummary && m_Internal->m_SpatialChunks.empty())
+      {
+        SummarizePoints(static_cast<const double *>(buffer), m_NumberOfPoints, m_Internal->m_Summary);
+      }
       WritePoints(static_cast<double *>(buffer));
       break;
     }
     case IOComponentEnum::LDOUBLE:
     {
+      if (isTransformed)
+      {
+        TransformPoints<long double>(
+          matrix, isFlippingAxes, static_cast<const long double *>(buffer), vertices, m_NumberOfPoints);
+        this->WriteFloatPoints(vertices);
+        break;
+      }
+      if (m_Internal->m_HasSummary && m_Internal->m_SpatialChunks.empty())
+      {
+        SummarizePoints(static_cast<const long double *>(buffer), m_NumberOfPoints, m_Internal->m_Summary);
+      }
       WritePoints(static_cast<long double *>(buffer));
       break;
     }
@@ -544,9 +2973,37 @@ MZ3MeshIO::WritePoints(void * buffer)
   }
 }
 
+void
+MZ3MeshIO::WriteFloatPoints(const float * points)
+{
+  // Points ordered into chunks are summarized once they are in order
+  const bool isChunked = !m_Internal->m_SpatialChunks.empty();
+  if (m_Internal->m_HasSummary && !isChunked)
+  {
+    SummarizePoints(points, m_NumberOfPoints, m_Internal->m_Summary);
+  }
+  if ((m_IsCompressed || m_SplitQuadsAlongShortestDiagonal || isChunked || m_Internal->m_IsWritingLevelsOfDetail) &&
+      points != m_Internal->m_VertexBuffer.data())
+  {
+    // Copy for deferred writing, for splitting quadrilaterals, for ordering into chunks, or for
+    // the levels of detail
+    std::memcpy(m_Internal->m_VertexBuffer.data(), points, m_NumberOfPoints * 3 * sizeof(float));
+  }
+  if (!m_IsCompressed && !isChunked)
+  {
+    // Write vertex coordinates
+    this->WriteBytes(this->GetVertexOffset(), points, m_NumberOfPoints * 3 * sizeof(float));
+  }
+}
+
 void
 MZ3MeshIO::WriteCells(void * buffer)
 {
+  const ExceptionGuard outputGuard([this] { this->RemovePartialOutput(); });
+  if (m_WriteScalarsOnly)
+  {
+    return;
+  }
   switch (this->m_CellComponentType)
   {
     case IOComponentEnum::UCHAR:
@@ -606,140 +3063,579 @@ MZ3MeshIO::WriteCells(void * buffer)
   }
 }
 
+void
+MZ3MeshIO::WriteSpatiallyOrderedFaces(const std::vector<uint32_t> & faces)
+{
+  std::vector<SpatialChunk> & chunks = m_Internal->m_SpatialChunks;
+  const SizeValueType         numberOfChunks = chunks.size();
+  const SizeValueType         numberOfFaces = faces.size() / 3;
+  const SizeValueType         numberOfPoints = m_NumberOfPoints;
+  const float *               points = m_Internal->m_VertexBuffer.data();
+  if (std::any_of(faces.begin(), faces.end(), [numberOfPoints](uint32_t ii) { return ii >= numberOfPoints; }))
+  {
+    itkExceptionMacro("A face refers to a point index that is out of range");
+  }
+
+  // Sums of the coordinates of the points of every face, which order faces as their centroids do
+  std::vector<float> centroids(numberOfFaces * 3);
+  std::vector<uint32_t> order(numberOfFaces);
+  const auto            multiThreader = MultiThreaderBase::New();
+  multiThreader->ParallelizeArray(
+    0,
+    numberOfFaces,
+    [&](SizeValueType face) {
+      order[face] = static_cast<uint32_t>(face);
+      for (unsigned int kk = 0; kk < 3; ++kk)
+      {
+        centroids[face * 3 + kk] = points[faces[face * 3] * 3 + kk] + points[faces[face * 3 + 1] * 3 + kk] +
+                                   points[faces[face * 3 + 2] * 3 + kk];
+      }
+    },
+    nullptr);
+
+  // Split the ranges of every level at their median along the longest axis of their centroids.
+  // Range i of level l is [n i / 2^l, n (i + 1) / 2^l), so the leaves are the chunks.
+  const auto boundary = [numberOfFaces](SizeValueType index, SizeValueType numberOfRanges) {
+    return numberOfFaces * index / numberOfRanges;
+  };
+  for (SizeValueType numberOfRanges = 1; numberOfRanges < numberOfChunks; numberOfRanges *= 2)
+  {
+    multiThreader->ParallelizeArray(
+      0,
+      numberOfRanges,
+      [&](SizeValueType range) {
+        const auto begin = order.begin() + boundary(range, numberOfRanges);
+        const auto end = order.begin() + boundary(range + 1, numberOfRanges);
+        float      minimum[3];
+        float      maximum[3];
+        for (unsigned int kk = 0; kk < 3; ++kk)
+        {
+          minimum[kk] = std::numeric_limits<float>::max();
+          maximum[kk] = std::numeric_limits<float>::lowest();
+        }
+        for (auto face = begin; face != end; ++face)
+        {
+          for (unsigned int kk = 0; kk < 3; ++kk)
+          {
+            minimum[kk] = std::min(minimum[kk], centroids[*face * 3 + kk]);
+            maximum[kk] = std::max(maximum[kk], centroids[*face * 3 + kk]);
+          }
+        }
+        unsigned int axis = 0;
+        for (unsigned int kk = 1; kk < 3; ++kk)
+        {
+          if (maximum[kk] - minimum[kk] > maximum[axis] - minimum[axis])
+          {
+            axis = kk;
+          }
+        }
+        std::nth_element(begin,
+                         order.begin() + boundary(2 * range + 1, 2 * numberOfRanges),
+                         end,
+                         [&centroids, axis](uint32_t a, uint32_t b) {
+                           return centroids[a * 3 + axis] < centroids[b * 3 + axis];
+                         });
+      },
+      nullptr);
+  }
+  centroids = std::vector<float>();
+
+  // Number the points in the order the chunks first refer to them, and the points of no face last
+  constexpr uint32_t      unnumbered = std::numeric_limits<uint32_t>::max();
+  std::vector<uint32_t>   pointIds(numberOfPoints, unnumbered);
+  std::vector<uint32_t> & pointOrder = m_Internal->m_PointOrder;
+  std::vector<uint32_t>   orderedFaces(numberOfFaces * 3);
+  pointOrder.clear();
+  pointOrder.reserve(numberOfPoints);
+  for (SizeValueType chunk = 0; chunk < numberOfChunks; ++chunk)
+  {
+    const SizeValueType begin = boundary(chunk, numberOfChunks);
+    const SizeValueType end = boundary(chunk + 1, numberOfChunks);
+    chunks[chunk].m_FirstFace = static_cast<uint32_t>(begin);
+    chunks[chunk].m_NumberOfFaces = static_cast<uint32_t>(end - begin);
+    chunks[chunk].m_FirstPoint = static_cast<uint32_t>(pointOrder.size());
+    for (SizeValueType face = begin; face < end; ++face)
+    {
+      for (unsigned int kk = 0; kk < 3; ++kk)
+      {
+        const uint32_t pointId = faces[SizeValueType{ order[face] } * 3 + kk];
+        if (pointIds[pointId] == unnumbered)
+        {
+          pointIds[pointId] = static_cast<uint32_t>(pointOrder.size());
+          pointOrder.push_back(pointId);
+        }
+        orderedFaces[face * 3 + kk] = pointIds[pointId];
+      }
+    }
+    chunks[chunk].m_NumberOfPoints = static_cast<uint32_t>(pointOrder.size() - chunks[chunk].m_FirstPoint);
+  }
+  for (SizeValueType pointId = 0; pointId < numberOfPoints; ++pointId)
+  {
+    if (pointIds[pointId] == unnumbered)
+    {
+      pointOrder.push_back(static_cast<uint32_t>(pointId));
+    }
+  }
+
+  std::vector<float> orderedPoints(numberOfPoints * 3);
+  for (SizeValueType pointId = 0; pointId < numberOfPoints; ++pointId)
+  {
+    std::copy_n(points + SizeValueType{ pointOrder[pointId] } * 3, 3, orderedPoints.data() + pointId * 3);
+  }
+  multiThreader->ParallelizeArray(
+    0,
+    numberOfChunks,
+    [&](SizeValueType chunk) {
+      float * bounds = chunks[chunk].m_Bounds;
+      for (unsigned int kk = 0; kk < 3; ++kk)
+      {
+        bounds[2 * kk] = std::numeric_limits<float>::max();
+        bounds[2 * kk + 1] = std::numeric_limits<float>::lowest();
+      }
+      const SizeValueType end = (SizeValueType{ chunks[chunk].m_FirstFace } + chunks[chunk].m_NumberOfFaces) * 3;
+      for (SizeValueType ii = SizeValueType{ chunks[chunk].m_FirstFace } * 3; ii < end; ++ii)
+      {
+        for (unsigned int kk = 0; kk < 3; ++kk)
+        {
+          bounds[2 * kk] = std::min(bounds[2 * kk], orderedPoints[orderedFaces[ii] * 3 + kk]);
+          bounds[2 * kk + 1] = std::max(bounds[2 * kk + 1], orderedPoints[orderedFaces[ii] * 3 + kk]);
+        }
+      }
+    },
+    nullptr);
+
+  // The checksums cover the sections as they are stored
+  if (m_Internal->m_HasSummary)
+  {
+    m_Internal->m_Summary.m_FaceChecksum = UpdateChecksum(0, orderedFaces.data(), orderedFaces.size() * 4);
+    SummarizePoints(orderedPoints.data(), numberOfPoints, m_Internal->m_Summary);
+  }
+  this->WriteBytes(16 + m_Internal->m_Skip, orderedFaces.data(), orderedFaces.size() * sizeof(uint32_t));
+  this->WriteBytes(this->GetVertexOffset(), orderedPoints.data(), orderedPoints.size() * sizeof(float));
+}
+
 void
 MZ3MeshIO::WritePointData(void * buffer)
 {
+  const ExceptionGuard outputGuard([this] { this->RemovePartialOutput(); });
   if (this->m_PointPixelComponentType == IOComponentEnum::UNKNOWNCOMPONENTTYPE)
   {
     std::cerr << "Unknown point pixel component type****" << std::endl;
     return;
   }
-  if (m_IsCompressed)
+  if (m_Internal->m_IsWritingLevelsOfDetail)
+  {
+    // Keep the point data, in the order of the points, to resample it onto the levels
+    const SizeValueType numberOfValues = m_NumberOfPointPixels * this->m_NumberOfPointPixelComponents;
+    std::vector<double> & values = m_Internal->m_LevelOfDetailPointData;
+    switch (this->m_PointPixelComponentType)
+    {
+      case IOComponentEnum::DOUBLE:
+        values.assign(static_cast<const double *>(buffer), static_cast<const double *>(buffer) + numberOfValues);
+        break;
+      case IOComponentEnum::FLOAT:
+        values.assign(static_cast<const float *>(buffer), static_cast<const float *>(buffer) + numberOfValues);
+        break;
+      case IOComponentEnum::UCHAR:
+        values.assign(static_cast<const unsigned char *>(buffer),
+                      static_cast<const unsigned char *>(buffer) + numberOfValues);
+        break;
+      case IOComponentEnum::CHAR:
+        values.assign(static_cast<const char *>(buffer), static_cast<const char *>(buffer) + numberOfValues);
+        break;
+      case IOComponentEnum::USHORT:
+        values.assign(static_cast<const unsigned short *>(buffer),
+                      static_cast<const unsigned short *>(buffer) + numberOfValues);
+        break;
+      case IOComponentEnum::SHORT:
+        values.assign(static_cast<const short *>(buffer), static_cast<const short *>(buffer) + numberOfValues);
+        break;
+      default:
+        break;
+    }
+  }
+  std::vector<uint8_t> orderedPointData;
+  if (!m_Internal->m_PointOrder.empty())
   {
-    if (this->m_PointPixelType == IOPixelEnum::RGBA && this->m_PointPixelComponentType == IOComponentEnum::UCHAR)
+    // The point data follows the points into chunk order
+    if (m_NumberOfPointPixels != m_Internal->m_PointOrder.size())
+    {
+      itkExceptionMacro("Point data written in spatial chunks must hold one pixel per point");
+    }
+    const SizeValueType pixelSize =
+      PointPixelComponentSize(this->m_PointPixelComponentType) * this->m_NumberOfPointPixelComponents;
+    const auto pixels = static_cast<const uint8_t *>(buffer);
+    orderedPointData.resize(m_NumberOfPointPixels * pixelSize);
+    for (SizeValueType ii = 0; ii < m_NumberOfPointPixels; ++ii)
     {
-      gzwrite(m_Internal->m_GzFile, buffer, m_NumberOfPointPixels * 4);
+      std::memcpy(orderedPointData.data() + ii * pixelSize,
+                  pixels + SizeValueType{ m_Internal->m_PointOrder[ii] } * pixelSize,
+                  pixelSize);
     }
-    else if (this->m_PointPixelType == IOPixelEnum::SCALAR &&
-             this->m_PointPixelComponentType == IOComponentEnum::DOUBLE)
+    buffer = orderedPointData.data();
+  }
+  if (m_Internal->m_HasSummary)
+  {
+    Summary & summary = m_Internal->m_Summary;
+    switch (this->m_PointPixelType == IOPixelEnum::RGBA ? IOComponentEnum::UNKNOWNCOMPONENTTYPE
+                                                        : this->m_PointPixelComponentType)
     {
-      gzwrite(m_Internal->m_GzFile, buffer, m_NumberOfPointPixels * 8);
+      case IOComponentEnum::DOUBLE:
+        SummarizeScalars<double>(static_cast<const double *>(buffer), m_NumberOfPointPixels, summary);
+        break;
+      case IOComponentEnum::FLOAT:
+        SummarizeScalars<float>(static_cast<const float *>(buffer), m_NumberOfPointPixels, summary);
+        break;
+      case IOComponentEnum::UCHAR:
+        SummarizeScalars<float>(static_cast<const unsigned char *>(buffer), m_NumberOfPointPixels, summary);
+        break;
+      case IOComponentEnum::CHAR:
+        SummarizeScalars<float>(static_cast<const char *>(buffer), m_NumberOfPointPixels, summary);
+        break;
+      case IOComponentEnum::USHORT:
+        SummarizeScalars<float>(static_cast<const unsigned short *>(buffer), m_NumberOfPointPixels, summary);
+        break;
+      case IOComponentEnum::SHORT:
+        SummarizeScalars<float>(static_cast<const short *>(buffer), m_NumberOfPointPixels, summary);
+        break;
+      default:
+        summary.m_PointDataChecksum = UpdateChecksum(0, buffer, summary.m_PointDataSectionSize);
     }
-    else if (this->m_PointPixelType == IOPixelEnum::SCALAR && this->m_PointPixelComponentType == IOComponentEnum::FLOAT)
+  }
+  if (m_Internal->m_IsDeferringOutput)
+  {
+    this->WriteSkipRegion();
+  }
+  const StreamOffsetType offset = this->GetPointDataOffset();
+  if (this->m_PointPixelType == IOPixelEnum::RGBA && this->m_PointPixelComponentType == IOComponentEnum::UCHAR)
+  {
+    this->WriteBytes(offset, buffer, m_NumberOfPointPixels * 4);
+  }
+  else if (this->m_PointPixelType == IOPixelEnum::SCALAR && this->m_PointPixelComponentType == IOComponentEnum::DOUBLE)
+  {
+    this->WriteBytes(offset, buffer, m_NumberOfPointPixels * 8);
+  }
+  else if (this->m_PointPixelType == IOPixelEnum::SCALAR && this->m_PointPixelComponentType == IOComponentEnum::FLOAT)
+  {
+    this->WriteBytes(offset, buffer, m_NumberOfPointPixels * 4);
+  }
+  else
+  {
+    if (this->m_PointPixelType == IOPixelEnum::SCALAR)
     {
-      gzwrite(m_Internal->m_GzFile, buffer, m_NumberOfPointPixels * 4);
+      switch (this->m_PointPixelComponentType)
+      {
+        case IOComponentEnum::UCHAR:
+          WritePointData(static_cast<unsigned char *>(buffer));
+          break;
+        case IOComponentEnum::CHAR:
+          WritePointData(static_cast<char *>(buffer));
+          break;
+        case IOComponentEnum::USHORT:
+          WritePointData(static_cast<unsigned short *>(buffer));
+          break;
+        case IOComponentEnum::SHORT:
+          WritePointData(static_cast<short *>(buffer));
+          break;
+        default:
+          itkExceptionMacro("Unsupported point pixel component type");
+      }
     }
     else
     {
-      if (this->m_PointPixelType == IOPixelEnum::SCALAR)
+      itkExceptionMacro("Unsupported point pixel type");
+    }
+  }
+}
+
+void
+MZ3MeshIO::WriteCellData(void * itkNotUsed(buffer))
+{
+  // No cell data
+}
+
+void
+MZ3MeshIO::Write()
+{
+  const ExceptionGuard outputGuard([this] { this->RemovePartialOutput(); });
+  this->WriteSkipRegion();
+  if (m_OutputBuffer != nullptr)
+  {
+    if (m_IsCompressed)
+    {
+      // Flush the remaining compressed data and the gzip trailer
+      z_stream & stream = *m_Internal->m_DeflateStream;
+      stream.avail_in = 0;
+      int status = Z_OK;
+      while (status == Z_OK)
       {
-        switch (this->m_PointPixelComponentType)
+        if (m_OutputBuffer->size() == m_Internal->m_OutputBufferSize)
         {
-          case IOComponentEnum::UCHAR:
-            WritePointData(static_cast<unsigned char *>(buffer));
-            break;
-          case IOComponentEnum::CHAR:
-            WritePointData(static_cast<char *>(buffer));
-            break;
-          case IOComponentEnum::USHORT:
-            WritePointData(static_cast<unsigned short *>(buffer));
-            break;
-          case IOComponentEnum::SHORT:
-            WritePointData(static_cast<short *>(buffer));
-            break;
-          default:
-            itkExceptionMacro("Unsupported point pixel component type");
+          m_OutputBuffer->resize(m_Internal->m_OutputBufferSize + 65536);
         }
+        stream.next_out = m_OutputBuffer->data() + m_Internal->m_OutputBufferSize;
+        stream.avail_out = static_cast<uInt>(
+          std::min<SizeValueType>(m_OutputBuffer->size() - m_Internal->m_OutputBufferSize, 1u << 30));
+        const uInt availableOut = stream.avail_out;
+        status = deflate(&stream, Z_FINISH);
+        m_Internal->m_OutputBufferSize += availableOut - stream.avail_out;
       }
-      else
+      m_Internal->m_DeflateStream.reset();
+      if (status != Z_STREAM_END)
       {
-        itkExceptionMacro("Unsupported point pixel type");
+        itkExceptionMacro("Failed to compress MZ3 data");
       }
+      m_OutputBuffer->resize(m_Internal->m_OutputBufferSize);
     }
   }
-  else
+  else if (m_IsCompressed)
   {
-    // Skip header and optional skip bytes
-    m_Ofstream.seekp(16 + m_Internal->m_Skip);
-    // Skip faces if present
-    if (m_Internal->m_Attributes & 1)
+    if (m_Internal->m_GzFile != nullptr)
     {
-      m_Ofstream.seekp(m_NumberOfCells * 12, std::ios::cur);
+      const bool isClosed = gzclose(m_Internal->m_GzFile) == Z_OK;
+      m_Internal->m_GzFile = nullptr;
+      if (!isClosed)
+      {
+        itkExceptionMacro("Failed to write MZ3 data");
+      }
     }
-    // Skip vertices if present
-    if (m_Internal->m_Attributes & 2)
+    // zlib does not expose its descriptor, so the file is flushed through a new one
+    if (m_Durability == DurabilityEnum::Sync && !FlushToDisk(m_FileName))
     {
-      m_Ofstream.seekp(m_NumberOfPoints * 12, std::ios::cur);
+      itkExceptionMacro("Failed to flush " << m_FileName << " to disk");
     }
-    if (this->m_PointPixelType == IOPixelEnum::RGBA && this->m_PointPixelComponentType == IOComponentEnum::UCHAR)
+  }
+#ifndef _WIN32
+  else if (m_Internal->m_OutputFileDescriptor >= 0)
+  {
+    const int  fileDescriptor = m_Internal->m_OutputFileDescriptor;
+    const bool isFlushed = m_Durability != DurabilityEnum::Sync || fsync(fileDescriptor) == 0;
+    m_Internal->m_OutputFileDescriptor = -1;
+    if (close(fileDescriptor) != 0 || !isFlushed)
     {
-      m_Ofstream.write(static_cast<char *>(buffer), m_NumberOfPointPixels * 4);
+      itkExceptionMacro("Failed to write MZ3 data");
     }
-    else if (this->m_PointPixelType == IOPixelEnum::SCALAR &&
-             this->m_PointPixelComponentType == IOComponentEnum::DOUBLE)
+  }
+#endif
+  else
+  {
+    m_Ofstream.close();
+    if (m_Durability == DurabilityEnum::Sync && !FlushToDisk(m_FileName))
     {
-      m_Ofstream.write(static_cast<char *>(buffer), m_NumberOfPointPixels * 8);
+      itkExceptionMacro("Failed to flush " << m_FileName << " to disk");
     }
-    else if (this->m_PointPixelType == IOPixelEnum::SCALAR && this->m_PointPixelComponentType == IOComponentEnum::FLOAT)
+  }
+
+  const bool isWritingLevelsOfDetail = m_Internal->m_IsWritingLevelsOfDetail;
+  m_Internal->m_IsWriting = false;
+  m_Internal->m_IsWritingLevelsOfDetail = false;
+  if (isWritingLevelsOfDetail)
+  {
+    // The mesh is complete and is kept; only the levels are removed if they cannot all be written
+    try
     {
-      m_Ofstream.write(static_cast<char *>(buffer), m_NumberOfPointPixels * 4);
+      this->WriteLevelsOfDetail();
     }
-    else
+    catch (...)
     {
-      if (this->m_PointPixelType == IOPixelEnum::SCALAR)
-      {
-        switch (this->m_PointPixelComponentType)
-        {
-          case IOComponentEnum::UCHAR:
-            WritePointData(static_cast<unsigned char *>(buffer));
-            break;
-          case IOComponentEnum::CHAR:
-            WritePointData(static_cast<char *>(buffer));
-            break;
-          case IOComponentEnum::USHORT:
-            WritePointData(static_cast<unsigned short *>(buffer));
-            break;
-          case IOComponentEnum::SHORT:
-            WritePointData(static_cast<short *>(buffer));
-            break;
-          default:
-            itkExceptionMacro("Unsupported point pixel component type");
-        }
-      }
-      else
-      {
-        itkExceptionMacro("Unsupported point pixel type");
-      }
+      this->RemoveLevelsOfDetail();
+      throw;
     }
   }
 }
 
 void
-MZ3MeshIO::WriteCellData(void * itkNotUsed(buffer))
+MZ3MeshIO::SetLevelOfDetailFractions(const std::vector<double> & fractions)
 {
-  // No cell data
+  for (const double fraction : fractions)
+  {
+    if (!(fraction > 0.0 && fraction < 1.0))
+    {
+      itkExceptionMacro("Level of detail fractions must be in (0, 1), not " << fraction);
+    }
+  }
+  if (fractions != m_LevelOfDetailFractions)
+  {
+    m_LevelOfDetailFractions = fractions;
+    this->Modified();
+  }
 }
 
 void
-MZ3MeshIO::Write()
+MZ3MeshIO::WriteLevelsOfDetail()
 {
-  if (m_IsCompressed)
+  const std::vector<double> &   fractions = m_LevelOfDetailFractions;
+  const std::vector<uint32_t> & faces = m_Internal->m_LevelOfDetailFaces;
+  const float *                 points = m_Internal->m_VertexBuffer.data();
+  const SizeValueType           numberOfPoints = m_NumberOfPoints;
+  std::vector<MZ3DecimatedMesh> levels(fractions.size());
+  MultiThreaderBase::New()->ParallelizeArray(
+    0,
+    levels.size(),
+    [&](SizeValueType level) {
+      DecimateMZ3Mesh(points, numberOfPoints, faces.data(), faces.size() / 3, fractions[level], levels[level]);
+    },
+    nullptr);
+
+  // Point data is resampled when it holds one pixel per point
+  const std::vector<double> & pointData = m_Internal->m_LevelOfDetailPointData;
+  const SizeValueType         valuesPerPoint = this->m_NumberOfPointPixelComponents;
+  const bool isResampling = !pointData.empty() && m_NumberOfPointPixels == numberOfPoints && valuesPerPoint > 0 &&
+                            pointData.size() == numberOfPoints * valuesPerPoint;
+
+  MZ3Archive::Pointer archive;
+  std::string         stem;
+  if (!m_LevelOfDetailArchiveFileName.empty())
   {
-    if (m_Internal->m_GzFile != nullptr)
+    archive = MZ3Archive::New();
+    archive->SetFileName(m_LevelOfDetailArchiveFileName);
+    stem = itksys::SystemTools::GetFilenameWithoutLastExtension(m_FileName);
+    if (m_OutputBuffer != nullptr)
     {
-      gzclose(m_Internal->m_GzFile);
-      m_Internal->m_GzFile = nullptr;
+      archive->AddEntry(stem, m_OutputBuffer->data(), m_OutputBuffer->size());
+    }
+    else
+    {
+      archive->AddFile(stem, m_FileName);
     }
   }
-  else
+
+  std::vector<uint8_t> levelBuffer;
+  for (SizeValueType level = 0; level < levels.size(); ++level)
   {
-    m_Ofstream.close();
+    MZ3DecimatedMesh &    mesh = levels[level];
+    const SizeValueType   levelPoints = mesh.m_Points.size() / 3;
+    const SizeValueType   levelFaces = mesh.m_Faces.size() / 3;
+    std::vector<uint32_t> cells(levelFaces * 5);
+    for (SizeValueType face = 0; face < levelFaces; ++face)
+    {
+      cells[face * 5] = static_cast<uint32_t>(CellGeometryEnum::TRIANGLE_CELL);
+      cells[face * 5 + 1] = 3;
+      std::copy_n(mesh.m_Faces.data() + face * 3, 3, cells.data() + face * 5 + 2);
+    }
+    mesh.m_Faces = std::vector<uint32_t>();
+
+    const auto levelIO = Self::New();
+    levelIO->SetUseCompression(this->m_UseCompression);
+    levelIO->SetDurability(m_Durability);
+    levelIO->SetPointComponentType(IOComponentEnum::FLOAT);
+    levelIO->SetCellComponentType(IOComponentEnum::UINT);
+    levelIO->SetNumberOfPoints(levelPoints);
+    levelIO->SetNumberOfCells(levelFaces);
+    levelIO->SetCellBufferSize(cells.size());
+
+    // Colors are rounded back to bytes, and scalars are written as the file stores them
+    std::vector<double>        means;
+    std::vector<float>         floatMeans;
+    std::vector<unsigned char> colorMeans;
+    void *                     levelPointData = nullptr;
+    if (isResampling)
+    {
+      means = ResamplePointData(pointData, valuesPerPoint, mesh.m_PointMap, levelPoints);
+      levelIO->SetNumberOfPointPixels(levelPoints);
+      levelIO->SetNumberOfPointPixelComponents(valuesPerPoint);
+      levelIO->SetPointPixelType(this->m_PointPixelType);
+      if (this->m_PointPixelType == IOPixelEnum::RGBA)
+      {
+        colorMeans.resize(means.size());
+        std::transform(means.begin(), means.end(), colorMeans.begin(), [](double mean) {
+          return static_cast<unsigned char>(std::min(std::max(std::round(mean), 0.0), 255.0));
+        });
+        levelIO->SetPointPixelComponentType(IOComponentEnum::UCHAR);
+        levelPointData = colorMeans.data();
+      }
+      else if (m_Internal->m_Attributes & 16)
+      {
+        levelIO->SetPointPixelComponentType(IOComponentEnum::DOUBLE);
+        levelPointData = means.data();
+      }
+      else
+      {
+        floatMeans.assign(means.begin(), means.end());
+        levelIO->SetPointPixelComponentType(IOComponentEnum::FLOAT);
+        levelPointData = floatMeans.data();
+      }
+    }
+
+    levelIO->SetFileName(GetLevelOfDetailFileName(m_FileName, static_cast<unsigned int>(level + 1)));
+    if (archive != nullptr)
+    {
+      levelIO->SetOutputBuffer(&levelBuffer);
+    }
+    levelIO->WriteMeshInformation();
+    levelIO->WritePoints(mesh.m_Points.data());
+    if (levelFaces > 0)
+    {
+      levelIO->WriteCells(cells.data());
+    }
+    if (levelPointData != nullptr)
+    {
+      levelIO->WritePointData(levelPointData);
+    }
+    levelIO->Write();
+    if (archive != nullptr)
+    {
+      archive->AddEntry(stem + "_lod" + std::to_string(level + 1), levelBuffer.data(), levelBuffer.size());
+    }
+    if (this->GetAbortGenerateData())
+    {
+      ProcessAborted exception(__FILE__, __LINE__);
+      exception.SetDescription("MZ3 I/O was aborted");
+      throw exception;
+    }
+  }
+  if (archive != nullptr)
+  {
+    archive->Write();
   }
+  m_Internal->m_LevelOfDetailFaces = std::vector<uint32_t>();
+  m_Internal->m_LevelOfDetailPointData = std::vector<double>();
 }
 
 void
 MZ3MeshIO::PrintSelf(std::ostream & os, Indent indent) const
 {
   Superclass::PrintSelf(os, indent);
+
+  os << indent << "UseParallelDecompression: " << (m_UseParallelDecompression ? "On" : "Off") << std::endl;
+  os << indent << "ParallelReadMinimumSize: " << m_ParallelReadMinimumSize << std::endl;
+  os << indent << "UseDirectIO: " << (m_UseDirectIO ? "On" : "Off") << std::endl;
+  os << indent << "InputBuffer: " << m_InputBuffer << std::endl;
+  os << indent << "InputBufferSize: " << m_InputBufferSize << std::endl;
+  os << indent << "Archive: " << m_Archive.GetPointer() << std::endl;
+  os << indent << "OutputBuffer: " << m_OutputBuffer << std::endl;
+  os << indent << "ParallelWriteMinimumSize: " << m_ParallelWriteMinimumSize << std::endl;
+  os << indent << "SectionChunkSize: " << m_SectionChunkSize << std::endl;
+  os << indent << "NumberOfBytesProcessed: " << m_NumberOfBytesProcessed << std::endl;
+  os << indent << "NumberOfBytesToProcess: " << m_NumberOfBytesToProcess << std::endl;
+  os << indent << "Durability: " << m_Durability << std::endl;
+  os << indent << "WriteSummary: " << (m_WriteSummary ? "On" : "Off") << std::endl;
+  os << indent << "NumberOfSummaryHistogramBins: " << m_NumberOfSummaryHistogramBins << std::endl;
+  os << indent << "PointTransform: " << m_PointTransform << std::endl;
+  os << indent << "LevelOfDetail: " << m_LevelOfDetail << std::endl;
+  os << indent << "LevelOfDetailFractions:";
+  for (const double fraction : m_LevelOfDetailFractions)
+  {
+    os << ' ' << fraction;
+  }
+  os << std::endl;
+  os << indent << "LevelOfDetailArchiveFileName: " << m_LevelOfDetailArchiveFileName << std::endl;
+  os << indent << "WriteSpatialChunks: " << (m_WriteSpatialChunks ? "On" : "Off") << std::endl;
+  os << indent << "MaximumFacesPerSpatialChunk: " << m_MaximumFacesPerSpatialChunk << std::endl;
+  os << indent << "SplitQuadsAlongShortestDiagonal: " << (m_SplitQuadsAlongShortestDiagonal ? "On" : "Off")
+     << std::endl;
+  os << indent << "WriteScalarsOnly: " << (m_WriteScalarsOnly ? "On" : "Off") << std::endl;
+  os << indent << "PointDataFileName: " << m_PointDataFileName << std::endl;
+  os << indent << "BuildSpatialIndex: " << (m_BuildSpatialIndex ? "On" : "Off") << std::endl;
+  os << indent << "SpatialIndexFileName: " << m_SpatialIndexFileName << std::endl;
+  os << indent << "SpatialIndex: " << m_SpatialIndex.GetPointer() << std::endl;
+  os << indent << "ComputeNormalsAndAreas: " << (m_ComputeNormalsAndAreas ? "On" : "Off") << std::endl;
+  os << indent << "ComputeAdjacency: " << (m_ComputeAdjacency ? "On" : "Off") << std::endl;
+  os << indent << "UseGeometryCache: " << (m_UseGeometryCache ? "On" : "Off") << std::endl;
+  os << indent << "LowMemoryReading: " << (m_LowMemoryReading ? "On" : "Off") << std::endl;
+  os << indent << "MemoryPlacement: " << m_MemoryPlacement << std::endl;
+  os << indent << "UseHugePages: " << (m_UseHugePages ? "On" : "Off") << std::endl;
+  os << indent << "DecompressedCacheDirectory: " << m_DecompressedCacheDirectory << std::endl;
+  os << indent << "DecompressedCacheMaximumSize: " << m_DecompressedCacheMaximumSize << std::endl;
 }
 } // namespace itk
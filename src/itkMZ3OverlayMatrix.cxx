@@ -0,0 +1,256 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkMZ3OverlayMatrix.h"
+
+#include "itkMacro.h"
+#include "itkMultiThreaderBase.h"
+#include "itk_zlib.h"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <type_traits>
+
+namespace itk
+{
+namespace
+{
+constexpr SizeValueType ConversionBlockSize = 4096;
+
+/** An MZ3 overlay, raw or gzip compressed, read through zlib, which passes raw files through and
+ * seeks in them. */
+class OverlayFile
+{
+public:
+  explicit OverlayFile(const std::string & fileName)
+    : m_FileName(fileName)
+    , m_File(gzopen(fileName.c_str(), "rb"))
+  {
+    if (m_File == nullptr)
+    {
+      itkGenericExceptionMacro("File cannot be read: " << fileName);
+    }
+    gzbuffer(m_File, 1 << 20);
+    uint8_t  header[16];
+    uint16_t magic = 0;
+    if (this->Read(header, sizeof(header)) == sizeof(header))
+    {
+      std::memcpy(&magic, header, sizeof(magic));
+      std::memcpy(&m_Attributes, header + 2, sizeof(m_Attributes));
+      std::memcpy(&m_NumberOfFaces, header + 4, sizeof(m_NumberOfFaces));
+      std::memcpy(&m_NumberOfVertices, header + 8, sizeof(m_NumberOfVertices));
+      std::memcpy(&m_Skip, header + 12, sizeof(m_Skip));
+    }
+    if (magic != 0x5A4D)
+    {
+      gzclose(m_File);
+      itkGenericExceptionMacro("Not an MZ3 file: " << fileName);
+    }
+    if ((m_Attributes & 24) == 0)
+    {
+      gzclose(m_File);
+      itkGenericExceptionMacro("The MZ3 file holds no scalars: " << fileName);
+    }
+  }
+
+  ~OverlayFile() { gzclose(m_File); }
+
+  OverlayFile(const OverlayFile &) = delete;
+  OverlayFile &
+  operator=(const OverlayFile &) = delete;
+
+  SizeValueType
+  GetNumberOfVertices() const
+  {
+    return m_NumberOfVertices;
+  }
+
+  /** Read layer of the scalars into values, converted to T. */
+  template <typename T>
+  void
+  ReadLayer(SizeValueType layer, T * values)
+  {
+    // Sections follow the header in the order skip, faces, vertices, colors and scalars
+    const SizeValueType numberOfVertices = m_NumberOfVertices;
+    SizeValueType       offset = 16 + SizeValueType{ m_Skip };
+    offset += (m_Attributes & 1) ? SizeValueType{ m_NumberOfFaces } * 12 : 0;
+    offset += (m_Attributes & 2) ? numberOfVertices * 12 : 0;
+    offset += (m_Attributes & 4) ? numberOfVertices * 4 : 0;
+    const bool isDouble = (m_Attributes & 16) != 0;
+    offset += layer * numberOfVertices * (isDouble ? sizeof(double) : sizeof(float));
+    if (gzseek(m_File, static_cast<z_off_t>(offset), SEEK_SET) != static_cast<z_off_t>(offset))
+    {
+      itkGenericExceptionMacro("The MZ3 file has no scalar layer " << layer << ": " << m_FileName);
+    }
+    const bool isRead = isDouble ? this->ReadConverted<double>(values, numberOfVertices)
+                                 : this->ReadConverted<float>(values, numberOfVertices);
+    if (!isRead)
+    {
+      itkGenericExceptionMacro("The MZ3 file has no scalar layer " << layer << ": " << m_FileName);
+    }
+  }
+
+private:
+  SizeValueType
+  Read(void * buffer, SizeValueType numberOfBytes)
+  {
+    SizeValueType bytesRead = 0;
+    while (bytesRead < numberOfBytes)
+    {
+      const auto request = static_cast<unsigned int>(std::min<SizeValueType>(numberOfBytes - bytesRead, 1u << 30));
+      const int  result = gzread(m_File, static_cast<uint8_t *>(buffer) + bytesRead, request);
+      if (result <= 0)
+      {
+        break;
+      }
+      bytesRead += static_cast<SizeValueType>(result);
+    }
+    return bytesRead;
+  }
+
+  /** Read count values of type TFile into values, directly if the types match and through a
+   * small block otherwise. */
+  template <typename TFile, typename T>
+  bool
+  ReadConverted(T * values, SizeValueType count)
+  {
+    if (std::is_same<TFile, T>::value)
+    {
+      return this->Read(values, count * sizeof(T)) == count * sizeof(T);
+    }
+    TFile block[ConversionBlockSize];
+    for (SizeValueType begin = 0; begin < count; begin += ConversionBlockSize)
+    {
+      const SizeValueType blockCount = std::min(ConversionBlockSize, count - begin);
+      if (this->Read(block, blockCount * sizeof(TFile)) != blockCount * sizeof(TFile))
+      {
+        return false;
+      }
+      std::transform(block, block + blockCount, values + begin, [](TFile value) { return static_cast<T>(value); });
+    }
+    return true;
+  }
+
+  std::string m_FileName;
+  gzFile      m_File;
+  uint16_t    m_Attributes{ 0 };
+  uint32_t    m_NumberOfFaces{ 0 };
+  uint32_t    m_NumberOfVertices{ 0 };
+  uint32_t    m_Skip{ 0 };
+};
+
+/** Call read(index) for every path concurrently, and rethrow the first exception once the work
+ * units have finished. */
+template <typename TRead>
+void
+ForEachPath(const std::vector<std::string> & paths, const MZ3OverlayMatrixOptions & options, const TRead & read)
+{
+  const SizeValueType numberOfPaths = paths.size();
+  if (numberOfPaths == 0)
+  {
+    return;
+  }
+  const unsigned int numberOfWorkUnits =
+    options.NumberOfWorkUnits == 0 ? MultiThreaderBase::GetGlobalDefaultNumberOfThreads() : options.NumberOfWorkUnits;
+  std::mutex         mutex;
+  std::exception_ptr firstException;
+
+  const auto multiThreader = MultiThreaderBase::New();
+  multiThreader->SetNumberOfWorkUnits(
+    static_cast<unsigned int>(std::min<SizeValueType>(numberOfWorkUnits, numberOfPaths)));
+  multiThreader->ParallelizeArray(
+    0,
+    numberOfPaths,
+    [&](SizeValueType index) {
+      try
+      {
+        read(index);
+      }
+      catch (...)
+      {
+        const std::lock_guard<std::mutex> lock(mutex);
+        if (!firstException)
+        {
+          firstException = std::current_exception();
+        }
+      }
+    },
+    nullptr);
+  if (firstException)
+  {
+    std::rethrow_exception(firstException);
+  }
+}
+
+template <typename T>
+void
+ReadOverlays(const std::vector<std::string> & paths,
+             SizeValueType                    numberOfVertices,
+             T *                              matrix,
+             const MZ3OverlayMatrixOptions &  options)
+{
+  ForEachPath(paths, options, [&](SizeValueType index) {
+    OverlayFile file(paths[index]);
+    if (file.GetNumberOfVertices() != numberOfVertices)
+    {
+      itkGenericExceptionMacro("The MZ3 file has " << file.GetNumberOfVertices() << " vertices instead of "
+                                                   << numberOfVertices << ": " << paths[index]);
+    }
+    file.ReadLayer(options.Layer, matrix + index * numberOfVertices);
+  });
+}
+} // namespace
+
+SizeValueType
+ReadMZ3OverlayNumberOfVertices(const std::vector<std::string> & paths, const MZ3OverlayMatrixOptions & options)
+{
+  std::vector<SizeValueType> numberOfVertices(paths.size());
+  ForEachPath(paths, options, [&](SizeValueType index) {
+    numberOfVertices[index] = OverlayFile(paths[index]).GetNumberOfVertices();
+  });
+  for (SizeValueType index = 1; index < paths.size(); ++index)
+  {
+    if (numberOfVertices[index] != numberOfVertices[0])
+    {
+      itkGenericExceptionMacro("The MZ3 file has " << numberOfVertices[index] << " vertices instead of "
+                                                   << numberOfVertices[0] << ": " << paths[index]);
+    }
+  }
+  return numberOfVertices.empty() ? 0 : numberOfVertices[0];
+}
+
+void
+ReadMZ3OverlayMatrix(const std::vector<std::string> & paths,
+                     SizeValueType                    numberOfVertices,
+                     float *                          matrix,
+                     const MZ3OverlayMatrixOptions &  options)
+{
+  ReadOverlays(paths, numberOfVertices, matrix, options);
+}
+
+void
+ReadMZ3OverlayMatrix(const std::vector<std::string> & paths,
+                     SizeValueType                    numberOfVertices,
+                     double *                         matrix,
+                     const MZ3OverlayMatrixOptions &  options)
+{
+  ReadOverlays(paths, numberOfVertices, matrix, options);
+}
+} // end namespace itk
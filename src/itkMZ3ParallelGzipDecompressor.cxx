@@ -0,0 +1,893 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkMZ3ParallelGzipDecompressor.h"
+
+#include "itkMultiThreaderBase.h"
+#include "itk_zlib.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <memory>
+
+namespace itk
+{
+namespace
+{
+constexpr unsigned int WindowSize = 32768;
+constexpr unsigned int FastBits = 10;
+constexpr uint64_t     NoLimit = std::numeric_limits<uint64_t>::max();
+
+const uint16_t LengthBase[29] = { 3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                  31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const uint8_t  LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const uint16_t DistanceBase[30] = { 1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                    193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const uint8_t  DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+const uint8_t  CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+/** Random access, least significant bit first, view of the compressed bytes. Reads past the
+ * end return zero bits; callers compare the bit position with GetSizeInBits(). */
+class BitStream
+{
+public:
+  BitStream(const uint8_t * data, uint64_t size)
+    : m_Data(data)
+    , m_Size(size)
+  {}
+
+  uint64_t
+  Peek(uint64_t bit) const
+  {
+    const uint64_t byte = bit >> 3;
+    uint64_t       value = 0;
+    if (byte + 8 <= m_Size)
+    {
+      std::memcpy(&value, m_Data + byte, 8);
+    }
+    else
+    {
+      for (uint64_t ii = 0; byte + ii < m_Size && ii < 8; ++ii)
+      {
+        value |= static_cast<uint64_t>(m_Data[byte + ii]) << (8 * ii);
+      }
+    }
+    return value >> (bit & 7);
+  }
+
+  /** Read count (at most 32) bits and advance bit. */
+  uint32_t
+  Get(uint64_t & bit, unsigned int count) const
+  {
+    const auto value = static_cast<uint32_t>(this->Peek(bit) & ((uint64_t{ 1 } << count) - 1));
+    bit += count;
+    return value;
+  }
+
+  const uint8_t *
+  GetData() const
+  {
+    return m_Data;
+  }
+
+  uint64_t
+  GetSize() const
+  {
+    return m_Size;
+  }
+
+  uint64_t
+  GetSizeInBits() const
+  {
+    return m_Size * 8;
+  }
+
+private:
+  const uint8_t * m_Data;
+  uint64_t        m_Size;
+};
+
+/** Canonical Huffman code with a single level lookup table for short codes and a bit by bit
+ * fallback for longer codes. */
+class HuffmanCode
+{
+public:
+  /** Returns false if the code lengths do not describe a valid deflate code. */
+  bool
+  Build(const uint8_t * lengths, unsigned int numberOfSymbols, bool isCodeLengthCode)
+  {
+    std::fill(std::begin(m_Count), std::end(m_Count), uint16_t{ 0 });
+    for (unsigned int ii = 0; ii < numberOfSymbols; ++ii)
+    {
+      ++m_Count[lengths[ii]];
+    }
+    m_Empty = m_Count[0] == numberOfSymbols;
+    if (m_Empty)
+    {
+      std::fill(std::begin(m_Fast), std::end(m_Fast), uint16_t{ 0 });
+      return !isCodeLengthCode;
+    }
+
+    int          left = 1;
+    unsigned int maximumLength = 0;
+    for (unsigned int len = 1; len < 16; ++len)
+    {
+      left <<= 1;
+      left -= m_Count[len];
+      if (left < 0)
+      {
+        return false;
+      }
+      if (m_Count[len] != 0)
+      {
+        maximumLength = len;
+      }
+    }
+    // Like zlib, only a single code of length one may leave the code incomplete.
+    if (left > 0 && (isCodeLengthCode || maximumLength != 1))
+    {
+      return false;
+    }
+
+    std::fill(std::begin(m_Fast), std::end(m_Fast), uint16_t{ 0 });
+    uint16_t offsets[16];
+    offsets[1] = 0;
+    for (unsigned int len = 1; len < 15; ++len)
+    {
+      offsets[len + 1] = offsets[len] + m_Count[len];
+    }
+    for (unsigned int ii = 0; ii < numberOfSymbols; ++ii)
+    {
+      if (lengths[ii] != 0)
+      {
+        m_Symbol[offsets[lengths[ii]]++] = static_cast<uint16_t>(ii);
+      }
+    }
+
+    unsigned int code = 0;
+    unsigned int index = 0;
+    for (unsigned int len = 1; len <= FastBits; ++len)
+    {
+      for (unsigned int kk = 0; kk < m_Count[len]; ++kk)
+      {
+        unsigned int reversed = 0;
+        for (unsigned int bb = 0; bb < len; ++bb)
+        {
+          reversed |= ((code >> bb) & 1) << (len - 1 - bb);
+        }
+        const auto entry = static_cast<uint16_t>((m_Symbol[index] << 4) | len);
+        for (unsigned int ee = reversed; ee < (1u << FastBits); ee += (1u << len))
+        {
+          m_Fast[ee] = entry;
+        }
+        ++index;
+        ++code;
+      }
+      code <<= 1;
+    }
+    return true;
+  }
+
+  /** Returns the decoded symbol, or -1 for an invalid code. */
+  int
+  Decode(const BitStream & stream, uint64_t & bit) const
+  {
+    const uint64_t bits = stream.Peek(bit);
+    const uint16_t entry = m_Fast[bits & ((1u << FastBits) - 1)];
+    if (entry != 0)
+    {
+      bit += entry & 15;
+      return entry >> 4;
+    }
+    if (m_Empty)
+    {
+      return -1;
+    }
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (unsigned int len = 1; len < 16; ++len)
+    {
+      code |= static_cast<int>((bits >> (len - 1)) & 1);
+      const int count = m_Count[len];
+      if (code - count < first)
+      {
+        bit += len;
+        return m_Symbol[index + (code - first)];
+      }
+      index += count;
+      first += count;
+      first <<= 1;
+      code <<= 1;
+    }
+    return -1;
+  }
+
+private:
+  uint16_t m_Count[16];
+  uint16_t m_Symbol[288];
+  uint16_t m_Fast[1u << FastBits];
+  bool     m_Empty{ true };
+};
+
+struct FixedHuffmanCodes
+{
+  FixedHuffmanCodes()
+  {
+    uint8_t lengths[288];
+    std::fill(lengths, lengths + 144, uint8_t{ 8 });
+    std::fill(lengths + 144, lengths + 256, uint8_t{ 9 });
+    std::fill(lengths + 256, lengths + 280, uint8_t{ 7 });
+    std::fill(lengths + 280, lengths + 288, uint8_t{ 8 });
+    m_LiteralLength.Build(lengths, 288, false);
+    // Distance codes 30 and 31 complete the code but never occur in valid data.
+    std::fill(lengths, lengths + 32, uint8_t{ 5 });
+    m_Distance.Build(lengths, 32, false);
+  }
+
+  HuffmanCode m_LiteralLength;
+  HuffmanCode m_Distance;
+};
+
+const FixedHuffmanCodes &
+GetFixedHuffmanCodes()
+{
+  static const FixedHuffmanCodes codes;
+  return codes;
+}
+
+/** Decodes deflate blocks starting at a given bit offset. Output symbols below 256 are
+ * literal bytes; a symbol of 256 + w is a placeholder for byte w of the 32 KiB window that
+ * precedes the start of the decoder, which is unknown while decoding. */
+class ChunkDecoder
+{
+public:
+  ChunkDecoder(uint64_t startBit, bool windowIsEmpty)
+    : m_StartBit(startBit)
+    , m_Bit(startBit)
+    , m_WindowIsEmpty(windowIsEmpty)
+  {}
+
+  /** Restart decoding at startBit, keeping the allocated output storage. */
+  void
+  Restart(uint64_t startBit)
+  {
+    m_StartBit = startBit;
+    m_Bit = startBit;
+    m_ReachedFinalBlock = false;
+    m_OutputSize = 0;
+  }
+
+  /** Decode blocks until the next block would start at or after limitBit, or the final
+   * block has been decoded. */
+  bool
+  DecodeUntil(const BitStream & stream, uint64_t limitBit)
+  {
+    while (!m_ReachedFinalBlock && m_Bit < limitBit)
+    {
+      if (!this->DecodeBlock(stream))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool
+  DecodeBlock(const BitStream & stream)
+  {
+    const uint32_t header = stream.Get(m_Bit, 3);
+    const bool     isFinal = (header & 1) != 0;
+    bool           success = false;
+    switch (header >> 1)
+    {
+      case 0:
+        success = this->DecodeStoredBlock(stream);
+        break;
+      case 1:
+      {
+        const auto & fixed = GetFixedHuffmanCodes();
+        success = this->DecodeHuffmanBlock(stream, fixed.m_LiteralLength, fixed.m_Distance);
+        break;
+      }
+      case 2:
+        success = this->ReadDynamicCodes(stream) && this->DecodeHuffmanBlock(stream, m_LiteralLength, m_Distance);
+        break;
+      default:
+        break;
+    }
+    if (!success || m_Bit > stream.GetSizeInBits())
+    {
+      return false;
+    }
+    m_ReachedFinalBlock = isFinal;
+    return true;
+  }
+
+  uint64_t
+  GetStartBit() const
+  {
+    return m_StartBit;
+  }
+
+  uint64_t
+  GetBit() const
+  {
+    return m_Bit;
+  }
+
+  bool
+  GetReachedFinalBlock() const
+  {
+    return m_ReachedFinalBlock;
+  }
+
+  const uint16_t *
+  GetOutput() const
+  {
+    return m_Output.data();
+  }
+
+  SizeValueType
+  GetOutputSize() const
+  {
+    return m_OutputSize;
+  }
+
+private:
+  void
+  Reserve(SizeValueType additional)
+  {
+    if (m_OutputSize + additional > m_Output.size())
+    {
+      m_Output.resize(std::max<SizeValueType>(2 * m_Output.size(), m_OutputSize + additional + 65536));
+    }
+  }
+
+  bool
+  DecodeStoredBlock(const BitStream & stream)
+  {
+    m_Bit = (m_Bit + 7) & ~uint64_t{ 7 };
+    const uint64_t byte = m_Bit >> 3;
+    if (byte + 4 > stream.GetSize())
+    {
+      return false;
+    }
+    const uint8_t * data = stream.GetData() + byte;
+    const auto      length = static_cast<unsigned int>(data[0] | (data[1] << 8));
+    const auto      complement = static_cast<unsigned int>(data[2] | (data[3] << 8));
+    if (length != (~complement & 0xFFFF) || byte + 4 + length > stream.GetSize())
+    {
+      return false;
+    }
+    this->Reserve(length);
+    std::copy(data + 4, data + 4 + length, m_Output.data() + m_OutputSize);
+    m_OutputSize += length;
+    m_Bit += (4 + static_cast<uint64_t>(length)) * 8;
+    return true;
+  }
+
+  bool
+  ReadDynamicCodes(const BitStream & stream)
+  {
+    const unsigned int numberOfLiteralLengthCodes = stream.Get(m_Bit, 5) + 257;
+    const unsigned int numberOfDistanceCodes = stream.Get(m_Bit, 5) + 1;
+    const unsigned int numberOfCodeLengthCodes = stream.Get(m_Bit, 4) + 4;
+    if (numberOfLiteralLengthCodes > 286 || numberOfDistanceCodes > 30)
+    {
+      return false;
+    }
+
+    uint8_t lengths[320] = {};
+    for (unsigned int ii = 0; ii < numberOfCodeLengthCodes; ++ii)
+    {
+      lengths[CodeLengthOrder[ii]] = static_cast<uint8_t>(stream.Get(m_Bit, 3));
+    }
+    HuffmanCode codeLengthCode;
+    if (!codeLengthCode.Build(lengths, 19, true))
+    {
+      return false;
+    }
+
+    const unsigned int total = numberOfLiteralLengthCodes + numberOfDistanceCodes;
+    unsigned int       index = 0;
+    while (index < total)
+    {
+      const int symbol = codeLengthCode.Decode(stream, m_Bit);
+      if (symbol < 0)
+      {
+        return false;
+      }
+      if (symbol < 16)
+      {
+        lengths[index++] = static_cast<uint8_t>(symbol);
+        continue;
+      }
+      uint8_t      length = 0;
+      unsigned int repeat = 0;
+      if (symbol == 16)
+      {
+        if (index == 0)
+        {
+          return false;
+        }
+        length = lengths[index - 1];
+        repeat = 3 + stream.Get(m_Bit, 2);
+      }
+      else if (symbol == 17)
+      {
+        repeat = 3 + stream.Get(m_Bit, 3);
+      }
+      else
+      {
+        repeat = 11 + stream.Get(m_Bit, 7);
+      }
+      if (index + repeat > total)
+      {
+        return false;
+      }
+      std::fill(lengths + index, lengths + index + repeat, length);
+      index += repeat;
+    }
+
+    // The end of block code is required.
+    if (lengths[256] == 0)
+    {
+      return false;
+    }
+    return m_LiteralLength.Build(lengths, numberOfLiteralLengthCodes, false) &&
+           m_Distance.Build(lengths + numberOfLiteralLengthCodes, numberOfDistanceCodes, false);
+  }
+
+  bool
+  DecodeHuffmanBlock(const BitStream & stream, const HuffmanCode & literalLength, const HuffmanCode & distance)
+  {
+    const uint64_t sizeInBits = stream.GetSizeInBits();
+    for (;;)
+    {
+      if (m_Bit > sizeInBits)
+      {
+        return false;
+      }
+      this->Reserve(258);
+      int symbol = literalLength.Decode(stream, m_Bit);
+      if (symbol < 0)
+      {
+        return false;
+      }
+      if (symbol < 256)
+      {
+        m_Output[m_OutputSize++] = static_cast<uint16_t>(symbol);
+        continue;
+      }
+      if (symbol == 256)
+      {
+        return true;
+      }
+      symbol -= 257;
+      if (symbol >= 29)
+      {
+        return false;
+      }
+      const unsigned int length = LengthBase[symbol] + stream.Get(m_Bit, LengthExtra[symbol]);
+      symbol = distance.Decode(stream, m_Bit);
+      if (symbol < 0 || symbol >= 30)
+      {
+        return false;
+      }
+      const SizeValueType dist = DistanceBase[symbol] + stream.Get(m_Bit, DistanceExtra[symbol]);
+
+      uint16_t * output = m_Output.data() + m_OutputSize;
+      if (dist <= m_OutputSize)
+      {
+        const uint16_t * source = output - dist;
+        for (unsigned int ii = 0; ii < length; ++ii)
+        {
+          output[ii] = source[ii];
+        }
+      }
+      else
+      {
+        if (m_WindowIsEmpty || dist > m_OutputSize + WindowSize)
+        {
+          return false;
+        }
+        // Position of the first copied byte relative to the start of the decoder.
+        auto position = static_cast<int64_t>(m_OutputSize) - static_cast<int64_t>(dist);
+        for (unsigned int ii = 0; ii < length; ++ii, ++position)
+        {
+          output[ii] = position < 0 ? static_cast<uint16_t>(256 + WindowSize + position)
+                                    : m_Output[static_cast<SizeValueType>(position)];
+        }
+      }
+      m_OutputSize += length;
+    }
+  }
+
+  uint64_t              m_StartBit;
+  uint64_t              m_Bit;
+  bool                  m_WindowIsEmpty;
+  bool                  m_ReachedFinalBlock{ false };
+  std::vector<uint16_t> m_Output;
+  SizeValueType         m_OutputSize{ 0 };
+  HuffmanCode           m_LiteralLength;
+  HuffmanCode           m_Distance;
+};
+
+/** Quick test used while searching for block boundaries: returns true if a dynamic block
+ * header at bit has a complete code length code, which almost all random positions lack. */
+bool
+HasCompleteCodeLengthCode(const BitStream & stream, uint64_t bit)
+{
+  const auto numberOfCodeLengthCodes = static_cast<unsigned int>((stream.Peek(bit + 13) & 15) + 4);
+  uint64_t   lengths = stream.Peek(bit + 17);
+  unsigned int kraftSum = 0;
+  for (unsigned int ii = 0; ii < numberOfCodeLengthCodes; ++ii, lengths >>= 3)
+  {
+    const auto length = static_cast<unsigned int>(lengths & 7);
+    if (length != 0)
+    {
+      kraftSum += 128u >> length;
+    }
+  }
+  return kraftSum == 128;
+}
+
+/** Returns the offset of the deflate data of the gzip member at offset, or zero if there
+ * is no valid gzip header there. */
+uint64_t
+SkipGzipHeader(const uint8_t * data, uint64_t size, uint64_t offset)
+{
+  if (offset + 18 > size || data[offset] != 0x1F || data[offset + 1] != 0x8B || data[offset + 2] != 8)
+  {
+    return 0;
+  }
+  const uint8_t flags = data[offset + 3];
+  uint64_t      position = offset + 10;
+  if (flags & 4)
+  {
+    if (position + 2 > size)
+    {
+      return 0;
+    }
+    position += 2 + (data[position] | (data[position + 1] << 8));
+  }
+  for (const uint8_t zeroTerminatedField : { uint8_t{ 8 }, uint8_t{ 16 } })
+  {
+    if (flags & zeroTerminatedField)
+    {
+      while (position < size && data[position] != 0)
+      {
+        ++position;
+      }
+      ++position;
+    }
+  }
+  if (flags & 2)
+  {
+    position += 2;
+  }
+  return position < size ? position : 0;
+}
+
+uint32_t
+ReadLittleEndian32(const uint8_t * data)
+{
+  return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+         (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+struct GzipMember
+{
+  SizeValueType m_OutputBegin;
+  SizeValueType m_OutputEnd;
+  uint32_t      m_Crc;
+  uint32_t      m_Size;
+};
+} // namespace
+
+void
+MZ3ParallelGzipDecompressor::Decompress(const void * data, SizeValueType size, std::vector<uint8_t> & output) const
+{
+  const auto bytes = static_cast<const uint8_t *>(data);
+  if (SkipGzipHeader(bytes, size, 0) == 0)
+  {
+    itkExceptionMacro("Data does not start with a valid gzip header");
+  }
+
+  const unsigned int numberOfWorkUnits =
+    m_NumberOfWorkUnits > 0 ? m_NumberOfWorkUnits : MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+  if (numberOfWorkUnits < 2 || m_ChunkSize == 0 || size < 2 * m_ChunkSize)
+  {
+    this->DecompressWithZlib(bytes, size, output);
+  }
+  else
+  {
+    this->DecompressInParallel(bytes, size, output);
+  }
+}
+
+void
+MZ3ParallelGzipDecompressor::DecompressWithZlib(const uint8_t * data, SizeValueType size, std::vector<uint8_t> & output) const
+{
+  // The trailer of the last member holds its uncompressed size modulo 2^32, which is exact
+  // for the common case of a single member smaller than 4 GiB.
+  output.resize(std::max<SizeValueType>(ReadLittleEndian32(data + size - 4), 1024));
+
+  z_stream stream{};
+  if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+  {
+    itkExceptionMacro("Could not initialize zlib");
+  }
+  SizeValueType inputOffset = 0;
+  SizeValueType outputSize = 0;
+  for (;;)
+  {
+    constexpr SizeValueType maximumStep = std::numeric_limits<uInt>::max();
+    if (outputSize == output.size())
+    {
+      output.resize(2 * output.size());
+    }
+    stream.next_in = const_cast<Bytef *>(data + inputOffset);
+    stream.avail_in = static_cast<uInt>(std::min(size - inputOffset, maximumStep));
+    stream.next_out = output.data() + outputSize;
+    stream.avail_out = static_cast<uInt>(std::min(output.size() - outputSize, maximumStep));
+    const uInt availableIn = stream.avail_in;
+    const uInt availableOut = stream.avail_out;
+    const int  status = inflate(&stream, Z_NO_FLUSH);
+    inputOffset += availableIn - stream.avail_in;
+    outputSize += availableOut - stream.avail_out;
+    if (status == Z_STREAM_END)
+    {
+      // Continue with the next member, if any.
+      if (inputOffset + 2 > size || data[inputOffset] != 0x1F || data[inputOffset + 1] != 0x8B)
+      {
+        break;
+      }
+      inflateReset(&stream);
+    }
+    else if (status != Z_OK && status != Z_BUF_ERROR)
+    {
+      inflateEnd(&stream);
+      itkExceptionMacro("Invalid gzip data: " << (stream.msg ? stream.msg : "unknown error"));
+    }
+    else if (status == Z_BUF_ERROR && availableIn == 0)
+    {
+      inflateEnd(&stream);
+      itkExceptionMacro("Truncated gzip data");
+    }
+  }
+  inflateEnd(&stream);
+  output.resize(outputSize);
+}
+
+void
+MZ3ParallelGzipDecompressor::DecompressInParallel(const uint8_t *        data,
+                                                  SizeValueType          size,
+                                                  std::vector<uint8_t> & output) const
+{
+  const BitStream stream(data, size);
+  const uint64_t  firstBlockBit = SkipGzipHeader(data, size, 0) * 8;
+
+  // Chunk boundaries, in bits. Chunk ii covers [chunkBegin[ii], chunkBegin[ii + 1]).
+  std::vector<uint64_t> chunkBegin;
+  for (uint64_t bit = firstBlockBit; bit < stream.GetSizeInBits(); bit += m_ChunkSize * 8)
+  {
+    chunkBegin.push_back(bit);
+  }
+  const auto numberOfChunks = static_cast<SizeValueType>(chunkBegin.size());
+  chunkBegin.push_back(NoLimit);
+
+  // Speculatively decode every chunk from the first position in it that decodes as a
+  // dynamic Huffman block, up to the first block boundary in the next chunk.
+  std::vector<std::unique_ptr<ChunkDecoder>> chunks(numberOfChunks);
+  const auto                                 multiThreader = MultiThreaderBase::New();
+  multiThreader->SetNumberOfWorkUnits(
+    m_NumberOfWorkUnits > 0 ? m_NumberOfWorkUnits : MultiThreaderBase::GetGlobalDefaultNumberOfThreads());
+  multiThreader->ParallelizeArray(
+    0,
+    numberOfChunks,
+    [&](SizeValueType chunk) {
+      const uint64_t limit = chunkBegin[chunk + 1];
+      if (chunk == 0)
+      {
+        auto decoder = std::make_unique<ChunkDecoder>(firstBlockBit, true);
+        if (decoder->DecodeUntil(stream, limit))
+        {
+          chunks[chunk] = std::move(decoder);
+        }
+        return;
+      }
+      const uint64_t searchEnd = std::min(limit, stream.GetSizeInBits());
+      auto           decoder = std::make_unique<ChunkDecoder>(chunkBegin[chunk], false);
+      for (uint64_t bit = chunkBegin[chunk]; bit < searchEnd; ++bit)
+      {
+        // Non-final block with dynamic codes, and in range literal/length and distance counts.
+        const uint64_t header = stream.Peek(bit);
+        if ((header & 7) != 4 || ((header >> 3) & 31) > 29 || ((header >> 8) & 31) > 29 ||
+            !HasCompleteCodeLengthCode(stream, bit))
+        {
+          continue;
+        }
+        decoder->Restart(bit);
+        if (decoder->DecodeUntil(stream, limit))
+        {
+          chunks[chunk] = std::move(decoder);
+          return;
+        }
+      }
+    },
+    nullptr);
+
+  // Walk the chunks in order. A speculatively decoded chunk is used only if it starts exactly
+  // where the preceding one ended; otherwise the preceding decoder continues sequentially.
+  std::vector<std::unique_ptr<ChunkDecoder>> segments;
+  std::vector<GzipMember>                    members;
+  SizeValueType                              memberBegin = 0;
+  SizeValueType                              decodedSize = 0;
+  std::unique_ptr<ChunkDecoder>              current = std::move(chunks[0]);
+  if (!current)
+  {
+    itkExceptionMacro("Invalid deflate data");
+  }
+  SizeValueType next = 1;
+  for (;;)
+  {
+    if (current->GetReachedFinalBlock())
+    {
+      const uint64_t trailer = (current->GetBit() + 7) / 8;
+      if (trailer + 8 > size)
+      {
+        itkExceptionMacro("Truncated gzip data");
+      }
+      decodedSize += current->GetOutputSize();
+      members.push_back({ memberBegin, decodedSize, ReadLittleEndian32(data + trailer), ReadLittleEndian32(data + trailer + 4) });
+      memberBegin = decodedSize;
+      segments.push_back(std::move(current));
+
+      const uint64_t nextMember = SkipGzipHeader(data, size, trailer + 8);
+      if (nextMember == 0)
+      {
+        break;
+      }
+      current = std::make_unique<ChunkDecoder>(nextMember * 8, true);
+      while (next < numberOfChunks && chunkBegin[next] < nextMember * 8)
+      {
+        ++next;
+      }
+      if (!current->DecodeUntil(stream, chunkBegin[next]))
+      {
+        itkExceptionMacro("Invalid deflate data");
+      }
+      continue;
+    }
+    if (next < numberOfChunks && chunks[next] && chunks[next]->GetStartBit() == current->GetBit())
+    {
+      decodedSize += current->GetOutputSize();
+      segments.push_back(std::move(current));
+      current = std::move(chunks[next]);
+      ++next;
+      continue;
+    }
+    if (next < numberOfChunks)
+    {
+      ++next;
+    }
+    if (!current->DecodeUntil(stream, chunkBegin[next]))
+    {
+      itkExceptionMacro("Invalid deflate data");
+    }
+  }
+  chunks.clear();
+
+  // Resolve the window of every segment in order. Only the last 32 KiB of a segment can be
+  // referenced by the following segments.
+  const auto                        numberOfSegments = static_cast<SizeValueType>(segments.size());
+  std::vector<std::vector<uint8_t>> windows(numberOfSegments, std::vector<uint8_t>(WindowSize, 0));
+  std::vector<SizeValueType>        segmentBegin(numberOfSegments + 1, 0);
+  for (SizeValueType segment = 0; segment < numberOfSegments; ++segment)
+  {
+    const uint16_t *    symbols = segments[segment]->GetOutput();
+    const SizeValueType count = segments[segment]->GetOutputSize();
+    segmentBegin[segment + 1] = segmentBegin[segment] + count;
+    if (segment + 1 == numberOfSegments)
+    {
+      break;
+    }
+    const std::vector<uint8_t> & window = windows[segment];
+    std::vector<uint8_t> &       nextWindow = windows[segment + 1];
+    const SizeValueType          tail = std::min<SizeValueType>(count, WindowSize);
+    std::copy(window.begin() + tail, window.end(), nextWindow.begin());
+    for (SizeValueType ii = 0; ii < tail; ++ii)
+    {
+      const uint16_t symbol = symbols[count - tail + ii];
+      nextWindow[WindowSize - tail + ii] = symbol < 256 ? static_cast<uint8_t>(symbol) : window[symbol - 256];
+    }
+  }
+
+  output.resize(segmentBegin[numberOfSegments]);
+  multiThreader->ParallelizeArray(
+    0,
+    numberOfSegments,
+    [&](SizeValueType segment) {
+      const uint16_t *             symbols = segments[segment]->GetOutput();
+      const std::vector<uint8_t> & window = windows[segment];
+      uint8_t *                    destination = output.data() + segmentBegin[segment];
+      const SizeValueType          count = segments[segment]->GetOutputSize();
+      for (SizeValueType ii = 0; ii < count; ++ii)
+      {
+        const uint16_t symbol = symbols[ii];
+        destination[ii] = symbol < 256 ? static_cast<uint8_t>(symbol) : window[symbol - 256];
+      }
+      segments[segment].reset();
+    },
+    nullptr);
+
+  // Verify the members, computing the CRC-32 of each in pieces and combining them.
+  for (const auto & member : members)
+  {
+    const SizeValueType memberSize = member.m_OutputEnd - member.m_OutputBegin;
+    if (static_cast<uint32_t>(memberSize) != member.m_Size)
+    {
+      itkExceptionMacro("Decompressed size does not match the gzip trailer");
+    }
+    const SizeValueType        numberOfPieces = std::max<SizeValueType>(1, memberSize / (1 << 20));
+    std::vector<uLong>         pieceCrc(numberOfPieces);
+    std::vector<SizeValueType> pieceBegin(numberOfPieces + 1);
+    for (SizeValueType piece = 0; piece <= numberOfPieces; ++piece)
+    {
+      pieceBegin[piece] = member.m_OutputBegin + memberSize * piece / numberOfPieces;
+    }
+    multiThreader->ParallelizeArray(
+      0,
+      numberOfPieces,
+      [&](SizeValueType piece) {
+        uLong               crc = crc32(0L, Z_NULL, 0);
+        SizeValueType       offset = pieceBegin[piece];
+        const SizeValueType end = pieceBegin[piece + 1];
+        while (offset < end)
+        {
+          const auto step = static_cast<uInt>(std::min<SizeValueType>(end - offset, 1 << 30));
+          crc = crc32(crc, output.data() + offset, step);
+          offset += step;
+        }
+        pieceCrc[piece] = crc;
+      },
+      nullptr);
+    uLong crc = pieceCrc[0];
+    for (SizeValueType piece = 1; piece < numberOfPieces; ++piece)
+    {
+      crc = crc32_combine(crc, pieceCrc[piece], static_cast<z_off_t>(pieceBegin[piece + 1] - pieceBegin[piece]));
+    }
+    if (static_cast<uint32_t>(crc) != member.m_Crc)
+    {
+      itkExceptionMacro("CRC-32 of the decompressed data does not match the gzip trailer");
+    }
+  }
+}
+
+void
+MZ3ParallelGzipDecompressor::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "NumberOfWorkUnits: " << m_NumberOfWorkUnits << std::endl;
+  os << indent << "ChunkSize: " << m_ChunkSize << std::endl;
+}
+} // namespace itk
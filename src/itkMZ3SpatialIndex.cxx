@@ -0,0 +1,667 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkMZ3SpatialIndex.h"
+
+#include "itkMultiThreaderBase.h"
+#include "itk_zlib.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <utility>
+
+namespace itk
+{
+namespace
+{
+constexpr SizeValueType LeafSize = 4;
+// Ranges smaller than this are built by a single work unit.
+constexpr SizeValueType MinimumTaskSize = 4096;
+constexpr char          FileSignature[4] = { 'M', 'Z', '3', 'T' };
+constexpr uint32_t      FileVersion = 1;
+
+/** Number of nodes of the hierarchy over count triangles, and over count + 1 triangles. Ranges
+ * are split into count / 2 and count - count / 2 triangles, so the sizes of the two halves of
+ * both ranges are count / 2 or count / 2 + 1. */
+std::pair<SizeValueType, SizeValueType>
+NumberOfFaceNodes(SizeValueType count)
+{
+  if (count <= LeafSize)
+  {
+    return { 1, count + 1 <= LeafSize ? 1 : 3 };
+  }
+  const auto half = NumberOfFaceNodes(count / 2);
+  if (count % 2 == 0)
+  {
+    return { 1 + 2 * half.first, 1 + half.first + half.second };
+  }
+  return { 1 + half.first + half.second, 1 + 2 * half.second };
+}
+
+float
+SquaredDistance(const float * a, const float * b)
+{
+  const float dx = a[0] - b[0];
+  const float dy = a[1] - b[1];
+  const float dz = a[2] - b[2];
+  return dx * dx + dy * dy + dz * dz;
+}
+
+float
+SquaredDistanceToBox(const float * point, const float * minimum, const float * maximum)
+{
+  float distance = 0.0f;
+  for (unsigned int axis = 0; axis < 3; ++axis)
+  {
+    const float below = minimum[axis] - point[axis];
+    const float above = point[axis] - maximum[axis];
+    const float outside = std::max(0.0f, std::max(below, above));
+    distance += outside * outside;
+  }
+  return distance;
+}
+
+/** Closest point to p on the triangle abc, after Ericson, Real-Time Collision Detection, 5.1.5. */
+void
+ClosestPointOnTriangle(const float * p, const float * a, const float * b, const float * c, float * closest)
+{
+  float ab[3];
+  float ac[3];
+  float ap[3];
+  for (unsigned int ii = 0; ii < 3; ++ii)
+  {
+    ab[ii] = b[ii] - a[ii];
+    ac[ii] = c[ii] - a[ii];
+    ap[ii] = p[ii] - a[ii];
+  }
+  const auto dot = [](const float * u, const float * v) { return u[0] * v[0] + u[1] * v[1] + u[2] * v[2]; };
+  const auto combine = [&](float v, float w) {
+    for (unsigned int ii = 0; ii < 3; ++ii)
+    {
+      closest[ii] = a[ii] + v * ab[ii] + w * ac[ii];
+    }
+  };
+
+  const float d1 = dot(ab, ap);
+  const float d2 = dot(ac, ap);
+  if (d1 <= 0.0f && d2 <= 0.0f)
+  {
+    return combine(0.0f, 0.0f);
+  }
+  float bp[3];
+  for (unsigned int ii = 0; ii < 3; ++ii)
+  {
+    bp[ii] = p[ii] - b[ii];
+  }
+  const float d3 = dot(ab, bp);
+  const float d4 = dot(ac, bp);
+  if (d3 >= 0.0f && d4 <= d3)
+  {
+    return combine(1.0f, 0.0f);
+  }
+  const float vc = d1 * d4 - d3 * d2;
+  if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+  {
+    return combine(d1 / (d1 - d3), 0.0f);
+  }
+  float cp[3];
+  for (unsigned int ii = 0; ii < 3; ++ii)
+  {
+    cp[ii] = p[ii] - c[ii];
+  }
+  const float d5 = dot(ab, cp);
+  const float d6 = dot(ac, cp);
+  if (d6 >= 0.0f && d5 <= d6)
+  {
+    return combine(0.0f, 1.0f);
+  }
+  const float vb = d5 * d2 - d1 * d6;
+  if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+  {
+    return combine(0.0f, d2 / (d2 - d6));
+  }
+  const float va = d3 * d6 - d5 * d4;
+  if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+  {
+    const float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    return combine(1.0f - w, w);
+  }
+  const float denominator = 1.0f / (va + vb + vc);
+  return combine(vb * denominator, vc * denominator);
+}
+
+template <typename T>
+void
+WriteArray(std::ofstream & file, const std::vector<T> & values)
+{
+  file.write(reinterpret_cast<const char *>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+template <typename T>
+bool
+ReadArray(std::ifstream & file, std::vector<T> & values, SizeValueType size)
+{
+  values.resize(size);
+  file.read(reinterpret_cast<char *>(values.data()), static_cast<std::streamsize>(size * sizeof(T)));
+  return static_cast<bool>(file);
+}
+} // namespace
+
+void
+MZ3SpatialIndex::SetGeometry(std::vector<float> && points, std::vector<uint32_t> && faces)
+{
+  const SizeValueType numberOfPoints = points.size() / 3;
+  const SizeValueType numberOfFaces = faces.size() / 3;
+  if (numberOfPoints > std::numeric_limits<uint32_t>::max() || numberOfFaces > std::numeric_limits<uint32_t>::max())
+  {
+    itkExceptionMacro("Too many points or faces for a spatial index");
+  }
+  for (SizeValueType ii = 0; ii < numberOfFaces * 3; ++ii)
+  {
+    if (faces[ii] >= numberOfPoints)
+    {
+      itkExceptionMacro("Face " << ii / 3 << " refers to point " << faces[ii] << " of " << numberOfPoints);
+    }
+  }
+  m_Points = std::move(points);
+  m_Faces = std::move(faces);
+  m_Points.resize(numberOfPoints * 3);
+  m_Faces.resize(numberOfFaces * 3);
+  this->Modified();
+}
+
+void
+MZ3SpatialIndex::Build(const float *    points,
+                       SizeValueType    numberOfPoints,
+                       const uint32_t * faces,
+                       SizeValueType    numberOfFaces)
+{
+  this->Build(std::vector<float>(points, points + numberOfPoints * 3),
+              std::vector<uint32_t>(faces, faces + numberOfFaces * 3));
+}
+
+void
+MZ3SpatialIndex::Build(std::vector<float> && points, std::vector<uint32_t> && faces)
+{
+  this->SetGeometry(std::move(points), std::move(faces));
+  const SizeValueType numberOfPoints = this->GetNumberOfPoints();
+  const SizeValueType numberOfFaces = this->GetNumberOfFaces();
+
+  m_PointOrder.resize(numberOfPoints);
+  for (SizeValueType ii = 0; ii < numberOfPoints; ++ii)
+  {
+    m_PointOrder[ii] = static_cast<uint32_t>(ii);
+  }
+  m_PointSplitAxis.assign(numberOfPoints, 0);
+
+  std::vector<float> centroids(numberOfFaces * 3);
+  m_FaceOrder.resize(numberOfFaces);
+  for (SizeValueType ii = 0; ii < numberOfFaces; ++ii)
+  {
+    m_FaceOrder[ii] = static_cast<uint32_t>(ii);
+    for (unsigned int axis = 0; axis < 3; ++axis)
+    {
+      centroids[ii * 3 + axis] = (m_Points[m_Faces[ii * 3] * 3 + axis] + m_Points[m_Faces[ii * 3 + 1] * 3 + axis] +
+                                  m_Points[m_Faces[ii * 3 + 2] * 3 + axis]) /
+                                 3.0f;
+    }
+  }
+  m_FaceNodes.resize(numberOfFaces > 0 ? NumberOfFaceNodes(numberOfFaces).first : 0);
+
+  // Split the top levels of both trees until the ranges are small enough to be built
+  // independently, then build all remaining subtrees concurrently.
+  struct Task
+  {
+    bool          m_IsFaceRange;
+    SizeValueType m_Begin;
+    SizeValueType m_End;
+    SizeValueType m_Node;
+  };
+  const SizeValueType taskSize =
+    std::max(MinimumTaskSize,
+             std::max(numberOfPoints, numberOfFaces) / (4 * MultiThreaderBase::GetGlobalDefaultNumberOfThreads()));
+  std::vector<Task> tasks;
+  std::vector<Task> ranges;
+  if (numberOfPoints > 0)
+  {
+    ranges.push_back({ false, 0, numberOfPoints, 0 });
+  }
+  if (numberOfFaces > 0)
+  {
+    ranges.push_back({ true, 0, numberOfFaces, 0 });
+  }
+  while (!ranges.empty())
+  {
+    const Task range = ranges.back();
+    ranges.pop_back();
+    if (range.m_End - range.m_Begin <= taskSize)
+    {
+      tasks.push_back(range);
+    }
+    else if (range.m_IsFaceRange)
+    {
+      if (this->SplitFaceRange(range.m_Begin, range.m_End, range.m_Node, centroids))
+      {
+        const SizeValueType middle = range.m_Begin + (range.m_End - range.m_Begin) / 2;
+        ranges.push_back({ true, range.m_Begin, middle, range.m_Node + 1 });
+        ranges.push_back({ true, middle, range.m_End, m_FaceNodes[range.m_Node].m_Offset });
+      }
+    }
+    else
+    {
+      const SizeValueType middle = this->SplitPointRange(range.m_Begin, range.m_End);
+      ranges.push_back({ false, range.m_Begin, middle, 0 });
+      ranges.push_back({ false, middle + 1, range.m_End, 0 });
+    }
+  }
+
+  const auto multiThreader = MultiThreaderBase::New();
+  multiThreader->ParallelizeArray(
+    0,
+    tasks.size(),
+    [&](SizeValueType index) {
+      const Task & task = tasks[index];
+      if (task.m_IsFaceRange)
+      {
+        this->BuildFaceTree(task.m_Begin, task.m_End, task.m_Node, centroids);
+      }
+      else
+      {
+        this->BuildPointTree(task.m_Begin, task.m_End);
+      }
+    },
+    nullptr);
+}
+
+SizeValueType
+MZ3SpatialIndex::SplitPointRange(SizeValueType begin, SizeValueType end)
+{
+  float minimum[3];
+  float maximum[3];
+  for (unsigned int axis = 0; axis < 3; ++axis)
+  {
+    minimum[axis] = std::numeric_limits<float>::max();
+    maximum[axis] = std::numeric_limits<float>::lowest();
+  }
+  for (SizeValueType ii = begin; ii < end; ++ii)
+  {
+    const float * point = &m_Points[m_PointOrder[ii] * 3];
+    for (unsigned int axis = 0; axis < 3; ++axis)
+    {
+      minimum[axis] = std::min(minimum[axis], point[axis]);
+      maximum[axis] = std::max(maximum[axis], point[axis]);
+    }
+  }
+  unsigned int splitAxis = 0;
+  for (unsigned int axis = 1; axis < 3; ++axis)
+  {
+    if (maximum[axis] - minimum[axis] > maximum[splitAxis] - minimum[splitAxis])
+    {
+      splitAxis = axis;
+    }
+  }
+
+  const SizeValueType middle = begin + (end - begin) / 2;
+  std::nth_element(m_PointOrder.begin() + begin,
+                   m_PointOrder.begin() + middle,
+                   m_PointOrder.begin() + end,
+                   [this, splitAxis](uint32_t a, uint32_t b) {
+                     return m_Points[a * 3 + splitAxis] < m_Points[b * 3 + splitAxis];
+                   });
+  m_PointSplitAxis[middle] = static_cast<uint8_t>(splitAxis);
+  return middle;
+}
+
+void
+MZ3SpatialIndex::BuildPointTree(SizeValueType begin, SizeValueType end)
+{
+  if (end - begin < 2)
+  {
+    return;
+  }
+  const SizeValueType middle = this->SplitPointRange(begin, end);
+  this->BuildPointTree(begin, middle);
+  this->BuildPointTree(middle + 1, end);
+}
+
+bool
+MZ3SpatialIndex::SplitFaceRange(SizeValueType              begin,
+                                SizeValueType              end,
+                                SizeValueType              node,
+                                const std::vector<float> & centroids)
+{
+  BoundingVolumeNode & volume = m_FaceNodes[node];
+  float                centroidMinimum[3];
+  float                centroidMaximum[3];
+  for (unsigned int axis = 0; axis < 3; ++axis)
+  {
+    volume.m_Minimum[axis] = centroidMinimum[axis] = std::numeric_limits<float>::max();
+    volume.m_Maximum[axis] = centroidMaximum[axis] = std::numeric_limits<float>::lowest();
+  }
+  for (SizeValueType ii = begin; ii < end; ++ii)
+  {
+    const uint32_t face = m_FaceOrder[ii];
+    for (unsigned int vertex = 0; vertex < 3; ++vertex)
+    {
+      const float * point = &m_Points[m_Faces[face * 3 + vertex] * 3];
+      for (unsigned int axis = 0; axis < 3; ++axis)
+      {
+        volume.m_Minimum[axis] = std::min(volume.m_Minimum[axis], point[axis]);
+        volume.m_Maximum[axis] = std::max(volume.m_Maximum[axis], point[axis]);
+      }
+    }
+    for (unsigned int axis = 0; axis < 3; ++axis)
+    {
+      centroidMinimum[axis] = std::min(centroidMinimum[axis], centroids[face * 3 + axis]);
+      centroidMaximum[axis] = std::max(centroidMaximum[axis], centroids[face * 3 + axis]);
+    }
+  }
+
+  const SizeValueType count = end - begin;
+  if (count <= LeafSize)
+  {
+    volume.m_Offset = static_cast<uint32_t>(begin);
+    volume.m_NumberOfFaces = static_cast<uint32_t>(count);
+    return false;
+  }
+
+  unsigned int splitAxis = 0;
+  for (unsigned int axis = 1; axis < 3; ++axis)
+  {
+    if (centroidMaximum[axis] - centroidMinimum[axis] > centroidMaximum[splitAxis] - centroidMinimum[splitAxis])
+    {
+      splitAxis = axis;
+    }
+  }
+  const SizeValueType middle = begin + count / 2;
+  std::nth_element(m_FaceOrder.begin() + begin,
+                   m_FaceOrder.begin() + middle,
+                   m_FaceOrder.begin() + end,
+                   [&centroids, splitAxis](uint32_t a, uint32_t b) {
+                     return centroids[a * 3 + splitAxis] < centroids[b * 3 + splitAxis];
+                   });
+  volume.m_Offset = static_cast<uint32_t>(node + 1 + NumberOfFaceNodes(count / 2).first);
+  volume.m_NumberOfFaces = 0;
+  return true;
+}
+
+void
+MZ3SpatialIndex::BuildFaceTree(SizeValueType              begin,
+                               SizeValueType              end,
+                               SizeValueType              node,
+                               const std::vector<float> & centroids)
+{
+  if (this->SplitFaceRange(begin, end, node, centroids))
+  {
+    const SizeValueType middle = begin + (end - begin) / 2;
+    this->BuildFaceTree(begin, middle, node + 1, centroids);
+    this->BuildFaceTree(middle, end, m_FaceNodes[node].m_Offset, centroids);
+  }
+}
+
+SizeValueType
+MZ3SpatialIndex::FindClosestPoint(const float point[3]) const
+{
+  if (m_PointOrder.empty())
+  {
+    itkExceptionMacro("The spatial index holds no points");
+  }
+  SizeValueType closest = 0;
+  float         closestDistance = std::numeric_limits<float>::max();
+  this->FindClosestPoint(0, m_PointOrder.size(), point, closest, closestDistance);
+  return closest;
+}
+
+void
+MZ3SpatialIndex::FindClosestPoint(SizeValueType   begin,
+                                  SizeValueType   end,
+                                  const float     point[3],
+                                  SizeValueType & closest,
+                                  float &         closestDistance) const
+{
+  if (begin >= end)
+  {
+    return;
+  }
+  const SizeValueType middle = begin + (end - begin) / 2;
+  const uint32_t      id = m_PointOrder[middle];
+  const float *       nodePoint = &m_Points[id * 3];
+  const float         distance = SquaredDistance(point, nodePoint);
+  if (distance < closestDistance)
+  {
+    closestDistance = distance;
+    closest = id;
+  }
+  if (end - begin == 1)
+  {
+    return;
+  }
+
+  // Visit the side of the split that holds the point first
+  const unsigned int axis = m_PointSplitAxis[middle];
+  const float        offset = point[axis] - nodePoint[axis];
+  if (offset < 0.0f)
+  {
+    this->FindClosestPoint(begin, middle, point, closest, closestDistance);
+    if (offset * offset < closestDistance)
+    {
+      this->FindClosestPoint(middle + 1, end, point, closest, closestDistance);
+    }
+  }
+  else
+  {
+    this->FindClosestPoint(middle + 1, end, point, closest, closestDistance);
+    if (offset * offset < closestDistance)
+    {
+      this->FindClosestPoint(begin, middle, point, closest, closestDistance);
+    }
+  }
+}
+
+SizeValueType
+MZ3SpatialIndex::FindClosestSurfacePoint(const float point[3], float closestPoint[3]) const
+{
+  if (m_FaceNodes.empty())
+  {
+    itkExceptionMacro("The spatial index holds no faces");
+  }
+  SizeValueType closest = 0;
+  float         closestDistance = std::numeric_limits<float>::max();
+
+  // Depth first, nearer child first, skipping nodes whose box is farther than the closest triangle
+  std::vector<uint32_t> stack{ 0 };
+  while (!stack.empty())
+  {
+    const BoundingVolumeNode & volume = m_FaceNodes[stack.back()];
+    const uint32_t             node = stack.back();
+    stack.pop_back();
+    if (SquaredDistanceToBox(point, volume.m_Minimum, volume.m_Maximum) >= closestDistance)
+    {
+      continue;
+    }
+    if (volume.m_NumberOfFaces > 0)
+    {
+      for (uint32_t ii = volume.m_Offset; ii < volume.m_Offset + volume.m_NumberOfFaces; ++ii)
+      {
+        const uint32_t * face = &m_Faces[m_FaceOrder[ii] * 3];
+        float            candidate[3];
+        ClosestPointOnTriangle(
+          point, &m_Points[face[0] * 3], &m_Points[face[1] * 3], &m_Points[face[2] * 3], candidate);
+        const float distance = SquaredDistance(point, candidate);
+        if (distance < closestDistance)
+        {
+          closestDistance = distance;
+          closest = m_FaceOrder[ii];
+          std::copy(candidate, candidate + 3, closestPoint);
+        }
+      }
+      continue;
+    }
+    const uint32_t             left = node + 1;
+    const uint32_t             right = volume.m_Offset;
+    const BoundingVolumeNode & leftVolume = m_FaceNodes[left];
+    const BoundingVolumeNode & rightVolume = m_FaceNodes[right];
+    if (SquaredDistanceToBox(point, leftVolume.m_Minimum, leftVolume.m_Maximum) <
+        SquaredDistanceToBox(point, rightVolume.m_Minimum, rightVolume.m_Maximum))
+    {
+      stack.push_back(right);
+      stack.push_back(left);
+    }
+    else
+    {
+      stack.push_back(left);
+      stack.push_back(right);
+    }
+  }
+  return closest;
+}
+
+uint32_t
+MZ3SpatialIndex::ComputeChecksum() const
+{
+  uLong      checksum = crc32(0L, Z_NULL, 0);
+  const auto update = [&checksum](const void * data, SizeValueType size) {
+    const auto bytes = static_cast<const Bytef *>(data);
+    for (SizeValueType begin = 0; begin < size; begin += 1u << 30)
+    {
+      checksum = crc32(checksum, bytes + begin, static_cast<uInt>(std::min<SizeValueType>(size - begin, 1u << 30)));
+    }
+  };
+  update(m_Points.data(), m_Points.size() * sizeof(float));
+  update(m_Faces.data(), m_Faces.size() * sizeof(uint32_t));
+  return static_cast<uint32_t>(checksum);
+}
+
+void
+MZ3SpatialIndex::Write(const std::string & fileName) const
+{
+  std::ofstream file(fileName, std::ios::binary);
+  if (!file)
+  {
+    itkExceptionMacro("Cannot write " << fileName);
+  }
+  const uint64_t numberOfPoints = this->GetNumberOfPoints();
+  const uint64_t numberOfFaces = this->GetNumberOfFaces();
+  const uint64_t numberOfNodes = m_FaceNodes.size();
+  const uint32_t checksum = this->ComputeChecksum();
+  file.write(FileSignature, sizeof(FileSignature));
+  file.write(reinterpret_cast<const char *>(&FileVersion), sizeof(FileVersion));
+  file.write(reinterpret_cast<const char *>(&checksum), sizeof(checksum));
+  file.write(reinterpret_cast<const char *>(&numberOfPoints), sizeof(numberOfPoints));
+  file.write(reinterpret_cast<const char *>(&numberOfFaces), sizeof(numberOfFaces));
+  file.write(reinterpret_cast<const char *>(&numberOfNodes), sizeof(numberOfNodes));
+  WriteArray(file, m_PointOrder);
+  WriteArray(file, m_PointSplitAxis);
+  WriteArray(file, m_FaceOrder);
+  WriteArray(file, m_FaceNodes);
+  if (!file)
+  {
+    itkExceptionMacro("Cannot write " << fileName);
+  }
+}
+
+bool
+MZ3SpatialIndex::Read(const std::string & fileName,
+                      const float *       points,
+                      SizeValueType       numberOfPoints,
+                      const uint32_t *    faces,
+                      SizeValueType       numberOfFaces)
+{
+  std::vector<float>    pointCopy(points, points + numberOfPoints * 3);
+  std::vector<uint32_t> faceCopy(faces, faces + numberOfFaces * 3);
+  return this->Read(fileName, pointCopy, faceCopy);
+}
+
+bool
+MZ3SpatialIndex::Read(const std::string & fileName, std::vector<float> & points, std::vector<uint32_t> & faces)
+{
+  const SizeValueType numberOfPoints = points.size() / 3;
+  const SizeValueType numberOfFaces = faces.size() / 3;
+  std::ifstream       file(fileName, std::ios::binary);
+  if (!file)
+  {
+    return false;
+  }
+  char     signature[sizeof(FileSignature)]{};
+  uint32_t version = 0;
+  uint32_t checksum = 0;
+  uint64_t fileNumberOfPoints = 0;
+  uint64_t fileNumberOfFaces = 0;
+  uint64_t numberOfNodes = 0;
+  file.read(signature, sizeof(signature));
+  file.read(reinterpret_cast<char *>(&version), sizeof(version));
+  file.read(reinterpret_cast<char *>(&checksum), sizeof(checksum));
+  file.read(reinterpret_cast<char *>(&fileNumberOfPoints), sizeof(fileNumberOfPoints));
+  file.read(reinterpret_cast<char *>(&fileNumberOfFaces), sizeof(fileNumberOfFaces));
+  file.read(reinterpret_cast<char *>(&numberOfNodes), sizeof(numberOfNodes));
+  if (!file || std::memcmp(signature, FileSignature, sizeof(signature)) != 0 || version != FileVersion ||
+      fileNumberOfPoints != numberOfPoints || fileNumberOfFaces != numberOfFaces ||
+      numberOfNodes != (numberOfFaces > 0 ? NumberOfFaceNodes(numberOfFaces).first : 0))
+  {
+    return false;
+  }
+
+  this->SetGeometry(std::move(points), std::move(faces));
+  const auto isValid = [&]() {
+    if (checksum != this->ComputeChecksum() || !ReadArray(file, m_PointOrder, numberOfPoints) ||
+        !ReadArray(file, m_PointSplitAxis, numberOfPoints) || !ReadArray(file, m_FaceOrder, numberOfFaces) ||
+        !ReadArray(file, m_FaceNodes, numberOfNodes))
+    {
+      return false;
+    }
+    // Guard the queries against indices out of range
+    const auto pointOutOfRange = [numberOfPoints](uint32_t id) { return id >= numberOfPoints; };
+    const auto faceOutOfRange = [numberOfFaces](uint32_t id) { return id >= numberOfFaces; };
+    const auto axisOutOfRange = [](uint8_t axis) { return axis > 2; };
+    const auto nodeOutOfRange = [numberOfFaces, numberOfNodes](const BoundingVolumeNode & node) {
+      return node.m_NumberOfFaces > 0 ? node.m_Offset + static_cast<SizeValueType>(node.m_NumberOfFaces) > numberOfFaces
+                                      : node.m_Offset >= numberOfNodes;
+    };
+    return std::none_of(m_PointOrder.begin(), m_PointOrder.end(), pointOutOfRange) &&
+           std::none_of(m_PointSplitAxis.begin(), m_PointSplitAxis.end(), axisOutOfRange) &&
+           std::none_of(m_FaceOrder.begin(), m_FaceOrder.end(), faceOutOfRange) &&
+           std::none_of(m_FaceNodes.begin(), m_FaceNodes.end(), nodeOutOfRange);
+  };
+  if (!isValid())
+  {
+    // Hand the geometry back, for the caller to build the trees from
+    points = std::move(m_Points);
+    faces = std::move(m_Faces);
+    m_Points.clear();
+    m_Faces.clear();
+    m_PointOrder.clear();
+    m_PointSplitAxis.clear();
+    m_FaceOrder.clear();
+    m_FaceNodes.clear();
+    return false;
+  }
+  return true;
+}
+
+void
+MZ3SpatialIndex::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "NumberOfPoints: " << this->GetNumberOfPoints() << std::endl;
+  os << indent << "NumberOfFaces: " << this->GetNumberOfFaces() << std::endl;
+  os << indent << "NumberOfFaceNodes: " << m_FaceNodes.size() << std::endl;
+}
+} // namespace itk
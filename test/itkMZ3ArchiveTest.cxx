@@ -0,0 +1,167 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkMZ3Archive.h"
+#include "itkMZ3BatchReader.h"
+#include "itkMZ3MeshIO.h"
+
+#include "itkMesh.h"
+#include "itkMeshFileReader.h"
+#include "itkMeshFileWriter.h"
+#include "itkTestingMacros.h"
+#include "itksys/SystemTools.hxx"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+template <typename TMesh>
+bool
+MeshesAreEqual(const TMesh * mesh1, const TMesh * mesh2)
+{
+  if (mesh1->GetNumberOfPoints() != mesh2->GetNumberOfPoints() ||
+      mesh1->GetNumberOfCells() != mesh2->GetNumberOfCells())
+  {
+    return false;
+  }
+  for (typename TMesh::PointIdentifier id = 0; id < mesh1->GetNumberOfPoints(); ++id)
+  {
+    if (mesh1->GetPoint(id) != mesh2->GetPoint(id))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+int
+itkMZ3ArchiveTest(int argc, char * argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << itkNameOfTestExecutableMacro(argv);
+    std::cerr << " outputArchive";
+    std::cerr << " inputMesh [inputMesh ...]";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string archiveFileName = argv[1];
+
+  using MeshType = itk::Mesh<float, 3>;
+
+  auto archive = itk::MZ3Archive::New();
+  ITK_EXERCISE_BASIC_OBJECT_METHODS(archive, MZ3Archive, Object);
+  archive->SetFileName(archiveFileName);
+
+  // Every input as it is, and as raw data written to memory
+  std::vector<MeshType::Pointer> expected;
+  for (int arg = 2; arg < argc; ++arg)
+  {
+    const auto mesh = itk::ReadMesh<MeshType>(argv[arg]);
+    expected.push_back(mesh);
+    expected.push_back(mesh);
+    ITK_TRY_EXPECT_NO_EXCEPTION(archive->AddFile("mesh" + std::to_string(arg), argv[arg]));
+
+    std::vector<uint8_t> contents;
+    auto                 bufferMeshIO = itk::MZ3MeshIO::New();
+    bufferMeshIO->SetOutputBuffer(&contents);
+    auto writer = itk::MeshFileWriter<MeshType>::New();
+    writer->SetMeshIO(bufferMeshIO);
+    writer->SetInput(mesh);
+    writer->SetFileName("NotOnDisk.mz3");
+    ITK_TRY_EXPECT_NO_EXCEPTION(writer->Update());
+    ITK_TRY_EXPECT_NO_EXCEPTION(archive->AddEntry("raw mesh" + std::to_string(arg), contents.data(), contents.size()));
+  }
+  ITK_TRY_EXPECT_EXCEPTION(archive->AddFile("mesh2", argv[2]));
+  const char notMZ3[32] = {};
+  ITK_TRY_EXPECT_EXCEPTION(archive->AddEntry("notMZ3", notMZ3, sizeof(notMZ3)));
+  ITK_TRY_EXPECT_NO_EXCEPTION(archive->Write());
+
+  ITK_TRY_EXPECT_NO_EXCEPTION(archive->Open());
+  ITK_TEST_EXPECT_TRUE(archive->IsUpToDate());
+  ITK_TEST_EXPECT_EQUAL(archive->GetEntries().size(), expected.size());
+  for (const auto & entry : archive->GetEntries())
+  {
+    ITK_TEST_EXPECT_EQUAL(entry.m_Header[0], 0x4D);
+    ITK_TEST_EXPECT_EQUAL(entry.m_Header[1], 0x5A);
+  }
+  ITK_TEST_EXPECT_TRUE(archive->FindEntry("mesh2") != nullptr);
+  ITK_TEST_EXPECT_TRUE(archive->FindEntry("NoEntry") == nullptr);
+  std::vector<uint8_t> payload;
+  ITK_TRY_EXPECT_EXCEPTION(archive->ReadEntry("NoEntry", payload));
+
+  // Entries are read through MZ3MeshIO, concurrently
+  const std::vector<std::string> paths = archive->GetEntryPaths();
+  auto                           meshIO = itk::MZ3MeshIO::New();
+  ITK_TEST_EXPECT_TRUE(meshIO->CanReadFile(paths.front().c_str()));
+  ITK_TEST_EXPECT_TRUE(!meshIO->CanReadFile((archiveFileName + ":NoEntry").c_str()));
+
+  // The header of an entry is taken from the index, and matches the decoded entry
+  uint8_t header[16];
+  meshIO->SetFileName(paths.front());
+  ITK_TEST_EXPECT_TRUE(meshIO->ReadHeader(header));
+  ITK_TRY_EXPECT_NO_EXCEPTION(meshIO->ReadMeshInformation());
+  uint32_t numberOfFaces = 0;
+  std::memcpy(&numberOfFaces, header + 4, sizeof(numberOfFaces));
+  ITK_TEST_EXPECT_EQUAL(numberOfFaces, meshIO->GetNumberOfCells());
+  meshIO->SetFileName(archiveFileName + ":NoEntry");
+  ITK_TRY_EXPECT_EXCEPTION(meshIO->ReadHeader(header));
+
+  bool isEqual = true;
+  ITK_TRY_EXPECT_NO_EXCEPTION(itk::ReadMZ3Batch<MeshType>(
+    paths, [&](itk::SizeValueType index, const std::string &, MeshType::Pointer mesh) {
+      isEqual = isEqual && MeshesAreEqual(mesh.GetPointer(), expected[index].GetPointer());
+    }));
+  ITK_TEST_EXPECT_TRUE(isEqual);
+
+  auto reader = itk::MeshFileReader<MeshType>::New();
+  reader->SetMeshIO(meshIO);
+  reader->SetFileName(archiveFileName + ":NoEntry");
+  ITK_TRY_EXPECT_EXCEPTION(reader->Update());
+
+  // Index and entry sizes that wrap around past the end of the file are rejected
+  std::ifstream     archiveInput(archiveFileName, std::ios::binary);
+  const std::string archiveBytes((std::istreambuf_iterator<char>(archiveInput)), std::istreambuf_iterator<char>());
+  archiveInput.close();
+  uint64_t indexOffset = 0;
+  uint64_t entryOffset = 0;
+  std::memcpy(&indexOffset, archiveBytes.data() + 16, sizeof(indexOffset));
+  std::memcpy(&entryOffset, archiveBytes.data() + indexOffset, sizeof(entryOffset));
+  const std::string corruptFileName = archiveFileName + ".corrupt.mz3a";
+  for (const itk::SizeValueType field : { itk::SizeValueType{ 24 }, indexOffset + 8 })
+  {
+    std::string    corruptBytes = archiveBytes;
+    const uint64_t start = field == 24 ? indexOffset : entryOffset;
+    const uint64_t wrappingSize = ~start + 2;
+    std::memcpy(&corruptBytes[field], &wrappingSize, sizeof(wrappingSize));
+    std::ofstream(corruptFileName, std::ios::binary).write(corruptBytes.data(), corruptBytes.size());
+    archive->SetFileName(corruptFileName);
+    ITK_TRY_EXPECT_EXCEPTION(archive->Open());
+  }
+  itksys::SystemTools::RemoveFile(corruptFileName);
+
+  archive->SetFileName("NotAnArchive.mz3a");
+  ITK_TRY_EXPECT_EXCEPTION(archive->Open());
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,125 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkMZ3BatchReader.h"
+#include "itkMZ3MeshIOFactory.h"
+
+#include "itkMesh.h"
+#include "itkMeshFileReader.h"
+#include "itkTestingMacros.h"
+
+#include <algorithm>
+
+namespace
+{
+template <typename TMesh>
+bool
+MeshesAreEqual(const TMesh * mesh1, const TMesh * mesh2)
+{
+  if (mesh1->GetNumberOfPoints() != mesh2->GetNumberOfPoints() ||
+      mesh1->GetNumberOfCells() != mesh2->GetNumberOfCells())
+  {
+    return false;
+  }
+  for (typename TMesh::PointIdentifier id = 0; id < mesh1->GetNumberOfPoints(); ++id)
+  {
+    if (mesh1->GetPoint(id) != mesh2->GetPoint(id))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+int
+itkMZ3BatchReaderTest(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << itkNameOfTestExecutableMacro(argv);
+    std::cerr << " inputMesh [inputMesh ...]";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  itk::MZ3MeshIOFactory::RegisterOneFactory();
+
+  constexpr unsigned int Dimension = 3;
+  using PixelType = float;
+  using MeshType = itk::Mesh<PixelType, Dimension>;
+
+  // Every input several times, so that work units finish out of order
+  std::vector<MeshType::Pointer> expected;
+  std::vector<std::string>       paths;
+  for (int arg = 1; arg < argc; ++arg)
+  {
+    expected.push_back(itk::ReadMesh<MeshType>(argv[arg]));
+  }
+  for (unsigned int repeat = 0; repeat < 8; ++repeat)
+  {
+    for (int arg = 1; arg < argc; ++arg)
+    {
+      paths.emplace_back(argv[arg]);
+    }
+  }
+
+  int result = EXIT_SUCCESS;
+
+  for (const bool preserveOrder : { false, true })
+  {
+    for (const itk::SizeValueType memoryBudget : { 0, 1, 1 << 20 })
+    {
+      itk::MZ3BatchReadOptions options;
+      options.NumberOfWorkUnits = 4;
+      options.MemoryBudget = memoryBudget;
+      options.PreserveOrder = preserveOrder;
+
+      std::vector<unsigned int> timesSeen(paths.size(), 0);
+      itk::SizeValueType        nextIndex = 0;
+      bool                      inOrder = true;
+      bool                      equal = true;
+      ITK_TRY_EXPECT_NO_EXCEPTION(itk::ReadMZ3Batch<MeshType>(
+        paths,
+        [&](itk::SizeValueType index, const std::string & path, MeshType::Pointer mesh) {
+          inOrder = inOrder && index == nextIndex++;
+          ++timesSeen[index];
+          const MeshType * expectedMesh = expected[index % expected.size()].GetPointer();
+          equal = equal && path == paths[index] && MeshesAreEqual(mesh.GetPointer(), expectedMesh);
+        },
+        options));
+
+      ITK_TEST_EXPECT_TRUE(equal);
+      ITK_TEST_EXPECT_TRUE(std::all_of(timesSeen.begin(), timesSeen.end(), [](unsigned int n) { return n == 1; }));
+      if (preserveOrder && !inOrder)
+      {
+        std::cerr << "Meshes were not delivered in input order with MemoryBudget " << memoryBudget << std::endl;
+        result = EXIT_FAILURE;
+      }
+    }
+  }
+
+  // A file that cannot be read stops the batch and is reported
+  paths.insert(paths.begin() + 1, "NotAFile.mz3");
+  ITK_TRY_EXPECT_EXCEPTION(
+    itk::ReadMZ3Batch<MeshType>(paths, [](itk::SizeValueType, const std::string &, MeshType::Pointer) {}));
+
+  std::cout << "Test finished." << std::endl;
+  return result;
+}
@@ -0,0 +1,121 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkMZ3DecompressedCache.h"
+#include "itkMZ3MappedMesh.h"
+#include "itkMZ3MeshIO.h"
+
+#include "itkMesh.h"
+#include "itkMeshFileReader.h"
+#include "itkMeshFileWriter.h"
+#include "itkTestingMacros.h"
+
+#include <filesystem>
+
+namespace
+{
+template <typename TMesh>
+bool
+PointsAreEqual(const TMesh * mesh, const TMesh * baseline)
+{
+  if (mesh->GetNumberOfPoints() != baseline->GetNumberOfPoints() ||
+      mesh->GetNumberOfCells() != baseline->GetNumberOfCells())
+  {
+    return false;
+  }
+  for (typename TMesh::PointIdentifier id = 0; id < mesh->GetNumberOfPoints(); ++id)
+  {
+    if (mesh->GetPoint(id) != baseline->GetPoint(id))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+int
+itkMZ3DecompressedCacheTest(int argc, char * argv[])
+{
+  if (argc < 4)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << itkNameOfTestExecutableMacro(argv);
+    std::cerr << " inputCompressedMesh";
+    std::cerr << " cacheDirectory";
+    std::cerr << " outputCompressedMesh";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+  const char * inputMeshFileName = argv[1];
+  const char * cacheDirectory = argv[2];
+  const char * compressedMeshFileName = argv[3];
+
+  std::filesystem::remove_all(cacheDirectory);
+  using MeshType = itk::Mesh<float, 3>;
+  const auto mesh = itk::ReadMesh<MeshType>(inputMeshFileName);
+
+  auto cache = itk::MZ3DecompressedCache::New();
+  ITK_EXERCISE_BASIC_OBJECT_METHODS(cache, MZ3DecompressedCache, Object);
+  ITK_TRY_EXPECT_EXCEPTION(cache->GetCachedFileName(inputMeshFileName));
+  cache->SetDirectory(cacheDirectory);
+  ITK_TEST_SET_GET_VALUE(std::string(cacheDirectory), std::string(cache->GetDirectory()));
+
+  // The first read inflates the file, later reads find it
+  const std::string cachedFileName = cache->GetCachedFileName(inputMeshFileName);
+  ITK_TEST_EXPECT_EQUAL(cache->GetNumberOfMisses(), 1);
+  ITK_TEST_EXPECT_EQUAL(cache->GetCachedFileName(inputMeshFileName), cachedFileName);
+  ITK_TEST_EXPECT_EQUAL(cache->GetNumberOfHits(), 1);
+  const auto cachedMesh = itk::ReadMesh<MeshType>(cachedFileName);
+  ITK_TEST_EXPECT_TRUE(PointsAreEqual(cachedMesh.GetPointer(), mesh.GetPointer()));
+
+  // MZ3MeshIO and MZ3MappedMesh read the cached file
+  auto meshIO = itk::MZ3MeshIO::New();
+  meshIO->SetDecompressedCacheDirectory(cacheDirectory);
+  ITK_TEST_SET_GET_VALUE(std::string(cacheDirectory), std::string(meshIO->GetDecompressedCacheDirectory()));
+  auto reader = itk::MeshFileReader<MeshType>::New();
+  reader->SetMeshIO(meshIO);
+  reader->SetFileName(inputMeshFileName);
+  ITK_TRY_EXPECT_NO_EXCEPTION(reader->Update());
+  ITK_TEST_EXPECT_TRUE(PointsAreEqual(reader->GetOutput(), mesh.GetPointer()));
+
+  auto mappedMesh = itk::MZ3MappedMesh::New();
+  mappedMesh->SetFileName(inputMeshFileName);
+  mappedMesh->SetCacheDirectory(cacheDirectory);
+  ITK_TRY_EXPECT_NO_EXCEPTION(mappedMesh->Open());
+  ITK_TEST_EXPECT_EQUAL(std::string(mappedMesh->GetMappedFileName()), cachedFileName);
+  ITK_TEST_EXPECT_EQUAL(mappedMesh->GetNumberOfPoints(), mesh->GetNumberOfPoints());
+  mappedMesh->Close();
+
+  // Another file gets its own entry, which evicts the older one beyond the maximum size
+  constexpr bool compress = true;
+  itk::WriteMesh(mesh, compressedMeshFileName, compress);
+  cache->SetMaximumSize(1);
+  ITK_TEST_SET_GET_VALUE(itk::SizeValueType{ 1 }, cache->GetMaximumSize());
+  const std::string otherFileName = cache->GetCachedFileName(compressedMeshFileName);
+  ITK_TEST_EXPECT_TRUE(otherFileName != cachedFileName);
+  ITK_TEST_EXPECT_TRUE(std::filesystem::exists(otherFileName));
+  ITK_TEST_EXPECT_TRUE(!std::filesystem::exists(cachedFileName));
+
+  // Only compressed MZ3 files are cached
+  ITK_TRY_EXPECT_EXCEPTION(cache->GetCachedFileName(otherFileName));
+  ITK_TRY_EXPECT_EXCEPTION(cache->GetCachedFileName("NotAFile.mz3"));
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
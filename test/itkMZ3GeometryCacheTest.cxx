@@ -0,0 +1,197 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkMZ3GeometryCache.h"
+#include "itkMZ3MeshIO.h"
+
+#include "itkMesh.h"
+#include "itkMeshFileReader.h"
+#include "itkMeshFileWriter.h"
+#include "itkTestingMacros.h"
+
+#include <algorithm>
+#include <memory>
+
+namespace
+{
+using MeshType = itk::Mesh<float, 3>;
+
+MeshType::Pointer
+ReadMeshWith(const char * fileName, itk::MZ3MeshIO * meshIO)
+{
+  auto reader = itk::MeshFileReader<MeshType>::New();
+  reader->SetMeshIO(meshIO);
+  reader->SetFileName(fileName);
+  reader->Update();
+  return reader->GetOutput();
+}
+
+bool
+HaveSameGeometry(const MeshType * mesh1, const MeshType * mesh2)
+{
+  if (mesh1->GetNumberOfPoints() != mesh2->GetNumberOfPoints() ||
+      mesh1->GetNumberOfCells() != mesh2->GetNumberOfCells())
+  {
+    return false;
+  }
+  for (MeshType::PointIdentifier ii = 0; ii < mesh1->GetNumberOfPoints(); ++ii)
+  {
+    if (mesh1->GetPoint(ii) != mesh2->GetPoint(ii))
+    {
+      return false;
+    }
+  }
+  for (MeshType::CellIdentifier ii = 0; ii < mesh1->GetNumberOfCells(); ++ii)
+  {
+    MeshType::CellAutoPointer cell1;
+    MeshType::CellAutoPointer cell2;
+    mesh1->GetCell(ii, cell1);
+    mesh2->GetCell(ii, cell2);
+    if (!std::equal(cell1->PointIdsBegin(), cell1->PointIdsEnd(), cell2->PointIdsBegin()))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+int
+itkMZ3GeometryCacheTest(int argc, char * argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << itkNameOfTestExecutableMacro(argv);
+    std::cerr << " inputMesh";
+    std::cerr << " outputRawMesh";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+  const char * inputMeshFileName = argv[1];
+  const char * rawMeshFileName = argv[2];
+
+  itk::MZ3GeometryCache * cache = itk::MZ3GeometryCache::GetInstance();
+  ITK_EXERCISE_BASIC_OBJECT_METHODS(cache, MZ3GeometryCache, Object);
+  ITK_TEST_EXPECT_TRUE(cache == itk::MZ3GeometryCache::GetInstance());
+  cache->Clear();
+  ITK_TEST_EXPECT_EQUAL(cache->GetNumberOfEntries(), 0);
+  ITK_TEST_EXPECT_EQUAL(cache->GetSize(), 0);
+
+  // The hash depends on the bytes and the seed
+  const char text[] = "The quick brown fox jumps over the lazy dog";
+  ITK_TEST_EXPECT_EQUAL(itk::MZ3GeometryCache::Hash(text, sizeof(text)),
+                        itk::MZ3GeometryCache::Hash(text, sizeof(text)));
+  ITK_TEST_EXPECT_TRUE(itk::MZ3GeometryCache::Hash(text, sizeof(text)) !=
+                       itk::MZ3GeometryCache::Hash(text, sizeof(text) - 1));
+  ITK_TEST_EXPECT_TRUE(itk::MZ3GeometryCache::Hash(text, sizeof(text)) !=
+                       itk::MZ3GeometryCache::Hash(text, sizeof(text), 1));
+
+  MeshType::Pointer reference;
+  ITK_TRY_EXPECT_NO_EXCEPTION(reference = ReadMeshWith(inputMeshFileName, itk::MZ3MeshIO::New()));
+
+  // The first read decodes the geometry, the second shares it
+  const itk::SizeValueType hits = cache->GetNumberOfHits();
+  const itk::SizeValueType misses = cache->GetNumberOfMisses();
+  auto                     meshIO1 = itk::MZ3MeshIO::New();
+  ITK_TEST_SET_GET_BOOLEAN(meshIO1, UseGeometryCache, false);
+  meshIO1->UseGeometryCacheOn();
+  MeshType::Pointer mesh1;
+  ITK_TRY_EXPECT_NO_EXCEPTION(mesh1 = ReadMeshWith(inputMeshFileName, meshIO1));
+  ITK_TEST_EXPECT_EQUAL(cache->GetNumberOfMisses(), misses + 1);
+  ITK_TEST_EXPECT_EQUAL(cache->GetNumberOfHits(), hits);
+  ITK_TEST_EXPECT_EQUAL(cache->GetNumberOfEntries(), 1);
+  ITK_TEST_EXPECT_TRUE(cache->GetSize() > 0);
+  ITK_TEST_EXPECT_TRUE(HaveSameGeometry(reference, mesh1));
+
+  auto meshIO2 = itk::MZ3MeshIO::New();
+  meshIO2->UseGeometryCacheOn();
+  MeshType::Pointer mesh2;
+  ITK_TRY_EXPECT_NO_EXCEPTION(mesh2 = ReadMeshWith(inputMeshFileName, meshIO2));
+  ITK_TEST_EXPECT_EQUAL(cache->GetNumberOfHits(), hits + 1);
+  ITK_TEST_EXPECT_TRUE(meshIO1->GetGeometry() != nullptr);
+  ITK_TEST_EXPECT_TRUE(meshIO1->GetGeometry() == meshIO2->GetGeometry());
+  ITK_TEST_EXPECT_TRUE(HaveSameGeometry(reference, mesh2));
+  ITK_TEST_EXPECT_EQUAL(meshIO2->GetGeometry()->m_Points.size(), reference->GetNumberOfPoints() * 3);
+
+  // Entries are keyed by the decoded faces and vertices, so an uncompressed copy shares the
+  // entry of the compressed file
+  constexpr bool compress = false;
+  ITK_TRY_EXPECT_NO_EXCEPTION(itk::WriteMesh(reference, rawMeshFileName, compress));
+
+  auto meshIO3 = itk::MZ3MeshIO::New();
+  meshIO3->UseGeometryCacheOn();
+  MeshType::Pointer mesh3;
+  ITK_TRY_EXPECT_NO_EXCEPTION(mesh3 = ReadMeshWith(rawMeshFileName, meshIO3));
+  ITK_TRY_EXPECT_NO_EXCEPTION(mesh3 = ReadMeshWith(rawMeshFileName, meshIO3));
+  ITK_TEST_EXPECT_EQUAL(cache->GetNumberOfEntries(), 1);
+  ITK_TEST_EXPECT_EQUAL(cache->GetNumberOfHits(), hits + 3);
+  ITK_TEST_EXPECT_TRUE(HaveSameGeometry(reference, mesh3));
+
+  // Overlays of the surface with different scalars share the entry, and keep their own scalars
+  for (const bool compressOverlay : { false, true })
+  {
+    for (const float scale : { 1.0f, 2.0f })
+    {
+      auto overlay = MeshType::New();
+      overlay->SetPoints(reference->GetPoints());
+      overlay->SetCells(reference->GetCells());
+      for (MeshType::PointIdentifier ii = 0; ii < reference->GetNumberOfPoints(); ++ii)
+      {
+        overlay->SetPointData(ii, scale * static_cast<float>(ii));
+      }
+      ITK_TRY_EXPECT_NO_EXCEPTION(itk::WriteMesh(overlay, rawMeshFileName, compressOverlay));
+
+      auto overlayMeshIO = itk::MZ3MeshIO::New();
+      overlayMeshIO->UseGeometryCacheOn();
+      MeshType::Pointer overlayMesh;
+      ITK_TRY_EXPECT_NO_EXCEPTION(overlayMesh = ReadMeshWith(rawMeshFileName, overlayMeshIO));
+      ITK_TEST_EXPECT_TRUE(overlayMeshIO->GetGeometry() == meshIO1->GetGeometry());
+      ITK_TEST_EXPECT_TRUE(HaveSameGeometry(reference, overlayMesh));
+      const MeshType::PointIdentifier lastPoint = reference->GetNumberOfPoints() - 1;
+      ITK_TEST_EXPECT_EQUAL(overlayMesh->GetPointData()->ElementAt(lastPoint), scale * static_cast<float>(lastPoint));
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(cache->GetNumberOfEntries(), 1);
+  ITK_TEST_EXPECT_EQUAL(cache->GetNumberOfMisses(), misses + 1);
+
+  // Lowering the limit evicts the least recently used entries
+  itk::MZ3GeometryCache::Key smallKey{};
+  smallKey.m_Hash = 1;
+  const auto smallGeometry = std::make_shared<itk::MZ3GeometryCache::Geometry>();
+  smallGeometry->m_Points.assign(3, 0.0f);
+  cache->Insert(smallKey, smallGeometry);
+  ITK_TEST_EXPECT_EQUAL(cache->GetNumberOfEntries(), 2);
+  const itk::SizeValueType maximumSize = cache->GetMaximumSize();
+  cache->SetMaximumSize(cache->GetSize() - 1);
+  ITK_TEST_EXPECT_EQUAL(cache->GetNumberOfEntries(), 1);
+  ITK_TEST_EXPECT_TRUE(cache->Find(smallKey) == smallGeometry);
+  cache->SetMaximumSize(0);
+  ITK_TEST_EXPECT_EQUAL(cache->GetNumberOfEntries(), 0);
+  ITK_TEST_EXPECT_EQUAL(cache->GetSize(), 0);
+
+  // Geometry larger than the limit is used, but not stored
+  ITK_TRY_EXPECT_NO_EXCEPTION(mesh1 = ReadMeshWith(inputMeshFileName, meshIO1));
+  ITK_TEST_EXPECT_EQUAL(cache->GetNumberOfEntries(), 0);
+  ITK_TEST_EXPECT_TRUE(HaveSameGeometry(reference, mesh1));
+  cache->SetMaximumSize(maximumSize);
+  ITK_TEST_EXPECT_EQUAL(cache->GetMaximumSize(), maximumSize);
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkMZ3MappedMesh.h"
+#include "itkMZ3DecompressedCache.h"
+
+#include "itkMesh.h"
+#include "itkMeshFileReader.h"
+#include "itkMeshFileWriter.h"
+#include "itkTestingMacros.h"
+#include "itksys/SystemTools.hxx"
+
+#include <filesystem>
+
+namespace
+{
+template <typename TMesh>
+bool
+MappedMeshEqualsMesh(const itk::MZ3MappedMesh * mappedMesh, const TMesh * mesh)
+{
+  if (mappedMesh->GetNumberOfPoints() != mesh->GetNumberOfPoints() ||
+      mappedMesh->GetNumberOfFaces() != mesh->GetNumberOfCells())
+  {
+    return false;
+  }
+  for (typename TMesh::PointIdentifier id = 0; id < mesh->GetNumberOfPoints(); ++id)
+  {
+    const auto point = mesh->GetPoint(id);
+    for (unsigned int ii = 0; ii < 3; ++ii)
+    {
+      if (mappedMesh->GetPoint(id)[ii] != point[ii] || mappedMesh->GetPoints()[id * 3 + ii] != point[ii])
+      {
+        return false;
+      }
+    }
+  }
+  itk::SizeValueType faceId = 0;
+  for (auto cell = mesh->GetCells()->Begin(); cell != mesh->GetCells()->End(); ++cell, ++faceId)
+  {
+    const auto face = mappedMesh->GetFace(faceId);
+    if (!std::equal(face.begin(), face.end(), cell.Value()->PointIdsBegin(), cell.Value()->PointIdsEnd()))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+int
+itkMZ3MappedMeshTest(int argc, char * argv[])
+{
+  if (argc < 4)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << itkNameOfTestExecutableMacro(argv);
+    std::cerr << " inputCompressedMesh";
+    std::cerr << " cacheMesh";
+    std::cerr << " outputRawMesh";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+  const char * inputMeshFileName = argv[1];
+  const char * cacheFileName = argv[2];
+  const char * rawMeshFileName = argv[3];
+
+  using MeshType = itk::Mesh<float, 3>;
+  const auto mesh = itk::ReadMesh<MeshType>(inputMeshFileName);
+
+  auto mappedMesh = itk::MZ3MappedMesh::New();
+  ITK_EXERCISE_BASIC_OBJECT_METHODS(mappedMesh, MZ3MappedMesh, Object);
+  ITK_TEST_EXPECT_TRUE(!mappedMesh->IsOpen());
+
+  // A compressed file is inflated into the cache file, which is mapped
+  mappedMesh->SetFileName(inputMeshFileName);
+  mappedMesh->SetCacheFileName(cacheFileName);
+  ITK_TRY_EXPECT_NO_EXCEPTION(mappedMesh->Open());
+  ITK_TEST_EXPECT_TRUE(mappedMesh->IsOpen());
+  ITK_TEST_EXPECT_EQUAL(std::string(mappedMesh->GetMappedFileName()), std::string(cacheFileName));
+  ITK_TEST_EXPECT_TRUE(MappedMeshEqualsMesh(mappedMesh.GetPointer(), mesh.GetPointer()));
+
+  // The cache file is up to date, so it is mapped again without inflating
+  ITK_TRY_EXPECT_NO_EXCEPTION(mappedMesh->Open());
+  ITK_TEST_EXPECT_TRUE(MappedMeshEqualsMesh(mappedMesh.GetPointer(), mesh.GetPointer()));
+  ITK_TRY_EXPECT_EXCEPTION(mappedMesh->GetPoint(mesh->GetNumberOfPoints()));
+
+  // Files of the same name in different directories get different entries of the default cache
+  const std::string outputDirectory = itksys::SystemTools::GetFilenamePath(cacheFileName);
+  std::string       defaultCacheFileNames[2];
+  for (unsigned int ii = 0; ii < 2; ++ii)
+  {
+    const std::string directory = outputDirectory + "/itkMZ3MappedMeshTest" + std::to_string(ii);
+    const std::string copyFileName = directory + "/mesh.mz3";
+    itksys::SystemTools::MakeDirectory(directory);
+    itksys::SystemTools::CopyFileAlways(inputMeshFileName, copyFileName);
+    auto defaultMappedMesh = itk::MZ3MappedMesh::New();
+    defaultMappedMesh->SetFileName(copyFileName);
+    ITK_TRY_EXPECT_NO_EXCEPTION(defaultMappedMesh->Open());
+    ITK_TEST_EXPECT_TRUE(MappedMeshEqualsMesh(defaultMappedMesh.GetPointer(), mesh.GetPointer()));
+    defaultCacheFileNames[ii] = defaultMappedMesh->GetMappedFileName();
+    ITK_TEST_EXPECT_TRUE(std::filesystem::path(defaultCacheFileNames[ii]).parent_path() ==
+                         std::filesystem::path(itk::MZ3DecompressedCache::GetDefaultDirectory()));
+    defaultMappedMesh->Close();
+    itksys::SystemTools::RemoveFile(defaultCacheFileNames[ii]);
+  }
+  ITK_TEST_EXPECT_TRUE(defaultCacheFileNames[0] != defaultCacheFileNames[1]);
+
+  // An uncompressed file is mapped directly
+  constexpr bool compress = false;
+  itk::WriteMesh(mesh, rawMeshFileName, compress);
+  mappedMesh->SetFileName(rawMeshFileName);
+  ITK_TRY_EXPECT_NO_EXCEPTION(mappedMesh->Open());
+  ITK_TEST_EXPECT_EQUAL(std::string(mappedMesh->GetMappedFileName()), std::string(rawMeshFileName));
+  ITK_TEST_EXPECT_TRUE(MappedMeshEqualsMesh(mappedMesh.GetPointer(), mesh.GetPointer()));
+  ITK_TEST_EXPECT_EQUAL(mappedMesh->GetNumberOfScalarLayers(), 0);
+
+  mappedMesh->Close();
+  ITK_TEST_EXPECT_TRUE(!mappedMesh->IsOpen());
+  ITK_TEST_EXPECT_TRUE(mappedMesh->GetPoints() == nullptr);
+
+  mappedMesh->SetFileName("NotAFile.mz3");
+  ITK_TRY_EXPECT_EXCEPTION(mappedMesh->Open());
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkMZ3MeshComparator.h"
+
+#include "itkMesh.h"
+#include "itkMeshFileReader.h"
+#include "itkMeshFileWriter.h"
+#include "itkTestingMacros.h"
+
+int
+itkMZ3MeshComparatorTest(int argc, char * argv[])
+{
+  if (argc < 4)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << itkNameOfTestExecutableMacro(argv);
+    std::cerr << " inputMesh";
+    std::cerr << " outputRawMesh";
+    std::cerr << " outputChangedMesh";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+  const char * inputMeshFileName = argv[1];
+  const char * rawMeshFileName = argv[2];
+  const char * changedMeshFileName = argv[3];
+
+  using MeshType = itk::Mesh<float, 3>;
+  const auto mesh = itk::ReadMesh<MeshType>(inputMeshFileName);
+  constexpr bool compress = false;
+  itk::WriteMesh(mesh, rawMeshFileName, compress);
+
+  auto comparator = itk::MZ3MeshComparator::New();
+  ITK_EXERCISE_BASIC_OBJECT_METHODS(comparator, MZ3MeshComparator, Object);
+  ITK_TEST_SET_GET_VALUE(0.0, comparator->GetCoordinateTolerance());
+  ITK_TEST_SET_GET_VALUE(0.0, comparator->GetScalarTolerance());
+
+  // A compressed file and its raw copy hold the same sections
+  comparator->SetBaselineFileName(inputMeshFileName);
+  comparator->SetTestFileName(rawMeshFileName);
+  ITK_TEST_EXPECT_TRUE(comparator->Compare());
+  ITK_TEST_EXPECT_TRUE(!comparator->GetSections().empty());
+  for (const auto & section : comparator->GetSections())
+  {
+    ITK_TEST_EXPECT_EQUAL(section.m_NumberOfDifferences, 0);
+    ITK_TEST_EXPECT_EQUAL(section.m_MaximumError, 0.0);
+  }
+  comparator->PrintReport(std::cout);
+
+  // Move one coordinate of one vertex
+  const MeshType::PointIdentifier changedPoint = mesh->GetNumberOfPoints() / 2;
+  MeshType::PointType             point = mesh->GetPoint(changedPoint);
+  point[1] += 0.25;
+  mesh->SetPoint(changedPoint, point);
+  itk::WriteMesh(mesh, changedMeshFileName, !compress);
+
+  comparator->SetTestFileName(changedMeshFileName);
+  ITK_TEST_EXPECT_TRUE(!comparator->Compare());
+  comparator->PrintReport(std::cout);
+  bool isVerticesReported = false;
+  for (const auto & section : comparator->GetSections())
+  {
+    if (section.m_Name == "Vertices")
+    {
+      isVerticesReported = true;
+      ITK_TEST_EXPECT_EQUAL(section.m_NumberOfValues, 3 * mesh->GetNumberOfPoints());
+      ITK_TEST_EXPECT_EQUAL(section.m_NumberOfDifferences, 1);
+      ITK_TEST_EXPECT_EQUAL(section.m_FirstDifference, 3 * changedPoint + 1);
+      ITK_TEST_EXPECT_TRUE(std::abs(section.m_MaximumError - 0.25) < 1e-3);
+    }
+    else
+    {
+      ITK_TEST_EXPECT_EQUAL(section.m_NumberOfDifferences, 0);
+    }
+  }
+  ITK_TEST_EXPECT_TRUE(isVerticesReported);
+
+  // Within the tolerance, the files match
+  comparator->SetCoordinateTolerance(0.5);
+  ITK_TEST_SET_GET_VALUE(0.5, comparator->GetCoordinateTolerance());
+  ITK_TEST_EXPECT_TRUE(comparator->Compare());
+
+  comparator->SetTestFileName("NotAFile.mz3");
+  ITK_TRY_EXPECT_EXCEPTION(comparator->Compare());
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -25,6 +25,49 @@
 #include "itkTestingMacros.h"
 #include "itkMesh.h"
 #include "itkMeshFileTestHelper.h"
+#include "itkPolygonCell.h"
+#include "itkQuadrilateralCell.h"
+#include "itkTriangleCell.h"
+#include "itksys/SystemTools.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+template <typename TMesh>
+bool
+MeshesAreEqual(const TMesh * mesh, const TMesh * baseline)
+{
+  if (mesh->GetNumberOfPoints() != baseline->GetNumberOfPoints() ||
+      mesh->GetNumberOfCells() != baseline->GetNumberOfCells())
+  {
+    return false;
+  }
+  for (typename TMesh::PointIdentifier id = 0; id < mesh->GetNumberOfPoints(); ++id)
+  {
+    if (mesh->GetPoint(id) != baseline->GetPoint(id))
+    {
+      return false;
+    }
+  }
+  auto baselineCell = baseline->GetCells()->Begin();
+  for (auto cell = mesh->GetCells()->Begin(); cell != mesh->GetCells()->End(); ++cell, ++baselineCell)
+  {
+    if (!std::equal(cell.Value()->PointIdsBegin(),
+                    cell.Value()->PointIdsEnd(),
+                    baselineCell.Value()->PointIdsBegin(),
+                    baselineCell.Value()->PointIdsEnd()))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
 
 int
 itkMZ3MeshIOTest(int argc, char * argv[])
@@ -64,6 +107,9 @@ itkMZ3MeshIOTest(int argc, char * argv[])
 
   ITK_EXERCISE_BASIC_OBJECT_METHODS(mz3MeshIO, MZ3MeshIO, MeshIOBase);
 
+  ITK_TEST_SET_GET_BOOLEAN(mz3MeshIO, UseParallelDecompression, false);
+  ITK_TEST_SET_GET_BOOLEAN(mz3MeshIO, ComputeNormalsAndAreas, false);
+
 
   std::string fileName("NotAMZ3MeshFile.nmz3");
   ITK_TEST_EXPECT_TRUE(!mz3MeshIO->CanWriteFile(fileName.c_str()));
@@ -77,6 +123,731 @@ itkMZ3MeshIOTest(int argc, char * argv[])
   constexpr bool compress = true;
   itk::WriteMesh(inputMesh, outputCompressedMeshFileName, compress);
 
+  // A truncated file fails to read instead of leaving the rest of the buffers unread
+  if (inputMesh->GetNumberOfPoints() > 0 && inputMesh->GetNumberOfCells() > 0)
+  {
+    for (const char * fileName : { outputMeshFileName, outputCompressedMeshFileName })
+    {
+      std::ifstream     input(fileName, std::ios::binary);
+      const std::string bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+      input.close();
+      const std::string truncatedFileName = std::string(fileName) + ".truncated.mz3";
+      std::ofstream(truncatedFileName, std::ios::binary).write(bytes.data(), bytes.size() / 2);
+      auto truncatedMeshIO = itk::MZ3MeshIO::New();
+      truncatedMeshIO->SetFileName(truncatedFileName);
+      const auto readTruncated = [&truncatedMeshIO]() {
+        truncatedMeshIO->ReadMeshInformation();
+        std::vector<float> points(3 * truncatedMeshIO->GetNumberOfPoints());
+        truncatedMeshIO->ReadPoints(points.data());
+        std::vector<uint32_t> cells(truncatedMeshIO->GetCellBufferSize());
+        truncatedMeshIO->ReadCells(cells.data());
+      };
+      ITK_TRY_EXPECT_EXCEPTION(readTruncated());
+      itksys::SystemTools::RemoveFile(truncatedFileName);
+    }
+  }
+
+  // Reading with parallel decompression gives the same mesh
+  mz3MeshIO->UseParallelDecompressionOn();
+  using ReaderType = itk::MeshFileReader<MeshType>;
+  auto reader = ReaderType::New();
+  reader->SetMeshIO(mz3MeshIO);
+  reader->SetFileName(outputCompressedMeshFileName);
+  ITK_TRY_EXPECT_NO_EXCEPTION(reader->Update());
+  ITK_TEST_EXPECT_TRUE(MeshesAreEqual(reader->GetOutput(), inputMesh.GetPointer()));
+
+  // Normals and areas are computed alongside the cells
+  auto normalsMeshIO = itk::MZ3MeshIO::New();
+  normalsMeshIO->ComputeNormalsAndAreasOn();
+  auto normalsReader = ReaderType::New();
+  normalsReader->SetMeshIO(normalsMeshIO);
+  normalsReader->SetFileName(inputMeshFileName);
+  ITK_TRY_EXPECT_NO_EXCEPTION(normalsReader->Update());
+  ITK_TEST_EXPECT_TRUE(MeshesAreEqual(normalsReader->GetOutput(), inputMesh.GetPointer()));
+  if (inputMesh->GetNumberOfCells() > 0)
+  {
+    const auto & faceAreas = normalsMeshIO->GetFaceAreas();
+    const auto & vertexNormals = normalsMeshIO->GetVertexNormals();
+    ITK_TEST_EXPECT_EQUAL(faceAreas.size(), inputMesh->GetNumberOfCells());
+    ITK_TEST_EXPECT_EQUAL(vertexNormals.size(), 3 * inputMesh->GetNumberOfPoints());
+    ITK_TEST_EXPECT_TRUE(std::all_of(faceAreas.begin(), faceAreas.end(), [](float area) { return area >= 0.0f; }));
+    for (size_t ii = 0; ii < vertexNormals.size(); ii += 3)
+    {
+      const float * normal = vertexNormals.data() + ii;
+      const float   length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+      if (length != 0.0f && std::abs(length - 1.0f) > 1e-4f)
+      {
+        std::cerr << "Vertex normal " << ii / 3 << " has length " << length << std::endl;
+        result = EXIT_FAILURE;
+      }
+    }
+  }
+
+  // A right triangle has area 0.5 and normal (0, 0, 1), and a vertex shared with a triangle of
+  // area 1 and normal (0, -1, 0) gets the area weighted average of both normals
+  const uint32_t       knownHeader[4] = { 0x5A4D | (3u << 16), 2, 4, 0 };
+  const uint32_t       knownFaces[6] = { 0, 1, 2, 0, 1, 3 };
+  const float          knownPoints[12] = { 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 2.0f };
+  std::vector<uint8_t> knownBuffer(sizeof(knownHeader) + sizeof(knownFaces) + sizeof(knownPoints));
+  std::memcpy(knownBuffer.data(), knownHeader, sizeof(knownHeader));
+  std::memcpy(knownBuffer.data() + sizeof(knownHeader), knownFaces, sizeof(knownFaces));
+  std::memcpy(knownBuffer.data() + sizeof(knownHeader) + sizeof(knownFaces), knownPoints, sizeof(knownPoints));
+  auto knownMeshIO = itk::MZ3MeshIO::New();
+  knownMeshIO->ComputeNormalsAndAreasOn();
+  knownMeshIO->SetInputBuffer(knownBuffer.data(), knownBuffer.size());
+  auto knownReader = ReaderType::New();
+  knownReader->SetMeshIO(knownMeshIO);
+  knownReader->SetFileName(inputMeshFileName);
+  ITK_TRY_EXPECT_NO_EXCEPTION(knownReader->Update());
+  const auto & knownAreas = knownMeshIO->GetFaceAreas();
+  const auto & knownNormals = knownMeshIO->GetVertexNormals();
+  ITK_TEST_EXPECT_EQUAL(knownAreas.size(), 2);
+  ITK_TEST_EXPECT_EQUAL(knownNormals.size(), 12);
+  if (knownAreas.size() == 2 && knownNormals.size() == 12)
+  {
+    const float sharedNormal[3] = { 0.0f, -2.0f / std::sqrt(5.0f), 1.0f / std::sqrt(5.0f) };
+    const float expectedNormals[12] = { sharedNormal[0], sharedNormal[1], sharedNormal[2],
+                                        sharedNormal[0], sharedNormal[1], sharedNormal[2],
+                                        0.0f,            0.0f,            1.0f,
+                                        0.0f,            -1.0f,           0.0f };
+    ITK_TEST_EXPECT_EQUAL(knownAreas[0], 0.5f);
+    ITK_TEST_EXPECT_EQUAL(knownAreas[1], 1.0f);
+    for (unsigned int ii = 0; ii < 12; ++ii)
+    {
+      if (std::abs(knownNormals[ii] - expectedNormals[ii]) > 1e-6f)
+      {
+        std::cerr << "Normal component " << ii << " is " << knownNormals[ii] << " instead of " << expectedNormals[ii]
+                  << std::endl;
+        result = EXIT_FAILURE;
+      }
+    }
+  }
+
+  // Cells expanded in place give the same mesh, normals and areas
+  auto lowMemoryMeshIO = itk::MZ3MeshIO::New();
+  ITK_TEST_SET_GET_BOOLEAN(lowMemoryMeshIO, LowMemoryReading, false);
+  lowMemoryMeshIO->LowMemoryReadingOn();
+  lowMemoryMeshIO->ComputeNormalsAndAreasOn();
+  auto lowMemoryReader = ReaderType::New();
+  lowMemoryReader->SetMeshIO(lowMemoryMeshIO);
+  lowMemoryReader->SetFileName(inputMeshFileName);
+  ITK_TRY_EXPECT_NO_EXCEPTION(lowMemoryReader->Update());
+  ITK_TEST_EXPECT_TRUE(MeshesAreEqual(lowMemoryReader->GetOutput(), inputMesh.GetPointer()));
+  ITK_TEST_EXPECT_TRUE(lowMemoryMeshIO->GetFaceAreas() == normalsMeshIO->GetFaceAreas());
+  const auto & lowMemoryNormals = lowMemoryMeshIO->GetVertexNormals();
+  const auto & normals = normalsMeshIO->GetVertexNormals();
+  ITK_TEST_EXPECT_EQUAL(lowMemoryNormals.size(), normals.size());
+  for (size_t ii = 0; ii < std::min(lowMemoryNormals.size(), normals.size()); ++ii)
+  {
+    // Normals summed by one work unit may round differently from those summed by several
+    if (std::abs(lowMemoryNormals[ii] - normals[ii]) > 1e-5f)
+    {
+      std::cerr << "Normal component " << ii << " is " << lowMemoryNormals[ii] << " instead of " << normals[ii]
+                << std::endl;
+      result = EXIT_FAILURE;
+    }
+  }
+
+  // Adjacency built from the faces lists every face of a vertex, and its neighbors through them
+  auto adjacencyMeshIO = itk::MZ3MeshIO::New();
+  ITK_TEST_SET_GET_BOOLEAN(adjacencyMeshIO, ComputeAdjacency, false);
+  adjacencyMeshIO->ComputeAdjacencyOn();
+  auto adjacencyReader = ReaderType::New();
+  adjacencyReader->SetMeshIO(adjacencyMeshIO);
+  adjacencyReader->SetFileName(inputMeshFileName);
+  ITK_TRY_EXPECT_NO_EXCEPTION(adjacencyReader->Update());
+  if (inputMesh->GetNumberOfCells() > 0)
+  {
+    const auto & faceOffsets = adjacencyMeshIO->GetVertexFaceOffsets();
+    const auto & vertexFaces = adjacencyMeshIO->GetVertexFaces();
+    const auto & neighborOffsets = adjacencyMeshIO->GetVertexNeighborOffsets();
+    const auto & vertexNeighbors = adjacencyMeshIO->GetVertexNeighbors();
+    ITK_TEST_EXPECT_EQUAL(faceOffsets.size(), inputMesh->GetNumberOfPoints() + 1);
+    ITK_TEST_EXPECT_EQUAL(neighborOffsets.size(), inputMesh->GetNumberOfPoints() + 1);
+    ITK_TEST_EXPECT_EQUAL(vertexFaces.size(), 3 * inputMesh->GetNumberOfCells());
+    for (itk::SizeValueType point = 0; point + 1 < faceOffsets.size(); ++point)
+    {
+      for (auto ii = faceOffsets[point]; ii < faceOffsets[point + 1]; ++ii)
+      {
+        const auto   cell = inputMesh->GetCells()->ElementAt(vertexFaces[ii]);
+        const auto * ids = cell->PointIdsBegin();
+        if (std::find(ids, cell->PointIdsEnd(), point) == cell->PointIdsEnd())
+        {
+          std::cerr << "Face " << vertexFaces[ii] << " does not have vertex " << point << std::endl;
+          result = EXIT_FAILURE;
+        }
+      }
+      ITK_TEST_EXPECT_TRUE(std::is_sorted(vertexNeighbors.begin() + neighborOffsets[point],
+                                          vertexNeighbors.begin() + neighborOffsets[point + 1]));
+    }
+  }
+
+  // Concurrent chunked reads of the uncompressed file, through the page cache and around it
+  for (const bool useDirectIO : { false, true })
+  {
+    auto parallelMeshIO = itk::MZ3MeshIO::New();
+    parallelMeshIO->SetParallelReadMinimumSize(1);
+    ITK_TEST_SET_GET_VALUE(itk::SizeValueType{ 1 }, parallelMeshIO->GetParallelReadMinimumSize());
+    parallelMeshIO->SetUseDirectIO(useDirectIO);
+    ITK_TEST_SET_GET_VALUE(useDirectIO, parallelMeshIO->GetUseDirectIO());
+    auto parallelReader = ReaderType::New();
+    parallelReader->SetMeshIO(parallelMeshIO);
+    parallelReader->SetFileName(outputMeshFileName);
+    ITK_TRY_EXPECT_NO_EXCEPTION(parallelReader->Update());
+    ITK_TEST_EXPECT_TRUE(MeshesAreEqual(parallelReader->GetOutput(), inputMesh.GetPointer()));
+  }
+
+  // A vertex section of more than two 8 MiB chunks, which starts and ends inside a chunk, is read
+  // concurrently as it is read sequentially
+  auto largeMesh = MeshType::New();
+  constexpr itk::SizeValueType numberOfLargePoints = 1500000;
+  largeMesh->GetPoints()->Reserve(numberOfLargePoints);
+  for (itk::SizeValueType ii = 0; ii < numberOfLargePoints; ++ii)
+  {
+    MeshType::PointType point;
+    point[0] = static_cast<float>(ii);
+    point[1] = static_cast<float>(ii % 7);
+    point[2] = static_cast<float>(ii % 13);
+    largeMesh->SetPoint(ii, point);
+  }
+  MeshType::CellAutoPointer largeCell;
+  largeCell.TakeOwnership(new itk::TriangleCell<MeshType::CellType>);
+  largeCell->SetPointId(0, 0);
+  largeCell->SetPointId(1, 1);
+  largeCell->SetPointId(2, numberOfLargePoints - 1);
+  largeMesh->SetCell(0, largeCell);
+  const std::string largeFileName = std::string(outputMeshFileName) + ".large.mz3";
+  ITK_TRY_EXPECT_NO_EXCEPTION(itk::WriteMesh(largeMesh, largeFileName, false));
+  auto sequentialLargeMeshIO = itk::MZ3MeshIO::New();
+  sequentialLargeMeshIO->SetParallelReadMinimumSize(0);
+  auto sequentialLargeReader = ReaderType::New();
+  sequentialLargeReader->SetMeshIO(sequentialLargeMeshIO);
+  sequentialLargeReader->SetFileName(largeFileName);
+  ITK_TRY_EXPECT_NO_EXCEPTION(sequentialLargeReader->Update());
+  ITK_TEST_EXPECT_TRUE(MeshesAreEqual(sequentialLargeReader->GetOutput(), largeMesh.GetPointer()));
+  for (const bool useDirectIO : { false, true })
+  {
+    auto parallelMeshIO = itk::MZ3MeshIO::New();
+    parallelMeshIO->SetParallelReadMinimumSize(1);
+    parallelMeshIO->SetUseDirectIO(useDirectIO);
+    auto parallelReader = ReaderType::New();
+    parallelReader->SetMeshIO(parallelMeshIO);
+    parallelReader->SetFileName(largeFileName);
+    ITK_TRY_EXPECT_NO_EXCEPTION(parallelReader->Update());
+    ITK_TEST_EXPECT_TRUE(MeshesAreEqual(parallelReader->GetOutput(), sequentialLargeReader->GetOutput()));
+  }
+  itksys::SystemTools::RemoveFile(largeFileName);
+
+  // Buffers placed by first touch or interleaved, on huge pages, read back to the same mesh
+  for (const auto placement : { itk::MZ3MeshIO::MemoryPlacementEnum::FirstTouch,
+                                itk::MZ3MeshIO::MemoryPlacementEnum::Interleaved })
+  {
+    auto placedMeshIO = itk::MZ3MeshIO::New();
+    placedMeshIO->SetMemoryPlacement(placement);
+    ITK_TEST_SET_GET_VALUE(placement, placedMeshIO->GetMemoryPlacement());
+    ITK_TEST_SET_GET_BOOLEAN(placedMeshIO, UseHugePages, false);
+    placedMeshIO->UseHugePagesOn();
+    placedMeshIO->UseParallelDecompressionOn();
+    for (const char * fileName : { outputMeshFileName, outputCompressedMeshFileName })
+    {
+      auto placedReader = ReaderType::New();
+      placedReader->SetMeshIO(placedMeshIO);
+      placedReader->SetFileName(fileName);
+      ITK_TRY_EXPECT_NO_EXCEPTION(placedReader->Update());
+      ITK_TEST_EXPECT_TRUE(MeshesAreEqual(placedReader->GetOutput(), inputMesh.GetPointer()));
+    }
+  }
+
+  // A reflection negates the coordinates and reverses the winding as the mesh is read, and
+  // reflecting it again as it is written gives back the same mesh
+  auto transformMeshIO = itk::MZ3MeshIO::New();
+  auto reflection = transformMeshIO->GetPointTransform();
+  reflection[0][0] = -1.0;
+  transformMeshIO->SetPointTransform(reflection);
+  ITK_TEST_EXPECT_EQUAL(transformMeshIO->GetPointTransform()[0][0], -1.0);
+  auto transformReader = ReaderType::New();
+  transformReader->SetMeshIO(transformMeshIO);
+  transformReader->SetFileName(outputCompressedMeshFileName);
+  ITK_TRY_EXPECT_NO_EXCEPTION(transformReader->Update());
+  const MeshType * reflectedMesh = transformReader->GetOutput();
+  ITK_TEST_EXPECT_EQUAL(reflectedMesh->GetNumberOfPoints(), inputMesh->GetNumberOfPoints());
+  if (inputMesh->GetNumberOfCells() > 0)
+  {
+    ITK_TEST_EXPECT_EQUAL(reflectedMesh->GetPoint(0)[0], -inputMesh->GetPoint(0)[0]);
+    ITK_TEST_EXPECT_EQUAL(reflectedMesh->GetPoint(0)[1], inputMesh->GetPoint(0)[1]);
+    const auto reflectedIds = reflectedMesh->GetCells()->ElementAt(0)->PointIdsBegin();
+    const auto ids = inputMesh->GetCells()->ElementAt(0)->PointIdsBegin();
+    ITK_TEST_EXPECT_EQUAL(reflectedIds[1], ids[2]);
+    ITK_TEST_EXPECT_EQUAL(reflectedIds[2], ids[1]);
+  }
+  auto transformWriter = itk::MeshFileWriter<MeshType>::New();
+  transformWriter->SetMeshIO(transformMeshIO);
+  transformWriter->SetInput(reflectedMesh);
+  transformWriter->SetFileName(outputMeshFileName);
+  ITK_TRY_EXPECT_NO_EXCEPTION(transformWriter->Update());
+  const auto unreflectedMesh = itk::ReadMesh<MeshType>(outputMeshFileName);
+  ITK_TEST_EXPECT_TRUE(MeshesAreEqual(unreflectedMesh.GetPointer(), inputMesh.GetPointer()));
+  reflection[3][0] = 1.0;
+  ITK_TRY_EXPECT_EXCEPTION(transformMeshIO->SetPointTransform(reflection));
+
+  // Reading from memory gives the same mesh, for both raw and compressed data
+  for (const char * fileName : { inputMeshFileName, outputCompressedMeshFileName })
+  {
+    std::ifstream     file(fileName, std::ios::binary);
+    std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    auto              bufferMeshIO = itk::MZ3MeshIO::New();
+    bufferMeshIO->SetInputBuffer(contents.data(), contents.size());
+    auto bufferReader = ReaderType::New();
+    bufferReader->SetMeshIO(bufferMeshIO);
+    bufferReader->SetFileName("NotOnDisk.mz3");
+    ITK_TRY_EXPECT_NO_EXCEPTION(bufferReader->Update());
+    ITK_TEST_EXPECT_TRUE(MeshesAreEqual(bufferReader->GetOutput(), inputMesh.GetPointer()));
+  }
+
+  // Writing to memory gives the same bytes as the file, which read back to the same mesh
+  for (const bool useCompression : { false, true })
+  {
+    std::vector<uint8_t> contents;
+    auto                 bufferMeshIO = itk::MZ3MeshIO::New();
+    bufferMeshIO->SetOutputBuffer(&contents);
+    auto bufferWriter = itk::MeshFileWriter<MeshType>::New();
+    bufferWriter->SetMeshIO(bufferMeshIO);
+    bufferWriter->SetInput(inputMesh);
+    bufferWriter->SetFileName("NotOnDisk.mz3");
+    bufferWriter->SetUseCompression(useCompression);
+    ITK_TRY_EXPECT_NO_EXCEPTION(bufferWriter->Update());
+    ITK_TEST_EXPECT_TRUE(!itksys::SystemTools::FileExists("NotOnDisk.mz3"));
+
+    bufferMeshIO->SetOutputBuffer(nullptr);
+    bufferMeshIO->SetInputBuffer(contents.data(), contents.size());
+    auto bufferReader = ReaderType::New();
+    bufferReader->SetMeshIO(bufferMeshIO);
+    bufferReader->SetFileName("NotOnDisk.mz3");
+    ITK_TRY_EXPECT_NO_EXCEPTION(bufferReader->Update());
+    ITK_TEST_EXPECT_TRUE(MeshesAreEqual(bufferReader->GetOutput(), inputMesh.GetPointer()));
+  }
+
+  // Quadrilaterals and polygons are written as triangles
+  for (const bool splitQuads : { false, true })
+  {
+    auto polygonMesh = MeshType::New();
+    for (unsigned int ii = 0; ii < 6; ++ii)
+    {
+      MeshType::PointType point;
+      point[0] = static_cast<float>(ii % 3) + (ii < 3 ? 0.0f : 0.7f);
+      point[1] = static_cast<float>(ii / 3);
+      point[2] = 0.0f;
+      polygonMesh->SetPoint(ii, point);
+    }
+    using CellAutoPointer = MeshType::CellType::CellAutoPointer;
+    CellAutoPointer quad;
+    quad.TakeOwnership(new itk::QuadrilateralCell<MeshType::CellType>);
+    const MeshType::PointIdentifier quadIds[4] = { 0, 1, 4, 3 };
+    quad->SetPointIds(quadIds);
+    polygonMesh->SetCell(0, quad);
+    CellAutoPointer polygon;
+    polygon.TakeOwnership(new itk::PolygonCell<MeshType::CellType>);
+    const MeshType::PointIdentifier polygonIds[5] = { 1, 2, 5, 4, 3 };
+    polygon->SetPointIds(polygonIds, polygonIds + 5);
+    polygonMesh->SetCell(1, polygon);
+
+    auto polygonMeshIO = itk::MZ3MeshIO::New();
+    ITK_TEST_SET_GET_BOOLEAN(polygonMeshIO, SplitQuadsAlongShortestDiagonal, false);
+    polygonMeshIO->SetSplitQuadsAlongShortestDiagonal(splitQuads);
+    auto polygonWriter = itk::MeshFileWriter<MeshType>::New();
+    polygonWriter->SetMeshIO(polygonMeshIO);
+    polygonWriter->SetInput(polygonMesh);
+    polygonWriter->SetFileName(outputMeshFileName);
+    ITK_TRY_EXPECT_NO_EXCEPTION(polygonWriter->Update());
+
+    const auto triangleMesh = itk::ReadMesh<MeshType>(outputMeshFileName);
+    ITK_TEST_EXPECT_EQUAL(triangleMesh->GetNumberOfCells(), 5);
+    // The diagonal from point 1 to point 3 is the shorter one
+    const std::vector<MeshType::PointIdentifier> expectedIds =
+      splitQuads ? std::vector<MeshType::PointIdentifier>{ 0, 1, 3, 1, 4, 3, 1, 2, 5, 1, 5, 4, 1, 4, 3 }
+                 : std::vector<MeshType::PointIdentifier>{ 0, 1, 4, 0, 4, 3, 1, 2, 5, 1, 5, 4, 1, 4, 3 };
+    std::vector<MeshType::PointIdentifier> ids;
+    for (auto cell = triangleMesh->GetCells()->Begin(); cell != triangleMesh->GetCells()->End(); ++cell)
+    {
+      ids.insert(ids.end(), cell.Value()->PointIdsBegin(), cell.Value()->PointIdsEnd());
+    }
+    ITK_TEST_EXPECT_TRUE(ids == expectedIds);
+  }
+
+  // Preallocated files written in concurrent chunks and flushed to disk read back to the same mesh
+  {
+    auto syncMeshIO = itk::MZ3MeshIO::New();
+    syncMeshIO->SetParallelWriteMinimumSize(1);
+    ITK_TEST_SET_GET_VALUE(itk::SizeValueType{ 1 }, syncMeshIO->GetParallelWriteMinimumSize());
+    syncMeshIO->SetDurability(itk::MZ3MeshIO::DurabilityEnum::Sync);
+    ITK_TEST_SET_GET_VALUE(itk::MZ3MeshIO::DurabilityEnum::Sync, syncMeshIO->GetDurability());
+    auto syncWriter = itk::MeshFileWriter<MeshType>::New();
+    syncWriter->SetMeshIO(syncMeshIO);
+    syncWriter->SetInput(inputMesh);
+    syncWriter->SetFileName(outputMeshFileName);
+    ITK_TRY_EXPECT_NO_EXCEPTION(syncWriter->Update());
+    const auto syncMesh = itk::ReadMesh<MeshType>(outputMeshFileName);
+    ITK_TEST_EXPECT_TRUE(MeshesAreEqual(syncMesh.GetPointer(), inputMesh.GetPointer()));
+  }
+
+  // A summary stored in the skip region is read back from raw and compressed files
+  for (const bool compressSummary : { false, true })
+  {
+    const char * fileName = compressSummary ? outputCompressedMeshFileName : outputMeshFileName;
+    auto         summaryMeshIO = itk::MZ3MeshIO::New();
+    ITK_TEST_SET_GET_BOOLEAN(summaryMeshIO, WriteSummary, false);
+    summaryMeshIO->SetNumberOfSummaryHistogramBins(8);
+    ITK_TEST_SET_GET_VALUE(8u, summaryMeshIO->GetNumberOfSummaryHistogramBins());
+    summaryMeshIO->WriteSummaryOn();
+    auto summaryWriter = itk::MeshFileWriter<MeshType>::New();
+    summaryWriter->SetMeshIO(summaryMeshIO);
+    summaryWriter->SetInput(inputMesh);
+    summaryWriter->SetFileName(fileName);
+    summaryWriter->SetUseCompression(compressSummary);
+    ITK_TRY_EXPECT_NO_EXCEPTION(summaryWriter->Update());
+
+    auto summaryReaderMeshIO = itk::MZ3MeshIO::New();
+    auto summaryReader = itk::MeshFileReader<MeshType>::New();
+    summaryReader->SetMeshIO(summaryReaderMeshIO);
+    summaryReader->SetFileName(fileName);
+    ITK_TRY_EXPECT_NO_EXCEPTION(summaryReader->Update());
+    ITK_TEST_EXPECT_TRUE(MeshesAreEqual(summaryReader->GetOutput(), inputMesh.GetPointer()));
+    const itk::MZ3MeshIO::Summary * summary = summaryReaderMeshIO->GetSummary();
+    ITK_TEST_EXPECT_TRUE(summary != nullptr);
+    if (summary != nullptr && inputMesh->GetNumberOfPoints() > 0)
+    {
+      const auto bounds = inputMesh->GetBoundingBox()->GetBounds();
+      for (unsigned int i = 0; i < 6; ++i)
+      {
+        ITK_TEST_EXPECT_EQUAL(summary->m_Bounds[i], static_cast<float>(bounds[i]));
+      }
+      ITK_TEST_EXPECT_EQUAL(summary->m_VertexSectionSize, 12 * inputMesh->GetNumberOfPoints());
+      itk::MZ3MeshIO::Summary fileSummary;
+      ITK_TEST_EXPECT_TRUE(itk::MZ3MeshIO::ReadSummary(fileName, fileSummary));
+      ITK_TEST_EXPECT_EQUAL(fileSummary.m_VertexChecksum, summary->m_VertexChecksum);
+      ITK_TEST_EXPECT_EQUAL(fileSummary.m_FaceChecksum, summary->m_FaceChecksum);
+    }
+  }
+  {
+    // Counts whose payload size wraps around to a small value are rejected without allocating
+    const std::string corruptSummaryFileName = std::string(outputMeshFileName) + ".summary.mz3";
+    std::ifstream     summaryInput(outputMeshFileName, std::ios::binary);
+    std::string       bytes((std::istreambuf_iterator<char>(summaryInput)), std::istreambuf_iterator<char>());
+    summaryInput.close();
+    const std::string::size_type tag = bytes.find("SUMM");
+    ITK_TEST_EXPECT_TRUE(tag != std::string::npos);
+    if (tag != std::string::npos)
+    {
+      const uint32_t counts[2] = { 0x40000000u, 0xFFFFFFFCu };
+      std::memcpy(&bytes[tag + 8 + 64], counts, sizeof(counts));
+      std::ofstream(corruptSummaryFileName, std::ios::binary).write(bytes.data(), bytes.size());
+      itk::MZ3MeshIO::Summary corruptSummary;
+      ITK_TEST_EXPECT_TRUE(!itk::MZ3MeshIO::ReadSummary(corruptSummaryFileName, corruptSummary));
+      itksys::SystemTools::RemoveFile(corruptSummaryFileName);
+    }
+  }
+  itk::MZ3MeshIO::Summary noSummary;
+  ITK_TEST_EXPECT_TRUE(!itk::MZ3MeshIO::ReadSummary(inputMeshFileName, noSummary));
+  ITK_TEST_EXPECT_TRUE(normalsMeshIO->GetSummary() == nullptr);
+
+  // Scalar layers appended to raw and compressed files leave the geometry intact
+  const std::vector<float> layers(2 * inputMesh->GetNumberOfPoints(), 7.0f);
+  for (const char * fileName : { outputMeshFileName, outputCompressedMeshFileName })
+  {
+    if (inputMesh->GetNumberOfPoints() == 0)
+    {
+      break;
+    }
+    ITK_TRY_EXPECT_NO_EXCEPTION(itk::MZ3MeshIO::AppendScalarLayers(fileName, layers.data(), 2));
+    const auto appendedMesh = itk::ReadMesh<MeshType>(fileName);
+    ITK_TEST_EXPECT_TRUE(MeshesAreEqual(appendedMesh.GetPointer(), inputMesh.GetPointer()));
+    ITK_TEST_EXPECT_EQUAL(appendedMesh->GetPointData()->Size(), inputMesh->GetNumberOfPoints());
+    if (inputMesh->GetPointData() == nullptr || inputMesh->GetPointData()->Size() == 0)
+    {
+      ITK_TEST_EXPECT_EQUAL(appendedMesh->GetPointData()->ElementAt(0), 7.0f);
+    }
+  }
+  ITK_TRY_EXPECT_EXCEPTION(itk::MZ3MeshIO::AppendScalarLayers("NotAFile.mz3", layers.data(), 1));
+
+  // A partial layer left by an interrupted append is ignored, and overwritten by the next append
+  if (inputMesh->GetNumberOfPoints() > 0)
+  {
+    const auto wholeSize = itksys::SystemTools::FileLength(outputMeshFileName);
+    {
+      std::ofstream tornFile(outputMeshFileName, std::ios::binary | std::ios::app);
+      tornFile.write(reinterpret_cast<const char *>(layers.data()), 3);
+    }
+    const auto tornMesh = itk::ReadMesh<MeshType>(outputMeshFileName);
+    ITK_TEST_EXPECT_TRUE(MeshesAreEqual(tornMesh.GetPointer(), inputMesh.GetPointer()));
+    ITK_TRY_EXPECT_NO_EXCEPTION(itk::MZ3MeshIO::AppendScalarLayers(outputMeshFileName, layers.data(), 1));
+    ITK_TEST_EXPECT_EQUAL(itksys::SystemTools::FileLength(outputMeshFileName),
+                          wholeSize + 4 * inputMesh->GetNumberOfPoints());
+  }
+
+  // Faces ordered into spatial chunks keep the surface, and regions read only the chunks they overlap
+  for (const bool compressChunks : { false, true })
+  {
+    const char * fileName = compressChunks ? outputCompressedMeshFileName : outputMeshFileName;
+    auto         chunkMeshIO = itk::MZ3MeshIO::New();
+    ITK_TEST_SET_GET_BOOLEAN(chunkMeshIO, WriteSpatialChunks, false);
+    chunkMeshIO->SetMaximumFacesPerSpatialChunk(1000);
+    ITK_TEST_SET_GET_VALUE(itk::SizeValueType{ 1000 }, chunkMeshIO->GetMaximumFacesPerSpatialChunk());
+    chunkMeshIO->WriteSpatialChunksOn();
+    auto chunkWriter = itk::MeshFileWriter<MeshType>::New();
+    chunkWriter->SetMeshIO(chunkMeshIO);
+    chunkWriter->SetInput(inputMesh);
+    chunkWriter->SetFileName(fileName);
+    chunkWriter->SetUseCompression(compressChunks);
+    ITK_TRY_EXPECT_NO_EXCEPTION(chunkWriter->Update());
+
+    auto chunkReaderMeshIO = itk::MZ3MeshIO::New();
+    auto chunkReader = itk::MeshFileReader<MeshType>::New();
+    chunkReader->SetMeshIO(chunkReaderMeshIO);
+    chunkReader->SetFileName(fileName);
+    ITK_TRY_EXPECT_NO_EXCEPTION(chunkReader->Update());
+    const MeshType * chunkMesh = chunkReader->GetOutput();
+    ITK_TEST_EXPECT_EQUAL(chunkMesh->GetNumberOfPoints(), inputMesh->GetNumberOfPoints());
+    ITK_TEST_EXPECT_EQUAL(chunkMesh->GetNumberOfCells(), inputMesh->GetNumberOfCells());
+    const auto &       chunks = chunkReaderMeshIO->GetSpatialChunks();
+    itk::SizeValueType numberOfFaces = 0;
+    for (const auto & chunk : chunks)
+    {
+      ITK_TEST_EXPECT_EQUAL(chunk.m_FirstFace, numberOfFaces);
+      ITK_TEST_EXPECT_TRUE(chunk.m_NumberOfFaces <= 1000);
+      numberOfFaces += chunk.m_NumberOfFaces;
+    }
+    ITK_TEST_EXPECT_EQUAL(numberOfFaces, inputMesh->GetNumberOfCells());
+    if (chunks.size() < 2)
+    {
+      continue;
+    }
+
+    // The bounds of all chunks select every face, and the bounds of one chunk fewer faces
+    constexpr float            everywhere[6] = { -1e30f, 1e30f, -1e30f, 1e30f, -1e30f, 1e30f };
+    itk::MZ3MeshIO::RegionMesh region;
+    chunkReaderMeshIO->ReadRegionInBox(everywhere, region);
+    ITK_TEST_EXPECT_EQUAL(region.m_Faces.size(), 3 * inputMesh->GetNumberOfCells());
+    ITK_TEST_EXPECT_EQUAL(region.m_Points.size(), 3 * region.m_PointIds.size());
+    for (itk::SizeValueType ii = 0; ii < region.m_PointIds.size(); ++ii)
+    {
+      const auto point = chunkMesh->GetPoint(region.m_PointIds[ii]);
+      ITK_TEST_EXPECT_EQUAL(region.m_Points[3 * ii], point[0]);
+    }
+    chunkReaderMeshIO->ReadRegionInBox(chunks[0].m_Bounds, region);
+    ITK_TEST_EXPECT_TRUE(!region.m_Faces.empty() && region.m_Faces.size() < 3 * inputMesh->GetNumberOfCells());
+    const float center[3] = { chunks[0].m_Bounds[0], chunks[0].m_Bounds[2], chunks[0].m_Bounds[4] };
+    chunkReaderMeshIO->ReadRegionInSphere(center, 0.0f, region);
+    ITK_TEST_EXPECT_TRUE(!region.m_Faces.empty());
+  }
+
+  // Levels of detail are written next to the file, with fewer points at every level, and are
+  // read directly by their level
+  auto lodMeshIO = itk::MZ3MeshIO::New();
+  ITK_TRY_EXPECT_EXCEPTION(lodMeshIO->SetLevelOfDetailFractions({ 0.5, 1.0 }));
+  lodMeshIO->SetLevelOfDetailFractions({ 0.25, 0.06 });
+  ITK_TEST_EXPECT_EQUAL(lodMeshIO->GetLevelOfDetailFractions().size(), 2);
+  auto lodWriter = itk::MeshFileWriter<MeshType>::New();
+  lodWriter->SetMeshIO(lodMeshIO);
+  lodWriter->SetInput(inputMesh);
+  lodWriter->SetFileName(outputCompressedMeshFileName);
+  lodWriter->SetUseCompression(true);
+  ITK_TRY_EXPECT_NO_EXCEPTION(lodWriter->Update());
+  itk::SizeValueType previousNumberOfPoints = inputMesh->GetNumberOfPoints();
+  for (unsigned int level = 0; level < 3 && inputMesh->GetNumberOfCells() > 0; ++level)
+  {
+    auto lodReaderMeshIO = itk::MZ3MeshIO::New();
+    lodReaderMeshIO->SetLevelOfDetail(level);
+    ITK_TEST_SET_GET_VALUE(level, lodReaderMeshIO->GetLevelOfDetail());
+    auto lodReader = itk::MeshFileReader<MeshType>::New();
+    lodReader->SetMeshIO(lodReaderMeshIO);
+    lodReader->SetFileName(outputCompressedMeshFileName);
+    ITK_TRY_EXPECT_NO_EXCEPTION(lodReader->Update());
+    const MeshType * lodMesh = lodReader->GetOutput();
+    if (level == 0)
+    {
+      ITK_TEST_EXPECT_TRUE(MeshesAreEqual(lodMesh, inputMesh.GetPointer()));
+      continue;
+    }
+    ITK_TEST_EXPECT_TRUE(lodMesh->GetNumberOfPoints() < previousNumberOfPoints);
+    ITK_TEST_EXPECT_TRUE(lodMesh->GetNumberOfCells() > 0);
+    previousNumberOfPoints = lodMesh->GetNumberOfPoints();
+  }
+  ITK_TEST_EXPECT_EQUAL(itk::MZ3MeshIO::GetLevelOfDetailFileName("mesh.mz3", 2), std::string("mesh_lod2.mz3"));
+  ITK_TEST_EXPECT_EQUAL(itk::MZ3MeshIO::GetLevelOfDetailFileName("atlas.mz3a:mesh", 1),
+                        std::string("atlas.mz3a:mesh_lod1"));
+
+  // Sections are written in chunks that report progress, and an aborted write leaves no file
+  auto progressMeshIO = itk::MZ3MeshIO::New();
+  progressMeshIO->SetSectionChunkSize(4096);
+  ITK_TEST_SET_GET_VALUE(itk::SizeValueType{ 4096 }, progressMeshIO->GetSectionChunkSize());
+  unsigned int numberOfProgressEvents = 0;
+  progressMeshIO->AddObserver(itk::ProgressEvent(),
+                              [&numberOfProgressEvents](const itk::EventObject &) { ++numberOfProgressEvents; });
+  auto progressWriter = itk::MeshFileWriter<MeshType>::New();
+  progressWriter->SetMeshIO(progressMeshIO);
+  progressWriter->SetInput(inputMesh);
+  progressWriter->SetFileName(outputMeshFileName);
+  progressWriter->SetUseCompression(false);
+  ITK_TRY_EXPECT_NO_EXCEPTION(progressWriter->Update());
+  ITK_TEST_EXPECT_TRUE(numberOfProgressEvents > 0);
+  ITK_TEST_EXPECT_EQUAL(progressMeshIO->GetNumberOfBytesProcessed(), progressMeshIO->GetNumberOfBytesToProcess());
+  ITK_TEST_EXPECT_EQUAL(progressMeshIO->GetProgress(), 1.0f);
+
+  const std::string abortedFileName = std::string(outputMeshFileName) + ".aborted.mz3";
+  progressMeshIO->AddObserver(itk::ProgressEvent(),
+                              [&progressMeshIO](const itk::EventObject &) { progressMeshIO->AbortGenerateDataOn(); });
+  progressWriter->SetFileName(abortedFileName);
+  ITK_TRY_EXPECT_EXCEPTION(progressWriter->Update());
+  ITK_TEST_EXPECT_TRUE(!itksys::SystemTools::FileExists(abortedFileName));
+
+  // Reads report every byte once, also when the geometry cache hashes the sections or finds
+  // them, and an aborted read throws ProcessAborted
+  for (const bool useGeometryCache : { false, true, true })
+  {
+    auto progressReaderMeshIO = itk::MZ3MeshIO::New();
+    progressReaderMeshIO->SetSectionChunkSize(4096);
+    progressReaderMeshIO->SetUseGeometryCache(useGeometryCache);
+    auto progressReader = itk::MeshFileReader<MeshType>::New();
+    progressReader->SetMeshIO(progressReaderMeshIO);
+    progressReader->SetFileName(outputMeshFileName);
+    ITK_TRY_EXPECT_NO_EXCEPTION(progressReader->Update());
+    ITK_TEST_EXPECT_EQUAL(progressReaderMeshIO->GetNumberOfBytesProcessed(),
+                          progressReaderMeshIO->GetNumberOfBytesToProcess());
+  }
+  if (inputMesh->GetNumberOfPoints() > 0 && inputMesh->GetNumberOfCells() > 0)
+  {
+    auto abortedReaderMeshIO = itk::MZ3MeshIO::New();
+    abortedReaderMeshIO->SetSectionChunkSize(4096);
+    abortedReaderMeshIO->SetFileName(outputMeshFileName);
+    abortedReaderMeshIO->AddObserver(itk::ProgressEvent(), [&abortedReaderMeshIO](const itk::EventObject &) {
+      abortedReaderMeshIO->AbortGenerateDataOn();
+    });
+    bool isAborted = false;
+    try
+    {
+      abortedReaderMeshIO->ReadMeshInformation();
+      std::vector<float> abortedPoints(3 * abortedReaderMeshIO->GetNumberOfPoints());
+      abortedReaderMeshIO->ReadPoints(abortedPoints.data());
+    }
+    catch (const itk::ProcessAborted &)
+    {
+      isAborted = true;
+    }
+    ITK_TEST_EXPECT_TRUE(isAborted);
+    ITK_TEST_EXPECT_TRUE(abortedReaderMeshIO->GetNumberOfBytesProcessed() <
+                         abortedReaderMeshIO->GetNumberOfBytesToProcess());
+  }
+
+  // An aborted write also removes the levels of detail of the file, and a level archive that
+  // fails to be written leaves the complete mesh
+  if (inputMesh->GetNumberOfCells() > 0)
+  {
+    const std::string abortedLevelFileName = itk::MZ3MeshIO::GetLevelOfDetailFileName(abortedFileName, 1);
+    auto              abortedLevelMeshIO = itk::MZ3MeshIO::New();
+    abortedLevelMeshIO->SetSectionChunkSize(4096);
+    abortedLevelMeshIO->SetLevelOfDetailFractions({ 0.25 });
+    auto abortedLevelWriter = itk::MeshFileWriter<MeshType>::New();
+    abortedLevelWriter->SetMeshIO(abortedLevelMeshIO);
+    abortedLevelWriter->SetInput(inputMesh);
+    abortedLevelWriter->SetFileName(abortedFileName);
+    abortedLevelWriter->SetUseCompression(false);
+    ITK_TRY_EXPECT_NO_EXCEPTION(abortedLevelWriter->Update());
+    ITK_TEST_EXPECT_TRUE(itksys::SystemTools::FileExists(abortedLevelFileName));
+    abortedLevelMeshIO->AddObserver(itk::ProgressEvent(), [&abortedLevelMeshIO](const itk::EventObject &) {
+      abortedLevelMeshIO->AbortGenerateDataOn();
+    });
+    ITK_TRY_EXPECT_EXCEPTION(abortedLevelWriter->Update());
+    ITK_TEST_EXPECT_TRUE(!itksys::SystemTools::FileExists(abortedFileName));
+    ITK_TEST_EXPECT_TRUE(!itksys::SystemTools::FileExists(abortedLevelFileName));
+
+    auto failedLevelMeshIO = itk::MZ3MeshIO::New();
+    failedLevelMeshIO->SetLevelOfDetailFractions({ 0.25 });
+    failedLevelMeshIO->SetLevelOfDetailArchiveFileName(abortedFileName + ".missing/levels.mz3a");
+    abortedLevelWriter->SetMeshIO(failedLevelMeshIO);
+    ITK_TRY_EXPECT_EXCEPTION(abortedLevelWriter->Update());
+    ITK_TEST_EXPECT_TRUE(itksys::SystemTools::FileExists(abortedFileName));
+    ITK_TEST_EXPECT_TRUE(!itksys::SystemTools::FileExists(abortedFileName + ".missing/levels.mz3a"));
+    itksys::SystemTools::RemoveFile(abortedFileName);
+  }
+
+  // A write that fails once its file is open removes the file, and an aborted read by the same
+  // object after failed writes keeps its input
+  if (inputMesh->GetNumberOfPoints() > 0)
+  {
+    const std::string failedFileName = std::string(outputMeshFileName) + ".failed.mz3";
+    auto              failedMeshIO = itk::MZ3MeshIO::New();
+    failedMeshIO->SetFileName(failedFileName);
+    failedMeshIO->SetUseCompression(false);
+    failedMeshIO->SetPointComponentType(itk::IOComponentEnum::INT);
+    failedMeshIO->SetNumberOfPoints(3);
+    ITK_TRY_EXPECT_NO_EXCEPTION(failedMeshIO->WriteMeshInformation());
+    ITK_TEST_EXPECT_TRUE(itksys::SystemTools::FileExists(failedFileName));
+    int failedPoints[9] = {};
+    ITK_TRY_EXPECT_EXCEPTION(failedMeshIO->WritePoints(static_cast<void *>(failedPoints)));
+    ITK_TEST_EXPECT_TRUE(!itksys::SystemTools::FileExists(failedFileName));
+
+    failedMeshIO->SetFileName(failedFileName + ".missing/mesh.mz3");
+    ITK_TRY_EXPECT_EXCEPTION(failedMeshIO->WriteMeshInformation());
+    failedMeshIO->SetFileName(outputMeshFileName);
+    failedMeshIO->SetSectionChunkSize(4096);
+    failedMeshIO->AddObserver(itk::ProgressEvent(),
+                              [&failedMeshIO](const itk::EventObject &) { failedMeshIO->AbortGenerateDataOn(); });
+    bool isAborted = false;
+    try
+    {
+      failedMeshIO->ReadMeshInformation();
+      std::vector<float> abortedPoints(3 * failedMeshIO->GetNumberOfPoints());
+      failedMeshIO->ReadPoints(abortedPoints.data());
+    }
+    catch (const itk::ProcessAborted &)
+    {
+      isAborted = true;
+    }
+    ITK_TEST_EXPECT_TRUE(isAborted);
+    ITK_TEST_EXPECT_TRUE(itksys::SystemTools::FileExists(outputMeshFileName));
+  }
+
+  // A scalar-only map leaves out the geometry, and pairs with the geometry as its point data
+  auto mapMesh = MeshType::New();
+  mapMesh->SetPoints(inputMesh->GetPoints());
+  for (itk::SizeValueType ii = 0; ii < inputMesh->GetNumberOfPoints(); ++ii)
+  {
+    mapMesh->SetPointData(ii, 0.5f * ii);
+  }
+  const std::string mapFileName = std::string(outputMeshFileName) + ".map.mz3";
+  auto              mapMeshIO = itk::MZ3MeshIO::New();
+  ITK_TEST_SET_GET_BOOLEAN(mapMeshIO, WriteScalarsOnly, false);
+  mapMeshIO->WriteScalarsOnlyOn();
+  auto mapWriter = itk::MeshFileWriter<MeshType>::New();
+  mapWriter->SetMeshIO(mapMeshIO);
+  mapWriter->SetInput(inputMesh);
+  mapWriter->SetFileName(mapFileName);
+  mapWriter->SetUseCompression(false);
+  if (inputMesh->GetNumberOfPoints() > 0)
+  {
+    ITK_TRY_EXPECT_EXCEPTION(mapWriter->Update());
+    mapWriter->SetInput(mapMesh);
+    ITK_TRY_EXPECT_NO_EXCEPTION(mapWriter->Update());
+    ITK_TEST_EXPECT_EQUAL(itksys::SystemTools::FileLength(mapFileName), 16 + 4 * inputMesh->GetNumberOfPoints());
+
+    auto pairedMeshIO = itk::MZ3MeshIO::New();
+    pairedMeshIO->SetPointDataFileName(mapFileName);
+    ITK_TEST_SET_GET_VALUE(mapFileName, std::string(pairedMeshIO->GetPointDataFileName()));
+    auto pairedReader = itk::MeshFileReader<MeshType>::New();
+    pairedReader->SetMeshIO(pairedMeshIO);
+    pairedReader->SetFileName(outputCompressedMeshFileName);
+    ITK_TRY_EXPECT_NO_EXCEPTION(pairedReader->Update());
+    const MeshType * pairedMesh = pairedReader->GetOutput();
+    ITK_TEST_EXPECT_TRUE(MeshesAreEqual(pairedMesh, inputMesh.GetPointer()));
+    const itk::SizeValueType lastPoint = inputMesh->GetNumberOfPoints() - 1;
+    ITK_TEST_EXPECT_EQUAL(pairedMesh->GetPointData()->ElementAt(lastPoint), 0.5f * lastPoint);
+  }
+
+  const std::vector<char> notMZ3(64, 0);
+  mz3MeshIO->SetInputBuffer(notMZ3.data(), notMZ3.size());
+  ITK_TRY_EXPECT_EXCEPTION(mz3MeshIO->ReadMeshInformation());
+  mz3MeshIO->SetInputBuffer(nullptr, 0);
+
   std::cout << "Test finished." << std::endl;
   return result;
 }
@@ -0,0 +1,87 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkMZ3OverlayMatrix.h"
+#include "itkMZ3MeshIOFactory.h"
+
+#include "itkMesh.h"
+#include "itkMeshFileReader.h"
+#include "itkMeshFileWriter.h"
+#include "itkTestingMacros.h"
+
+int
+itkMZ3OverlayMatrixTest(int argc, char * argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << itkNameOfTestExecutableMacro(argv);
+    std::cerr << " inputMesh";
+    std::cerr << " outputOverlayPrefix";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+  const char *      inputMeshFileName = argv[1];
+  const std::string outputOverlayPrefix = argv[2];
+
+  itk::MZ3MeshIOFactory::RegisterOneFactory();
+
+  constexpr unsigned int Dimension = 3;
+  using PixelType = float;
+  using MeshType = itk::Mesh<PixelType, Dimension>;
+
+  // One overlay per subject on the same surface, raw and gzip compressed in turn
+  const auto               mesh = itk::ReadMesh<MeshType>(inputMeshFileName);
+  const itk::SizeValueType numberOfVertices = mesh->GetNumberOfPoints();
+  constexpr unsigned int   numberOfSubjects = 4;
+  std::vector<std::string> paths;
+  for (unsigned int subject = 0; subject < numberOfSubjects; ++subject)
+  {
+    for (itk::SizeValueType vertex = 0; vertex < numberOfVertices; ++vertex)
+    {
+      mesh->SetPointData(vertex, static_cast<PixelType>(subject * numberOfVertices + vertex));
+    }
+    paths.push_back(outputOverlayPrefix + std::to_string(subject) + ".mz3");
+    itk::WriteMesh(mesh, paths.back(), subject % 2 == 1);
+  }
+
+  ITK_TEST_EXPECT_EQUAL(itk::ReadMZ3OverlayNumberOfVertices(paths), numberOfVertices);
+  std::vector<float>           floatMatrix(numberOfSubjects * numberOfVertices);
+  std::vector<double>          doubleMatrix(numberOfSubjects * numberOfVertices);
+  itk::MZ3OverlayMatrixOptions options;
+  options.NumberOfWorkUnits = 2;
+  ITK_TRY_EXPECT_NO_EXCEPTION(itk::ReadMZ3OverlayMatrix(paths, numberOfVertices, floatMatrix.data(), options));
+  ITK_TRY_EXPECT_NO_EXCEPTION(itk::ReadMZ3OverlayMatrix(paths, numberOfVertices, doubleMatrix.data()));
+  bool isEqual = true;
+  for (itk::SizeValueType ii = 0; ii < floatMatrix.size(); ++ii)
+  {
+    isEqual = isEqual && floatMatrix[ii] == static_cast<float>(ii) && doubleMatrix[ii] == static_cast<double>(ii);
+  }
+  ITK_TEST_EXPECT_TRUE(isEqual);
+
+  // Another number of vertices, a file without scalars and a missing layer are reported
+  ITK_TRY_EXPECT_EXCEPTION(itk::ReadMZ3OverlayMatrix(paths, numberOfVertices + 1, floatMatrix.data()));
+  const std::vector<std::string> withoutScalars = { paths[0], inputMeshFileName };
+  ITK_TRY_EXPECT_EXCEPTION(itk::ReadMZ3OverlayNumberOfVertices(withoutScalars));
+  options.Layer = 1;
+  ITK_TRY_EXPECT_EXCEPTION(itk::ReadMZ3OverlayMatrix(paths, numberOfVertices, floatMatrix.data(), options));
+  ITK_TRY_EXPECT_EXCEPTION(itk::ReadMZ3OverlayNumberOfVertices({ "NotAFile.mz3" }));
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
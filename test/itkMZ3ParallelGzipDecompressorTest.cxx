@@ -0,0 +1,195 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkMZ3ParallelGzipDecompressor.h"
+
+#include "itkTestingMacros.h"
+#include "itk_zlib.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+namespace
+{
+std::vector<uint8_t>
+GzipCompress(const std::vector<uint8_t> & input, int level)
+{
+  z_stream stream{};
+  deflateInit2(&stream, level, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+  std::vector<uint8_t> output(deflateBound(&stream, static_cast<uLong>(input.size())) + 32);
+  stream.next_in = const_cast<Bytef *>(input.data());
+  stream.avail_in = static_cast<uInt>(input.size());
+  stream.next_out = output.data();
+  stream.avail_out = static_cast<uInt>(output.size());
+  deflate(&stream, Z_FINISH);
+  output.resize(stream.total_out);
+  deflateEnd(&stream);
+  return output;
+}
+
+std::vector<uint8_t>
+GzipDecompress(const std::vector<uint8_t> & input)
+{
+  std::vector<uint8_t> output;
+  uint8_t              buffer[65536];
+  z_stream             stream{};
+  inflateInit2(&stream, 16 + MAX_WBITS);
+  stream.next_in = const_cast<Bytef *>(input.data());
+  stream.avail_in = static_cast<uInt>(input.size());
+  int status = Z_OK;
+  while (status == Z_OK)
+  {
+    stream.next_out = buffer;
+    stream.avail_out = sizeof(buffer);
+    status = inflate(&stream, Z_NO_FLUSH);
+    output.insert(output.end(), buffer, buffer + sizeof(buffer) - stream.avail_out);
+  }
+  inflateEnd(&stream);
+  return output;
+}
+
+// Face indices followed by vertex coordinates, like the sections of an MZ3 file.
+std::vector<uint8_t>
+MakeSyntheticMesh(unsigned int numberOfVertices)
+{
+  std::mt19937          generator(42);
+  std::vector<uint32_t> faces(2 * numberOfVertices * 3);
+  for (size_t ii = 0; ii < faces.size(); ++ii)
+  {
+    faces[ii] = static_cast<uint32_t>(ii / 6 + generator() % 8);
+  }
+  std::vector<float> vertices(numberOfVertices * 3);
+  for (size_t ii = 0; ii < vertices.size(); ++ii)
+  {
+    vertices[ii] = 50.0f * std::sin(0.001f * ii) + static_cast<float>(generator() % 1000) * 1e-3f;
+  }
+  std::vector<uint8_t> mesh(faces.size() * sizeof(uint32_t) + vertices.size() * sizeof(float));
+  std::memcpy(mesh.data(), faces.data(), faces.size() * sizeof(uint32_t));
+  std::memcpy(mesh.data() + faces.size() * sizeof(uint32_t), vertices.data(), vertices.size() * sizeof(float));
+  return mesh;
+}
+
+bool
+DecompressAndCompare(itk::MZ3ParallelGzipDecompressor * decompressor,
+                     const std::vector<uint8_t> &       compressed,
+                     const std::vector<uint8_t> &       expected)
+{
+  std::vector<uint8_t> output;
+  decompressor->Decompress(compressed.data(), compressed.size(), output);
+  if (output != expected)
+  {
+    std::cerr << "Mismatch with ChunkSize " << decompressor->GetChunkSize() << " and NumberOfWorkUnits "
+              << decompressor->GetNumberOfWorkUnits() << ": got " << output.size() << " bytes, expected "
+              << expected.size() << std::endl;
+    return false;
+  }
+  return true;
+}
+} // namespace
+
+int
+itkMZ3ParallelGzipDecompressorTest(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << itkNameOfTestExecutableMacro(argv);
+    std::cerr << " inputMesh [inputMesh ...]";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto decompressor = itk::MZ3ParallelGzipDecompressor::New();
+
+  ITK_EXERCISE_BASIC_OBJECT_METHODS(decompressor, MZ3ParallelGzipDecompressor, Object);
+
+  decompressor->SetNumberOfWorkUnits(4);
+  ITK_TEST_SET_GET_VALUE(4, decompressor->GetNumberOfWorkUnits());
+  decompressor->SetChunkSize(4096);
+  ITK_TEST_SET_GET_VALUE(4096, decompressor->GetChunkSize());
+
+  int result = EXIT_SUCCESS;
+
+  // Bundled meshes, compressed by zlib if they are stored uncompressed
+  for (int arg = 1; arg < argc; ++arg)
+  {
+    std::ifstream        file(argv[arg], std::ios::binary);
+    std::vector<uint8_t> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const bool           isGzip = contents.size() > 2 && contents[0] == 0x1F && contents[1] == 0x8B;
+    const auto           compressed = isGzip ? contents : GzipCompress(contents, 6);
+    const auto           expected = isGzip ? GzipDecompress(contents) : contents;
+    for (const itk::SizeValueType chunkSize : { 1024, 16384, 1 << 22 })
+    {
+      for (const unsigned int numberOfWorkUnits : { 1, 2, 4 })
+      {
+        decompressor->SetChunkSize(chunkSize);
+        decompressor->SetNumberOfWorkUnits(numberOfWorkUnits);
+        if (!DecompressAndCompare(decompressor, compressed, expected))
+        {
+          std::cerr << "Failure for " << argv[arg] << std::endl;
+          result = EXIT_FAILURE;
+        }
+      }
+    }
+  }
+
+  // Large synthetic meshes at several compression levels
+  const auto synthetic = MakeSyntheticMesh(300000);
+  decompressor->SetNumberOfWorkUnits(4);
+  for (const int level : { 1, 6, 9 })
+  {
+    const auto compressed = GzipCompress(synthetic, level);
+    for (const itk::SizeValueType chunkSize : { 65536, 1 << 20 })
+    {
+      decompressor->SetChunkSize(chunkSize);
+      if (!DecompressAndCompare(decompressor, compressed, synthetic))
+      {
+        std::cerr << "Failure for the synthetic mesh at compression level " << level << std::endl;
+        result = EXIT_FAILURE;
+      }
+    }
+  }
+
+  // Concatenated gzip members
+  const auto           member = GzipCompress(synthetic, 6);
+  std::vector<uint8_t> members = member;
+  members.insert(members.end(), member.begin(), member.end());
+  std::vector<uint8_t> expectedMembers = synthetic;
+  expectedMembers.insert(expectedMembers.end(), synthetic.begin(), synthetic.end());
+  decompressor->SetChunkSize(1 << 20);
+  if (!DecompressAndCompare(decompressor, members, expectedMembers))
+  {
+    std::cerr << "Failure for concatenated gzip members" << std::endl;
+    result = EXIT_FAILURE;
+  }
+
+  // Corrupted data is detected
+  auto corrupted = member;
+  corrupted[corrupted.size() / 2] ^= 0x10;
+  std::vector<uint8_t> output;
+  ITK_TRY_EXPECT_EXCEPTION(decompressor->Decompress(corrupted.data(), corrupted.size(), output));
+
+  const std::vector<uint8_t> notGzip(64, 0);
+  ITK_TRY_EXPECT_EXCEPTION(decompressor->Decompress(notGzip.data(), notGzip.size(), output));
+
+  std::cout << "Test finished." << std::endl;
+  return result;
+}
@@ -0,0 +1,169 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkMZ3MeshIO.h"
+#include "itkMZ3SpatialIndex.h"
+
+#include "itkMesh.h"
+#include "itkMeshFileReader.h"
+#include "itkTestingMacros.h"
+#include "itksys/SystemTools.hxx"
+
+#include <limits>
+#include <random>
+
+int
+itkMZ3SpatialIndexTest(int argc, char * argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << itkNameOfTestExecutableMacro(argv);
+    std::cerr << " inputMesh";
+    std::cerr << " outputSpatialIndex";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+  const char * inputMeshFileName = argv[1];
+  const char * spatialIndexFileName = argv[2];
+  itksys::SystemTools::RemoveFile(spatialIndexFileName);
+
+  constexpr unsigned int Dimension = 3;
+  using PixelType = float;
+  using MeshType = itk::Mesh<PixelType, Dimension>;
+  using ReaderType = itk::MeshFileReader<MeshType>;
+
+  auto mz3MeshIO = itk::MZ3MeshIO::New();
+  ITK_TEST_SET_GET_BOOLEAN(mz3MeshIO, BuildSpatialIndex, false);
+  mz3MeshIO->SetSpatialIndexFileName(spatialIndexFileName);
+  ITK_TEST_SET_GET_VALUE(std::string(spatialIndexFileName), std::string(mz3MeshIO->GetSpatialIndexFileName()));
+  mz3MeshIO->BuildSpatialIndexOn();
+
+  auto reader = ReaderType::New();
+  reader->SetMeshIO(mz3MeshIO);
+  reader->SetFileName(inputMeshFileName);
+  ITK_TRY_EXPECT_NO_EXCEPTION(reader->Update());
+  const MeshType * mesh = reader->GetOutput();
+
+  const itk::MZ3SpatialIndex::Pointer spatialIndex = mz3MeshIO->GetSpatialIndex();
+  ITK_TEST_EXPECT_TRUE(spatialIndex != nullptr);
+  ITK_EXERCISE_BASIC_OBJECT_METHODS(spatialIndex, MZ3SpatialIndex, Object);
+  ITK_TEST_EXPECT_EQUAL(spatialIndex->GetNumberOfPoints(), mesh->GetNumberOfPoints());
+  ITK_TEST_EXPECT_TRUE(itksys::SystemTools::FileExists(spatialIndexFileName));
+
+  // Compare with a search over all vertices
+  float minimum[3] = { 0.0f, 0.0f, 0.0f };
+  float maximum[3] = { 0.0f, 0.0f, 0.0f };
+  for (unsigned int axis = 0; axis < 3; ++axis)
+  {
+    minimum[axis] = static_cast<float>(mesh->GetBoundingBox()->GetMinimum()[axis]);
+    maximum[axis] = static_cast<float>(mesh->GetBoundingBox()->GetMaximum()[axis]);
+  }
+  std::mt19937                          generator(42);
+  std::uniform_real_distribution<float> distribution(-0.25f, 1.25f);
+
+  int result = EXIT_SUCCESS;
+  for (unsigned int query = 0; query < 100; ++query)
+  {
+    float point[3];
+    for (unsigned int axis = 0; axis < 3; ++axis)
+    {
+      point[axis] = minimum[axis] + distribution(generator) * (maximum[axis] - minimum[axis]);
+    }
+    const auto squaredDistance = [&point](const auto & other) {
+      float distance = 0.0f;
+      for (unsigned int axis = 0; axis < 3; ++axis)
+      {
+        const float offset = point[axis] - static_cast<float>(other[axis]);
+        distance += offset * offset;
+      }
+      return distance;
+    };
+
+    float closestDistance = std::numeric_limits<float>::max();
+    for (MeshType::PointIdentifier id = 0; id < mesh->GetNumberOfPoints(); ++id)
+    {
+      closestDistance = std::min(closestDistance, squaredDistance(mesh->GetPoint(id)));
+    }
+    const float indexDistance = squaredDistance(mesh->GetPoint(spatialIndex->FindClosestPoint(point)));
+    if (indexDistance != closestDistance)
+    {
+      std::cerr << "Closest point at squared distance " << indexDistance << " instead of " << closestDistance
+                << std::endl;
+      result = EXIT_FAILURE;
+    }
+
+    // The surface is never farther than its closest vertex
+    if (mesh->GetNumberOfCells() > 0)
+    {
+      float      surfacePoint[3];
+      const auto face = spatialIndex->FindClosestSurfacePoint(point, surfacePoint);
+      ITK_TEST_EXPECT_TRUE(face < mesh->GetNumberOfCells());
+      ITK_TEST_EXPECT_TRUE(squaredDistance(surfacePoint) <= closestDistance * 1.0001f);
+    }
+  }
+
+  // A second read uses the sidecar file and answers the same queries
+  auto sidecarMeshIO = itk::MZ3MeshIO::New();
+  sidecarMeshIO->BuildSpatialIndexOn();
+  sidecarMeshIO->SetSpatialIndexFileName(spatialIndexFileName);
+  auto sidecarReader = ReaderType::New();
+  sidecarReader->SetMeshIO(sidecarMeshIO);
+  sidecarReader->SetFileName(inputMeshFileName);
+  ITK_TRY_EXPECT_NO_EXCEPTION(sidecarReader->Update());
+  const float origin[3] = { 0.0f, 0.0f, 0.0f };
+  ITK_TEST_EXPECT_EQUAL(sidecarMeshIO->GetSpatialIndex()->FindClosestPoint(origin),
+                        spatialIndex->FindClosestPoint(origin));
+
+  // Geometry that does not match the sidecar file is rejected
+  const std::vector<float>    points{ 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f };
+  const std::vector<uint32_t> faces{ 0, 1, 2 };
+  auto                        otherIndex = itk::MZ3SpatialIndex::New();
+  ITK_TEST_EXPECT_TRUE(!otherIndex->Read(spatialIndexFileName, points.data(), 3, faces.data(), 1));
+  otherIndex->Build(points.data(), 3, faces.data(), 1);
+  const float above[3] = { 0.25f, 0.25f, 2.0f };
+  float       surfacePoint[3];
+  ITK_TEST_EXPECT_EQUAL(otherIndex->FindClosestSurfacePoint(above, surfacePoint), 0);
+  ITK_TEST_EXPECT_EQUAL(surfacePoint[2], 0.0f);
+
+  const std::vector<uint32_t> badFaces{ 0, 1, 3 };
+  ITK_TRY_EXPECT_EXCEPTION(otherIndex->Build(points.data(), 3, badFaces.data(), 1));
+
+  // The index takes over geometry that is moved into it
+  std::vector<float>    ownedPoints(points);
+  std::vector<uint32_t> ownedFaces(faces);
+  otherIndex->Build(std::move(ownedPoints), std::move(ownedFaces));
+  ITK_TEST_EXPECT_EQUAL(otherIndex->GetNumberOfFaces(), 1);
+  ITK_TEST_EXPECT_EQUAL(otherIndex->FindClosestSurfacePoint(above, surfacePoint), 0);
+
+  // Faces without a vertex section are read without an index
+  const uint8_t facesOnly[28] = { 0x4D, 0x5A, 1, 0, 1, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0,
+                                  0,    0,    0, 0, 1, 0, 0, 0, 2, 0, 0, 0 };
+  auto          facesOnlyMeshIO = itk::MZ3MeshIO::New();
+  facesOnlyMeshIO->BuildSpatialIndexOn();
+  facesOnlyMeshIO->SetInputBuffer(facesOnly, sizeof(facesOnly));
+  auto facesOnlyReader = ReaderType::New();
+  facesOnlyReader->SetMeshIO(facesOnlyMeshIO);
+  facesOnlyReader->SetFileName(inputMeshFileName);
+  ITK_TRY_EXPECT_NO_EXCEPTION(facesOnlyReader->Update());
+  ITK_TEST_EXPECT_EQUAL(facesOnlyReader->GetOutput()->GetNumberOfCells(), 1);
+  ITK_TEST_EXPECT_TRUE(facesOnlyMeshIO->GetSpatialIndex() == nullptr);
+
+  std::cout << "Test finished." << std::endl;
+  return result;
+}